@@ -0,0 +1,334 @@
+/**
+    \file BitImage.cpp
+    Implementation of the BitImage class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <string.h>
+#include  <vector>
+#include  "BitImage.h"
+#include  "BufferPool.h"
+#include  "ThreadPool.h"
+
+/// all bits set.
+static const BitImage::Word  AllOnes = ~(BitImage::Word)0;
+//---------------------------------------------------------------------------
+/// \returns the mask of the bits used in the last word of a row.
+static inline BitImage::Word lastWordMask ( const int w ) {
+    const int  used = w % BitImage::WordBits;
+    return (used==0) ? AllOnes : (((BitImage::Word)1 << used) - 1);
+}
+//---------------------------------------------------------------------------
+/// packs rows [mY0+begin,mY0+end) (and notes values other than 0 and one).
+class PackTask : public ThreadPool::RangeTask {
+public:
+    BitImage*      mImage;
+    const int*     mSrc;
+    int            mOne;
+    int            mY0;    ///< first row (iterations are rows from here)
+    volatile long  mOdd;   ///< some value is neither 0 nor one
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const int  w = mImage->getW();
+        const int  words = mImage->getWordsPerRow();
+        int  odd = 0;
+        for (int y=mY0+begin; y<mY0+end && !mOdd; y++) {
+            const int*       s = mSrc + (size_t)y * w;
+            BitImage::Word*  d = mImage->row( y );
+            for (int i=0; i<words; i++) {
+                const int  x0 = i * BitImage::WordBits;
+                const int  n  = (w - x0 < BitImage::WordBits)
+                                ? w - x0 : BitImage::WordBits;
+                BitImage::Word  bits = 0;
+                for (int b=0; b<n; b++) {
+                    const int  v = s[x0+b];
+                    bits |= (BitImage::Word)(v!=0) << b;
+                    odd  |= (v!=0) & (v!=mOne);
+                }
+                d[i] = bits;
+            }
+            if (odd)    mOdd = 1;
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// unpacks rows [begin,end).
+class UnpackTask : public ThreadPool::RangeTask {
+public:
+    const BitImage*  mImage;
+    int*             mDst;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const int  w = mImage->getW();
+        const int  one = mImage->getOne();
+        for (int y=begin; y<end; y++) {
+            const BitImage::Word*  s = mImage->row( y );
+            int*  d = mDst + (size_t)y * w;
+            for (int x=0; x<w; x+=BitImage::WordBits) {
+                BitImage::Word  bits = s[ x / BitImage::WordBits ];
+                const int  n = (w - x < BitImage::WordBits)
+                               ? w - x : BitImage::WordBits;
+                //(-bit is all ones for a set pixel)
+                for (int b=0; b<n; b++, bits>>=1)
+                    d[x+b] = one & -(int)(bits & 1);
+            }
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// combines (or, if mOther is NULL, inverts) rows [begin,end).
+class CombineTask : public ThreadPool::RangeTask {
+public:
+    BitImage*        mImage;
+    const BitImage*  mOther;
+    BitImage::Op     mOp;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const int  words = mImage->getWordsPerRow();
+        const BitImage::Word  last = lastWordMask( mImage->getW() );
+        for (int y=begin; y<end; y++) {
+            BitImage::Word*  d = mImage->row( y );
+            if (mOther==NULL) {
+                for (int i=0; i<words; i++)    d[i] = ~d[i];
+                d[words-1] &= last;
+                continue;
+            }
+            const BitImage::Word*  s = mOther->row( y );
+            switch (mOp) {
+                case BitImage::And :
+                    for (int i=0; i<words; i++)    d[i] &= s[i];
+                    break;
+                case BitImage::Or :
+                    for (int i=0; i<words; i++)    d[i] |= s[i];
+                    break;
+                case BitImage::Xor :
+                    for (int i=0; i<words; i++)    d[i] ^= s[i];
+                    break;
+                case BitImage::AndNot :
+                    for (int i=0; i<words; i++)    d[i] &= ~s[i];
+                    break;
+            }
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// counts the set pixels of rows [begin,end) (per worker).
+class CountTask : public ThreadPool::RangeTask {
+public:
+    const BitImage*      mImage;
+    std::vector<size_t>  mSums;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const int  words = mImage->getWordsPerRow();
+        size_t  sum = 0;
+        for (int y=begin; y<end; y++) {
+            const BitImage::Word*  s = mImage->row( y );
+            for (int i=0; i<words; i++)    sum += BitImage::popcount( s[i] );
+        }
+        mSums[worker] += sum;
+    }
+};
+//===========================================================================
+BitImage::BitImage ( ) {
+    mBits = NULL;
+    mW = mH = mWordsPerRow = 0;
+    mOne = 1;
+}
+//---------------------------------------------------------------------------
+BitImage::~BitImage ( ) {
+    release();
+}
+//---------------------------------------------------------------------------
+/** \brief Allocate a w x h image with all pixels 0.
+ *  \param w width
+ *  \param h height
+ *  \param one value of set pixels (when unpacked)
+ *  \returns false if out of memory.
+ */
+bool BitImage::create ( const int w, const int h, const int one ) {
+    assert( w>0 && h>0 && one!=0 );
+    release();
+    const int     words = (w + WordBits - 1) / WordBits;
+    const size_t  bytes = (size_t)words * h * sizeof(Word);
+    mBits = (Word*)BufferPool::instance().allocate( bytes );
+    if (mBits==NULL)    return false;
+    memset( mBits, 0, bytes );
+    mW = w;
+    mH = h;
+    mWordsPerRow = words;
+    mOne = one;
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Free the pixels (the image becomes empty).
+ */
+void BitImage::release ( void ) {
+    BufferPool::instance().release( mBits );
+    mBits = NULL;
+    mW = mH = mWordsPerRow = 0;
+}
+//---------------------------------------------------------------------------
+/** \brief Pack a binary image (0 pixels are clear; pixels equal to one are
+ *  set).
+ *  \param src w*h pixels
+ *  \param w width
+ *  \param h height
+ *  \param one value of set pixels (e.g., 1 or 255)
+ *  \returns false (and the image is empty) if some pixel is neither 0 nor
+ *  one, or if out of memory.
+ */
+bool BitImage::pack ( const int* const src, const int w, const int h,
+                      const int one )
+{
+    assert( src!=NULL );
+    if (!create( w, h, one ))    return false;
+    PackTask  t;
+    t.mImage = this;    t.mSrc = src;    t.mOne = one;    t.mOdd = 0;
+    t.mY0 = 0;
+    ThreadPool::instance().parallelFor( h, t, 16 );
+    if (t.mOdd) {
+        release();
+        return false;
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Pack rows [y0,y1) again (e.g., after they were modified); the
+ *  other rows are kept.
+ *  \param src getW()*getH() pixels (the whole image)
+ *  \param y0 first row
+ *  \param y1 last row + 1
+ *  \returns false (and the image is empty) if some pixel of those rows is
+ *  neither 0 nor getOne().
+ */
+bool BitImage::packRows ( const int* const src, const int y0, const int y1 ) {
+    assert( !empty() && src!=NULL && 0<=y0 && y0<=y1 && y1<=mH );
+    PackTask  t;
+    t.mImage = this;    t.mSrc = src;    t.mOne = mOne;    t.mOdd = 0;
+    t.mY0 = y0;
+    ThreadPool::instance().parallelFor( y1 - y0, t, 16 );
+    if (t.mOdd) {
+        release();
+        return false;
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Unpack the image to one int per pixel (0 or getOne()).
+ *  \param dst receives getW()*getH() pixels
+ */
+void BitImage::unpack ( int* const dst ) const {
+    assert( !empty() && dst!=NULL );
+    UnpackTask  t;
+    t.mImage = this;    t.mDst = dst;
+    ThreadPool::instance().parallelFor( mH, t, 16 );
+}
+//---------------------------------------------------------------------------
+/** \brief This = this op other (64 pixels at a time).
+ *  \param other image of the same size
+ *  \param op And, Or, Xor, or AndNot (this and not other)
+ */
+void BitImage::combine ( const BitImage& other, const Op op ) {
+    assert( !empty() && other.mW==mW && other.mH==mH );
+    CombineTask  t;
+    t.mImage = this;    t.mOther = &other;    t.mOp = op;
+    ThreadPool::instance().parallelFor( mH, t, 16 );
+}
+//---------------------------------------------------------------------------
+/** \brief Invert every pixel.
+ */
+void BitImage::invert ( void ) {
+    assert( !empty() );
+    CombineTask  t;
+    t.mImage = this;    t.mOther = NULL;    t.mOp = Xor;
+    ThreadPool::instance().parallelFor( mH, t, 16 );
+}
+//---------------------------------------------------------------------------
+/** \returns the number of set pixels.
+ */
+size_t BitImage::count ( void ) const {
+    if (empty())    return 0;
+    CountTask  t;
+    t.mImage = this;
+    t.mSums.assign( ThreadPool::instance().getThreadCount(), 0 );
+    ThreadPool::instance().parallelFor( mH, t, 16 );
+    size_t  sum = 0;
+    for (size_t i=0; i<t.mSums.size(); i++)    sum += t.mSums[i];
+    return sum;
+}
+//---------------------------------------------------------------------------
+/** \brief Expand part of a row to display pixels (e.g., BGRX).  Words
+ *  that are all clear or all set are filled without looking at bits.
+ *  \param x0 first pixel
+ *  \param y row
+ *  \param n number of pixels
+ *  \param dst receives n display pixels
+ *  \param zero display pixel for clear pixels
+ *  \param one display pixel for set pixels
+ */
+void BitImage::toBGRX ( const int x0, const int y, const int n,
+                        unsigned int* const dst, const unsigned int zero,
+                        const unsigned int one ) const
+{
+    assert( !empty() && x0>=0 && x0+n<=mW && y>=0 && y<mH );
+    const Word*  r = row( y );
+    const unsigned int  diff = zero ^ one;
+    int  i = 0;
+    while (i<n) {
+        const int  x = x0 + i;
+        const int  b = x % WordBits;
+        const int  k = (n - i < WordBits - b) ? n - i : WordBits - b;
+        Word  bits = r[ x / WordBits ] >> b;
+        unsigned int*  d = dst + i;
+        if (k==WordBits && (bits==0 || bits==AllOnes)) {
+            const unsigned int  v = (bits==0) ? zero : one;
+            for (int j=0; j<k; j++)    d[j] = v;
+        } else {
+            for (int j=0; j<k; j++, bits>>=1)
+                d[j] = zero ^ (diff & (0u - (unsigned int)(bits & 1)));
+        }
+        i += k;
+    }
+}
+//---------------------------------------------------------------------------
+/// \returns the number of set bits in v.
+int BitImage::popcount ( Word v ) {
+    #if defined(__GNUC__)
+        return __builtin_popcountll( v );
+    #else
+        v = v - ((v >> 1) & 0x5555555555555555ULL);
+        v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+        v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return (int)((v * 0x0101010101010101ULL) >> 56);
+    #endif
+}
+//---------------------------------------------------------------------------
+/** \returns true if an image with this range may be binary (0/1 or 0/255)
+ *  and therefore worth trying to pack.
+ */
+bool BitImage::isBinaryRange ( const int min, const int max ) {
+    return min==0 && (max==1 || max==255);
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,107 @@
+/**
+    \file BitImage.h
+    Definition of the BitImage class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef BitImage_h
+#define BitImage_h
+
+#include  <stddef.h>
+//----------------------------------------------------------------------
+/** \brief A binary image packed 1 bit per pixel (64 pixels per word).
+ *
+ *  Pixel x of a row is bit x%64 of word x/64 of that row.  Rows start on
+ *  a word and the unused bits at the end of each row are always 0, so
+ *  whole words may be combined and counted without masking.  The value
+ *  of the set pixels (e.g., 1 or 255) is remembered so that the image
+ *  can be unpacked exactly.
+ *
+ *  Word-parallel operations (logical ops, counting, and expansion to
+ *  display pixels) work directly on the packed words; whole images are
+ *  processed by rows on the ThreadPool.
+ */
+class BitImage {
+public:
+    typedef unsigned long long  Word;
+    enum { WordBits = 64 };
+    /// logical operations (see combine).
+    enum Op { And, Or, Xor, AndNot };
+
+    BitImage  ( );
+    ~BitImage ( );
+
+    bool   create  ( const int w, const int h, const int one=1 );
+    void   release ( void );
+    bool   pack    ( const int* const src, const int w, const int h,
+                     const int one );
+    bool   packRows ( const int* const src, const int y0, const int y1 );
+    void   unpack  ( int* const dst ) const;
+    void   combine ( const BitImage& other, const Op op );
+    void   invert  ( void );
+    size_t count   ( void ) const;
+    void   toBGRX  ( const int x0, const int y, const int n,
+                     unsigned int* const dst, const unsigned int zero,
+                     const unsigned int one ) const;
+
+    inline bool empty ( void ) const {  return mBits==NULL;  }
+    inline int  getW  ( void ) const {  return mW;  }
+    inline int  getH  ( void ) const {  return mH;  }
+    /// \returns the value of set pixels.
+    inline int  getOne ( void ) const {  return mOne;  }
+    inline int  getWordsPerRow ( void ) const {  return mWordsPerRow;  }
+    /// \returns the memory held (in bytes).
+    inline size_t getBytes ( void ) const {
+        return (mBits==NULL) ? 0 : (size_t)mWordsPerRow * mH * sizeof(Word);
+    }
+    inline const Word* row ( const int y ) const {
+        return mBits + (size_t)y * mWordsPerRow;
+    }
+    inline Word* row ( const int y ) {
+        return mBits + (size_t)y * mWordsPerRow;
+    }
+    inline bool get ( const int x, const int y ) const {
+        return ((row(y)[x / WordBits] >> (x % WordBits)) & 1) != 0;
+    }
+    inline void set ( const int x, const int y, const bool v ) {
+        const Word  bit = (Word)1 << (x % WordBits);
+        if (v)    row(y)[x / WordBits] |= bit;
+        else      row(y)[x / WordBits] &= ~bit;
+    }
+
+    static int  popcount ( Word v );
+    static bool isBinaryRange ( const int min, const int max );
+
+protected:
+    Word*  mBits;         ///< mH rows of mWordsPerRow words (or NULL)
+    int    mW, mH;        ///< size (in pixels)
+    int    mWordsPerRow;  ///< words per row
+    int    mOne;          ///< value of set pixels
+
+private:
+    BitImage ( const BitImage& );
+    BitImage& operator= ( const BitImage& );
+};
+
+#endif
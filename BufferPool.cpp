@@ -0,0 +1,205 @@
+/**
+    \file BufferPool.cpp
+    Implementation of the BufferPool class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  "BufferPool.h"
+
+#ifndef WIN32
+#  include <sys/mman.h>
+#endif
+
+/// how a pooled buffer was obtained from the system.
+enum {  KindMapped = 1,  KindLargePages = 2  };
+//---------------------------------------------------------------------------
+/** \brief The one and only buffer pool (created on first use).
+ */
+BufferPool& BufferPool::instance ( void ) {
+    static BufferPool  pool;
+    return pool;
+}
+//---------------------------------------------------------------------------
+BufferPool::BufferPool ( ) {
+    mMaxRetained = 512 * 1024 * 1024;
+    mHugePages = true;
+    memset( &mCounters, 0, sizeof mCounters );
+}
+//---------------------------------------------------------------------------
+BufferPool::~BufferPool ( ) {
+    evict( 0 );
+}
+//---------------------------------------------------------------------------
+/** \brief Round a request up to its size class.  Classes are 1/8 of a
+ *  power of 2 apart, so at most 12.5% is wasted, and images of the same
+ *  (or nearly the same) size share a class.
+ */
+size_t BufferPool::sizeClass ( const size_t bytes ) {
+    if (bytes < Threshold)    return bytes;
+    size_t  p = Threshold;
+    while (p <= bytes/2)    p *= 2;
+    const size_t  step = p / 8;
+    return (bytes + step - 1) / step * step;
+}
+//---------------------------------------------------------------------------
+/** \brief Get memory from the operating system (bypassing the C heap so
+ *  that it can be given back, and so that huge pages may be used).
+ */
+void* BufferPool::systemAlloc ( const size_t bytes, int* kind ) {
+    void*  p = NULL;
+    #ifdef WIN32
+      #if _WIN32_WINNT >= 0x0502
+        if (mHugePages) {
+            //only succeeds if the user holds the "lock pages in memory" right
+            const SIZE_T  large = GetLargePageMinimum();
+            if (large>0 && bytes>=large) {
+                const SIZE_T  n = (bytes + large - 1) / large * large;
+                p = VirtualAlloc( NULL, n,
+                        MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                        PAGE_READWRITE );
+                if (p!=NULL) {  *kind = KindLargePages;  return p;  }
+            }
+        }
+      #endif
+        p = VirtualAlloc( NULL, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE );
+        *kind = KindMapped;
+        return p;
+    #else
+        p = mmap( NULL, bytes, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if (p==MAP_FAILED)    return NULL;
+        *kind = KindMapped;
+      #ifdef MADV_HUGEPAGE
+        //transparent huge pages: fewer page faults and tlb misses
+        if (mHugePages && bytes >= 2*1024*1024) {
+            if (madvise( p, bytes, MADV_HUGEPAGE )==0)    *kind = KindLargePages;
+        }
+      #endif
+        return p;
+    #endif
+}
+//---------------------------------------------------------------------------
+void BufferPool::systemFree ( void* p, const Block& b ) {
+    #ifdef WIN32
+        VirtualFree( p, 0, MEM_RELEASE );
+    #else
+        munmap( p, b.size );
+    #endif
+}
+//---------------------------------------------------------------------------
+/** \brief Allocate a buffer.  Release it with release (not free).
+ *  \param bytes requested size
+ *  \returns the buffer (or NULL if out of memory).
+ */
+void* BufferPool::allocate ( const size_t bytes ) {
+    if (bytes < Threshold)    return malloc( bytes );
+    const size_t  size = sizeClass( bytes );
+    Lock  l( mMutex );
+    //most recently released first (it's the most likely to be cache/tlb warm)
+    for (std::list<void*>::reverse_iterator it=mFree.rbegin();
+         it!=mFree.rend(); ++it)
+    {
+        void*  p = *it;
+        if (mBlocks[p].size != size)    continue;
+        mFree.erase( --(it.base()) );
+        ++mCounters.hits;
+        mCounters.retained    -= size;
+        mCounters.outstanding += size;
+        return p;
+    }
+    ++mCounters.misses;
+    int    kind = 0;
+    void*  p = systemAlloc( size, &kind );
+    if (p==NULL && !mFree.empty()) {
+        //give back what we're holding and try again
+        evict( 0 );
+        p = systemAlloc( size, &kind );
+    }
+    if (p==NULL)    return NULL;
+    Block  b;
+    b.size = size;
+    b.kind = kind;
+    mBlocks[p] = b;
+    mCounters.outstanding += size;
+    return p;
+}
+//---------------------------------------------------------------------------
+/** \brief Return a buffer to the pool.  Buffers that weren't pooled (small
+ *  ones, or ones allocated with malloc by someone else) are freed.
+ */
+void BufferPool::release ( void* p ) {
+    if (p==NULL)    return;
+    Lock  l( mMutex );
+    std::map<void*, Block>::iterator  it = mBlocks.find( p );
+    if (it==mBlocks.end()) {
+        free( p );
+        return;
+    }
+    ++mCounters.releases;
+    mCounters.outstanding -= it->second.size;
+    mCounters.retained    += it->second.size;
+    mFree.push_back( p );
+    evict( mMaxRetained );
+}
+//---------------------------------------------------------------------------
+/** \brief Give cached buffers back to the OS (oldest first) until no more
+ *  than keep bytes are retained.  Caller must hold mMutex.
+ */
+void BufferPool::evict ( const size_t keep ) {
+    while (mCounters.retained > keep && !mFree.empty()) {
+        void*  p = mFree.front();
+        mFree.pop_front();
+        std::map<void*, Block>::iterator  it = mBlocks.find( p );
+        assert( it!=mBlocks.end() );
+        mCounters.retained -= it->second.size;
+        ++mCounters.evictions;
+        systemFree( p, it->second );
+        mBlocks.erase( it );
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Give cached buffers back to the OS (oldest first) until no more
+ *  than keep bytes are retained (by default, all of them).
+ */
+void BufferPool::trim ( const size_t keep ) {
+    Lock  l( mMutex );
+    evict( keep );
+}
+//---------------------------------------------------------------------------
+/** \brief Set the max number of bytes of free buffers kept for reuse.
+ */
+void BufferPool::setMaxRetained ( const size_t bytes ) {
+    Lock  l( mMutex );
+    mMaxRetained = bytes;
+    evict( mMaxRetained );
+}
+//---------------------------------------------------------------------------
+BufferPool::Counters BufferPool::getCounters ( void ) {
+    Lock  l( mMutex );
+    return mCounters;
+}
+//---------------------------------------------------------------------------
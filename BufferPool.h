@@ -0,0 +1,103 @@
+/**
+    \file BufferPool.h
+    Definition of the BufferPool class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef BufferPool_h
+#define BufferPool_h
+
+#include  <stddef.h>
+#include  <list>
+#include  <map>
+#include  "ThreadPool.h"
+//----------------------------------------------------------------------
+/** \brief Pool of large memory buffers (image pixels, display buffers)
+ *  shared by all documents and views.
+ *
+ *  Released buffers are not returned to the system but kept (up to a
+ *  limit) and handed out again to the next request of the same size
+ *  class.  Since those pages have already been touched, reopening an
+ *  image of the same size costs neither allocation nor page faults.
+ *  Large buffers come straight from the OS (mmap or VirtualAlloc) and
+ *  may be backed by huge pages.
+ *
+ *  Small requests (below the pooling threshold) simply use malloc.
+ */
+class BufferPool {
+public:
+    /// usage counters.
+    struct Counters {
+        long    hits;          ///< requests satisfied from the pool
+        long    misses;        ///< requests that allocated new memory
+        long    releases;      ///< buffers returned
+        long    evictions;     ///< cached buffers given back to the OS
+        size_t  retained;      ///< bytes cached (free, ready for reuse)
+        size_t  outstanding;   ///< bytes handed out (in use)
+    };
+
+    static BufferPool& instance ( void );
+
+    void*  allocate ( const size_t bytes );
+    void   release ( void* p );
+    void   trim ( const size_t keep=0 );
+
+    void   setMaxRetained ( const size_t bytes );
+    inline size_t getMaxRetained ( void ) const {  return mMaxRetained;  }
+    inline void   setHugePages ( const bool use ) {  mHugePages = use;  }
+    Counters getCounters ( void );
+
+    /// malloc compatible entry points (e.g., for pnmHelper::setAllocator).
+    static void* poolAllocate ( size_t bytes ) {
+        return instance().allocate( bytes );
+    }
+    static void  poolFree ( void* p ) {  instance().release( p );  }
+
+protected:
+    BufferPool ( );
+    ~BufferPool ( );
+
+    /// one buffer known to the pool.
+    struct Block {
+        size_t  size;     ///< usable (size class) bytes
+        int     kind;     ///< how it was obtained (see systemAlloc)
+    };
+
+    enum { Threshold = 256 * 1024 };   ///< smaller requests use malloc
+
+    Mutex                     mMutex;
+    std::map<void*, Block>    mBlocks;    ///< every pooled buffer
+    std::list<void*>          mFree;      ///< cached buffers, oldest first
+    size_t                    mMaxRetained;
+    bool                      mHugePages;
+    Counters                  mCounters;
+
+    static size_t sizeClass ( const size_t bytes );
+    void*  systemAlloc ( const size_t bytes, int* kind );
+    void   systemFree ( void* p, const Block& b );
+    void   evict ( const size_t keep );
+};
+
+#endif
+//----------------------------------------------------------------------
@@ -0,0 +1,129 @@
+/**
+    \file Colormap.cpp
+    Implementation of the Colormap class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <math.h>
+#include  <stddef.h>
+#include  <stdio.h>
+#include  "Colormap.h"
+#include  "TIFFWriter.h"
+
+/// viridis at 10 evenly spaced positions (interpolated in between).
+static const unsigned char  ViridisStops[10][3] = {
+    {  68,   1,  84 }, {  72,  40, 120 }, {  62,  73, 137 }, {  49, 104, 142 },
+    {  38, 130, 142 }, {  31, 158, 137 }, {  53, 183, 121 }, { 110, 206,  88 },
+    { 181, 222,  43 }, { 253, 231,  37 }
+};
+//---------------------------------------------------------------------------
+/// pack r,g,b (each clamped to 0..255) as BGRX.
+static inline unsigned int pack ( double r, double g, double b ) {
+    r = (r<0) ? 0 : (r>255 ? 255 : r);
+    g = (g<0) ? 0 : (g>255 ? 255 : g);
+    b = (b<0) ? 0 : (b>255 ? 255 : b);
+    return ((unsigned int)(r + 0.5) << 16) | ((unsigned int)(g + 0.5) << 8)
+         | (unsigned int)(b + 0.5);
+}
+//---------------------------------------------------------------------------
+/// one channel of a CLUT (8 or 16 bit table), clamped as TIFFWriter does.
+static int clutValue ( const int x, const int entries, const int first,
+                       const int bits, const uint8* t8, const uint16* t16 )
+{
+    if (entries<=0)    return x;
+    int  i = x - first;
+    if (i<0)           i = 0;
+    if (i>=entries)    i = entries - 1;
+    const int  v = (bits==16) ? t16[i] : t8[i];
+    return (v>255) ? 255 : v;
+}
+//===========================================================================
+Colormap::Colormap ( const int which ) {
+    set( which );
+}
+//---------------------------------------------------------------------------
+/** \brief Use a built in map (Gray, Hot, Jet, or Viridis).
+ */
+void Colormap::set ( const int which ) {
+    assert( which>=Gray && which<Custom );
+    mKind = which;
+    for (int i=0; i<256; i++) {
+        const double  t = i / 255.0;
+        switch (which) {
+            case Hot :
+                //black, red, yellow, white
+                mColors[i] = pack( 255*3*t, 255*(3*t - 1), 255*(3*t - 2) );
+                break;
+            case Jet :
+                //dark blue, blue, cyan, yellow, red, dark red
+                mColors[i] = pack( 255*(1.5 - fabs(4*t - 3)),
+                                   255*(1.5 - fabs(4*t - 2)),
+                                   255*(1.5 - fabs(4*t - 1)) );
+                break;
+            case Viridis : {
+                const double  p = t * 9;
+                const int     k = (p>=9) ? 8 : (int)p;
+                const double  f = p - k;
+                const unsigned char*  a = ViridisStops[k];
+                const unsigned char*  b = ViridisStops[k+1];
+                mColors[i] = pack( a[0] + f*(b[0]-a[0]), a[1] + f*(b[1]-a[1]),
+                                   a[2] + f*(b[2]-a[2]) );
+                break;
+            }
+            default :
+                mColors[i] = (unsigned int)i * 0x010101u;
+                break;
+        }
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Use the map defined by a CLUT (indexed by display value).  An
+ *  empty channel passes the display value through.
+ */
+void Colormap::setCLUT ( const CLUT& c ) {
+    mKind = Custom;
+    for (int i=0; i<256; i++) {
+        const int  r = clutValue( i, c.r_entries, c.r_first_value, c.r_num_bits,
+                                  c.r_table8, c.r_table16 );
+        const int  g = clutValue( i, c.g_entries, c.g_first_value, c.g_num_bits,
+                                  c.g_table8, c.g_table16 );
+        const int  b = clutValue( i, c.b_entries, c.b_first_value, c.b_num_bits,
+                                  c.b_table8, c.b_table16 );
+        mColors[i] = ((unsigned int)r << 16) | ((unsigned int)g << 8) | (unsigned int)b;
+    }
+}
+//---------------------------------------------------------------------------
+/// \returns a map's name (e.g., for the status bar).
+const char* Colormap::getName ( const int which ) {
+    switch (which) {
+        case Gray :     return "gray";
+        case Hot :      return "hot";
+        case Jet :      return "jet";
+        case Viridis :  return "viridis";
+        case Custom :   return "clut";
+    }
+    return "?";
+}
+//---------------------------------------------------------------------------
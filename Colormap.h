@@ -0,0 +1,62 @@
+/**
+    \file Colormap.h
+    Definition of the Colormap class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef Colormap_h
+#define Colormap_h
+
+class CLUT;
+//----------------------------------------------------------------------
+/** \brief Pseudo color map: a BGRX pixel for each 8 bit display value.
+ *
+ *  Built in maps (gray, hot, jet, and viridis) or one defined by a CLUT
+ *  (as used when writing color tiff files).  DisplayLUT folds the map into
+ *  its table, so showing a gray image in color costs nothing extra.
+ */
+class Colormap {
+public:
+    /// which map.
+    enum { Gray, Hot, Jet, Viridis, Custom, Count };
+
+    Colormap ( const int which=Gray );
+
+    void set ( const int which );
+    void setCLUT ( const CLUT& c );
+
+    /// \returns the BGRX pixel for a display value (0..255).
+    inline unsigned int get ( const int g ) const {  return mColors[g];  }
+    inline const unsigned int* getColors ( void ) const {  return mColors;  }
+    inline int  getKind ( void ) const {  return mKind;  }
+    inline bool isGray  ( void ) const {  return mKind==Gray;  }
+    static const char* getName ( const int which );
+
+protected:
+    unsigned int  mColors[256];  ///< BGRX pixel per display value
+    int           mKind;         ///< one of the above
+};
+
+#endif
+//----------------------------------------------------------------------
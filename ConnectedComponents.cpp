@@ -0,0 +1,410 @@
+/**
+    \file ConnectedComponents.cpp
+    Implementation of the ConnectedComponents class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <limits.h>
+#include  <algorithm>
+#include  "BitImage.h"
+#include  "ConnectedComponents.h"
+#include  "ThreadPool.h"
+
+typedef ConnectedComponents::Component  Component;
+//---------------------------------------------------------------------------
+/// a component's sums (while labeling).
+struct Acc {
+    int        area;
+    int        left, top, right, bottom;
+    long long  sx, sy;
+
+    inline void clear ( void ) {
+        area = 0;
+        left = top = INT_MAX;
+        right = bottom = INT_MIN;
+        sx = sy = 0;
+    }
+    inline void add ( const int x, const int y ) {
+        area++;
+        if (x<left)      left = x;
+        if (x>right)     right = x;
+        if (y<top)       top = y;
+        if (y>bottom)    bottom = y;
+        sx += x;
+        sy += y;
+    }
+    inline void add ( const Acc& o ) {
+        area += o.area;
+        if (o.left<left)        left = o.left;
+        if (o.right>right)      right = o.right;
+        if (o.top<top)          top = o.top;
+        if (o.bottom>bottom)    bottom = o.bottom;
+        sx += o.sx;
+        sy += o.sy;
+    }
+};
+//---------------------------------------------------------------------------
+/// foreground test of an int image.
+struct IntMask {
+    const int*  mSrc;
+    inline bool operator() ( const size_t i, const int x, const int y ) const {
+        return mSrc[i]!=0;
+    }
+};
+//---------------------------------------------------------------------------
+/// foreground test of a packed binary image.
+struct BitMask {
+    const BitImage*  mSrc;
+    inline bool operator() ( const size_t i, const int x, const int y ) const {
+        return mSrc->get( x, y );
+    }
+};
+//---------------------------------------------------------------------------
+/// \returns the root of i (halving the path to it).
+static inline int findRoot ( int* L, int i ) {
+    for ( ; ; ) {
+        const int  p = L[i] - 1;
+        if (p==i)    return i;
+        L[i] = L[p];
+        i = L[p] - 1;
+    }
+}
+//---------------------------------------------------------------------------
+/// \returns the root of i (without changing the forest).
+static inline int findRootConst ( const int* L, int i ) {
+    while (L[i]-1 != i)    i = L[i] - 1;
+    return i;
+}
+//---------------------------------------------------------------------------
+/// merge the sets of a and b (the smaller root becomes the root).
+static inline void unite ( int* L, const int a, const int b ) {
+    const int  ra = findRoot( L, a );
+    const int  rb = findRoot( L, b );
+    if (ra<rb)         L[rb] = ra + 1;
+    else if (rb<ra)    L[ra] = rb + 1;
+}
+//---------------------------------------------------------------------------
+/// add foreground neighbor n to i's set (or start i's set with it).
+static inline void join ( int* L, const size_t i, const size_t n,
+                          bool& linked )
+{
+    if (!linked) {
+        L[i] = L[n];
+        linked = true;
+    } else {
+        unite( L, (int)i, (int)n );
+    }
+}
+//---------------------------------------------------------------------------
+/// state shared by the passes (bands of rows).
+struct Labeling {
+    int*   L;
+    int    w, h;
+    bool   eight;
+    int    bands;
+    std::vector< std::vector<int> >  roots;    ///< per band (raster order)
+    std::vector<int>                 offsets;  ///< labels before each band
+    Acc*   table;                              ///< per label (or NULL)
+    std::vector< std::vector<int> >  foreign;     ///< earlier bands' labels in a band
+    std::vector< std::vector<Acc> >  foreignAcc;  ///< their sums (in that band)
+
+    inline int bandStart ( const int b ) const {
+        return (int)((long long)h * b / bands);
+    }
+};
+//---------------------------------------------------------------------------
+/// first pass: label bands [begin,end) on their own.
+template <class Mask>
+class LocalPass : public ThreadPool::RangeTask {
+public:
+    Labeling&  s;
+    Mask       mMask;
+    LocalPass ( Labeling& l, const Mask& m ) : s( l ), mMask( m ) { }
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        int*  L = s.L;
+        const int  w = s.w;
+        for (int b=begin; b<end; b++) {
+            const int  y0 = s.bandStart( b ), y1 = s.bandStart( b+1 );
+            for (int y=y0; y<y1; y++) {
+                size_t  i = (size_t)y * w;
+                for (int x=0; x<w; x++, i++) {
+                    if (!mMask( i, x, y )) {
+                        L[i] = 0;
+                        continue;
+                    }
+                    bool  linked = (x>0 && L[i-1]!=0);
+                    L[i] = linked ? L[i-1] : (int)i + 1;
+                    if (y==y0)    continue;
+                    const size_t  n = i - w;
+                    if (L[n]!=0) {
+                        join( L, i, n, linked );
+                    } else if (s.eight) {
+                        //(if n is foreground, its neighbors are in its set)
+                        if (x>0 && L[n-1]!=0)      join( L, i, n-1, linked );
+                        if (x<w-1 && L[n+1]!=0)    join( L, i, n+1, linked );
+                    }
+                }
+            }
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// second pass: point every pixel of bands [begin,end) at its root.
+class FlattenPass : public ThreadPool::RangeTask {
+public:
+    Labeling&  s;
+    FlattenPass ( Labeling& l ) : s( l ) { }
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        int*  L = s.L;
+        for (int b=begin; b<end; b++) {
+            std::vector<int>&  roots = s.roots[b];
+            roots.clear();
+            const int  b0 = s.bandStart( b ) * s.w;
+            const int  e  = s.bandStart( b+1 ) * s.w;
+            //parents precede their children, so (in raster order) a parent
+            //in this band already points at its root.  (other bands only
+            //ever see a pixel's parent replaced by an ancestor, so the
+            //roots found there are the same.)
+            for (int i=b0; i<e; i++) {
+                if (L[i]==0)    continue;
+                const int  p = L[i] - 1;
+                if (p==i) {
+                    roots.push_back( i );
+                } else if (p>=b0) {
+                    L[i] = L[p];
+                } else {
+                    L[i] = findRootConst( L, p ) + 1;
+                }
+            }
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// third pass: number the roots of bands [begin,end) (stored negated).
+class NumberPass : public ThreadPool::RangeTask {
+public:
+    Labeling&  s;
+    NumberPass ( Labeling& l ) : s( l ) { }
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        for (int b=begin; b<end; b++) {
+            const std::vector<int>&  roots = s.roots[b];
+            for (size_t k=0; k<roots.size(); k++)
+                s.L[ roots[k] ] = -(s.offsets[b] + (int)k + 1);
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// fourth pass: label the other pixels of bands [begin,end) and sum them.
+class RelabelPass : public ThreadPool::RangeTask {
+public:
+    Labeling&  s;
+    RelabelPass ( Labeling& l ) : s( l ) { }
+
+    /// \returns the label of a (flattened) foreground pixel.
+    inline int labelOf ( const int v ) const {
+        return (v<0) ? -v : -s.L[v-1];
+    }
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        int*  L = s.L;
+        const int  w = s.w;
+        for (int b=begin; b<end; b++) {
+            const int  y0 = s.bandStart( b ), y1 = s.bandStart( b+1 );
+            const int  own = s.offsets[b] + 1;  //first label rooted here
+            std::vector<int>&  foreign = s.foreign[b];
+            std::vector<Acc>&  foreignAcc = s.foreignAcc[b];
+            if (s.table!=NULL) {
+                for (size_t k=0; k<s.roots[b].size(); k++)
+                    s.table[ own - 1 + k ].clear();
+                //components rooted earlier enter through the first row
+                const int*  row = L + (size_t)y0 * w;
+                for (int x=0; x<w; x++)
+                    if (row[x]!=0 && labelOf( row[x] ) < own)
+                        foreign.push_back( labelOf( row[x] ) );
+                std::sort( foreign.begin(), foreign.end() );
+                foreign.erase( std::unique( foreign.begin(), foreign.end() ),
+                               foreign.end() );
+                foreignAcc.resize( foreign.size() );
+                for (size_t k=0; k<foreignAcc.size(); k++)    foreignAcc[k].clear();
+            }
+            int   lastV = 0, label = 0;  //(runs share a root)
+            int   lastLabel = 0;
+            Acc*  last = NULL;
+            for (int y=y0; y<y1; y++) {
+                size_t  i = (size_t)y * w;
+                for (int x=0; x<w; x++, i++) {
+                    const int  v = L[i];
+                    if (v==0)    continue;
+                    if (v!=lastV) {
+                        lastV = v;
+                        label = labelOf( v );
+                    }
+                    if (v>0)    L[i] = label;  //(roots are decoded later)
+                    if (s.table==NULL)    continue;
+                    if (label!=lastLabel) {
+                        lastLabel = label;
+                        if (label >= own) {
+                            last = &s.table[ label-1 ];
+                        } else {
+                            const size_t  k = std::lower_bound( foreign.begin(),
+                                foreign.end(), label ) - foreign.begin();
+                            last = &foreignAcc[k];
+                        }
+                    }
+                    last->add( x, y );
+                }
+            }
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// last pass: decode the roots of bands [begin,end).
+class DecodePass : public ThreadPool::RangeTask {
+public:
+    Labeling&  s;
+    DecodePass ( Labeling& l ) : s( l ) { }
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        for (int b=begin; b<end; b++) {
+            const std::vector<int>&  roots = s.roots[b];
+            for (size_t k=0; k<roots.size(); k++)
+                s.L[ roots[k] ] = -s.L[ roots[k] ];
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// label (after the caller's LocalPass) and build the table.
+template <class Mask>
+static int labelAll ( const Mask& mask, const int w, const int h,
+                      int* const labels, const bool eight,
+                      std::vector<Component>* table )
+{
+    assert( labels!=NULL && w>0 && h>0 );
+    assert( (long long)w * h < INT_MAX );
+    ThreadPool&  pool = ThreadPool::instance();
+    Labeling  s;
+    s.L = labels;    s.w = w;    s.h = h;    s.eight = eight;
+    s.bands = std::min( h, pool.getThreadCount() * 4 );
+    s.roots.resize( s.bands );
+    s.offsets.resize( s.bands );
+    s.foreign.resize( s.bands );
+    s.foreignAcc.resize( s.bands );
+    s.table = NULL;
+
+    LocalPass<Mask>  local( s, mask );
+    pool.parallelFor( s.bands, local, 1 );
+    //merge across the seams (a row per band, so this is quick)
+    for (int b=1; b<s.bands; b++) {
+        const int  y = s.bandStart( b );
+        for (int x=0; x<w; x++) {
+            const size_t  i = (size_t)y * w + x, n = i - w;
+            if (labels[i]==0)    continue;
+            if (labels[n]!=0) {
+                unite( labels, (int)i, (int)n );
+            } else if (eight) {
+                if (x>0 && labels[n-1]!=0)      unite( labels, (int)i, (int)n-1 );
+                if (x<w-1 && labels[n+1]!=0)    unite( labels, (int)i, (int)n+1 );
+            }
+        }
+    }
+    FlattenPass  flatten( s );
+    pool.parallelFor( s.bands, flatten, 1 );
+    int  count = 0;
+    for (int b=0; b<s.bands; b++) {
+        s.offsets[b] = count;
+        count += (int)s.roots[b].size();
+    }
+    std::vector<Acc>  sums;
+    if (table!=NULL && count>0) {
+        sums.resize( count );
+        s.table = &sums[0];
+    }
+    NumberPass  number( s );
+    pool.parallelFor( s.bands, number, 1 );
+    RelabelPass  relabel( s );
+    pool.parallelFor( s.bands, relabel, 1 );
+    DecodePass  decode( s );
+    pool.parallelFor( s.bands, decode, 1 );
+
+    if (table!=NULL) {
+        for (int b=0; b<s.bands; b++)
+            for (size_t k=0; k<s.foreign[b].size(); k++)
+                sums[ s.foreign[b][k] - 1 ].add( s.foreignAcc[b][k] );
+        table->resize( count );
+        for (int l=0; l<count; l++) {
+            const Acc&  a = sums[l];
+            Component&  c = (*table)[l];
+            c.area = a.area;
+            c.left = a.left;    c.top = a.top;
+            c.right = a.right;  c.bottom = a.bottom;
+            c.cx = (double)a.sx / a.area;
+            c.cy = (double)a.sy / a.area;
+        }
+    }
+    return count;
+}
+//===========================================================================
+/** \brief Label the connected components of an image.
+ *  \param src w*h pixels (nonzero is foreground)
+ *  \param w image width
+ *  \param h image height
+ *  \param labels receives w*h labels (may be src)
+ *  \param eight 8 connectivity (otherwise, 4)
+ *  \param table if not NULL, receives the components (element l-1 is
+ *  label l)
+ *  \returns the number of components.
+ */
+int ConnectedComponents::label ( const int* const src, const int w,
+                                 const int h, int* const labels,
+                                 const bool eight,
+                                 std::vector<Component>* table )
+{
+    assert( src!=NULL );
+    IntMask  m;
+    m.mSrc = src;
+    return labelAll( m, w, h, labels, eight, table );
+}
+//---------------------------------------------------------------------------
+/** \brief Label the connected components of a packed binary image.
+ *  \param src the image (set pixels are foreground)
+ *  \param labels receives src.getW()*src.getH() labels
+ *  \param eight 8 connectivity (otherwise, 4)
+ *  \param table if not NULL, receives the components (element l-1 is
+ *  label l)
+ *  \returns the number of components.
+ */
+int ConnectedComponents::label ( const BitImage& src, int* const labels,
+                                 const bool eight,
+                                 std::vector<Component>* table )
+{
+    assert( !src.empty() );
+    BitMask  m;
+    m.mSrc = &src;
+    return labelAll( m, src.getW(), src.getH(), labels, eight, table );
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,67 @@
+/**
+    \file ConnectedComponents.h
+    Definition of the ConnectedComponents class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef ConnectedComponents_h
+#define ConnectedComponents_h
+
+#include  <stddef.h>
+#include  <vector>
+
+class BitImage;
+//----------------------------------------------------------------------
+/** \brief Connected component labeling (4 or 8 connectivity) of binary
+ *  images, with a table of the components' area, bounding box, and
+ *  centroid.
+ *
+ *  Nonzero pixels are foreground.  Components are numbered 1, 2, ... in
+ *  raster order of their first pixel, and background pixels are labeled
+ *  0.  The label image is an int per pixel, so it may be written with,
+ *  e.g., pnmHelper::write_raw_pgm_data32.
+ *
+ *  The label image itself holds the union-find forest (a pixel's label is
+ *  its parent's index + 1, and the root of a component is its first
+ *  pixel), so no other per-pixel memory is needed.  Bands of rows are
+ *  labeled in parallel, the seams between them are merged, and then the
+ *  bands are relabeled in parallel, accumulating the table as they go.
+ */
+class ConnectedComponents {
+public:
+    /// a component (label l is element l-1 of the table).
+    struct Component {
+        int     area;                       ///< number of pixels
+        int     left, top, right, bottom;   ///< bounding box (inclusive)
+        double  cx, cy;                     ///< centroid
+    };
+
+    static int label ( const int* const src, const int w, const int h,
+                       int* const labels, const bool eight,
+                       std::vector<Component>* table=NULL );
+    static int label ( const BitImage& src, int* const labels,
+                       const bool eight, std::vector<Component>* table=NULL );
+};
+
+#endif
@@ -0,0 +1,458 @@
+/**
+    \file Convolution.cpp
+    Implementation of the Convolution class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <math.h>
+#include  <string.h>
+#include  <vector>
+#include  "BufferPool.h"
+#include  "Convolution.h"
+#include  "Simd.h"
+#include  "ThreadPool.h"
+
+const double  Convolution::RecursiveSigma = 4.0;
+
+/// rows per band (at least).
+static const int  BandRows = 64;
+/// samples per strip of the vertical passes.
+static const int  StripSamples = 1024;
+/// samples per strip of the recursive vertical pass.
+static const int  IIRStripSamples = 64;
+//---------------------------------------------------------------------------
+/// \returns i clamped to 0..n-1.
+static inline int clamp ( const int i, const int n ) {
+    return (i<0) ? 0 : (i>=n ? n-1 : i);
+}
+//---------------------------------------------------------------------------
+/** \brief d[i] = s[i] rounded to the nearest integer (halves away from
+ *  0) for n values.  Both paths round the same way, so a result doesn't
+ *  depend on its column.
+ */
+static inline void storeRounded ( const float* s, int* d, const int n ) {
+    int  i = 0;
+#ifdef USE_SSE2
+    //(add 0.5 with the sign of the value, then truncate)
+    const __m128  sign = _mm_set1_ps( -0.0f ), half = _mm_set1_ps( 0.5f );
+    for ( ; i+4<=n; i+=4) {
+        const __m128  v = _mm_loadu_ps( s+i );
+        const __m128  h = _mm_or_ps( _mm_and_ps( v, sign ), half );
+        _mm_storeu_si128( (__m128i*)(d+i), _mm_cvttps_epi32( _mm_add_ps( v, h ) ) );
+    }
+#endif
+    for ( ; i<n; i++)
+        d[i] = (s[i] >= 0) ? (int)(s[i] + 0.5f) : -(int)(0.5f - s[i]);
+}
+//---------------------------------------------------------------------------
+/// out[i] = sum of k[j] * in[i + j*step] (j in 0..taps-1) for count values.
+static inline void correlate ( const float* in, const int count,
+                               const int step, const float* k,
+                               const int taps, float* out )
+{
+    int  i = 0;
+#ifdef USE_SSE2
+    for ( ; i+4<=count; i+=4) {
+        const float*  p = in + i;
+        __m128  acc = _mm_mul_ps( _mm_set1_ps( k[0] ), _mm_loadu_ps( p ) );
+        for (int j=1; j<taps; j++)
+            acc = _mm_add_ps( acc, _mm_mul_ps( _mm_set1_ps( k[j] ),
+                                               _mm_loadu_ps( p + j*step ) ) );
+        _mm_storeu_ps( out + i, acc );
+    }
+#endif
+    for ( ; i<count; i++) {
+        float  acc = 0;
+        for (int j=0; j<taps; j++)    acc += k[j] * in[i + j*step];
+        out[i] = acc;
+    }
+}
+//---------------------------------------------------------------------------
+/// y[i] = a * x[i] (or y[i] += a * x[i]) for n values.
+static inline void axpy ( const float a, const float* x, float* y,
+                          const int n, const bool first )
+{
+    int  i = 0;
+#ifdef USE_SSE2
+    const __m128  va = _mm_set1_ps( a );
+    if (first) {
+        for ( ; i+4<=n; i+=4)
+            _mm_storeu_ps( y+i, _mm_mul_ps( va, _mm_loadu_ps( x+i ) ) );
+    } else {
+        for ( ; i+4<=n; i+=4)
+            _mm_storeu_ps( y+i, _mm_add_ps( _mm_loadu_ps( y+i ),
+                                            _mm_mul_ps( va, _mm_loadu_ps( x+i ) ) ) );
+    }
+#endif
+    if (first)    for ( ; i<n; i++)    y[i] = a * x[i];
+    else          for ( ; i<n; i++)    y[i] += a * x[i];
+}
+//===========================================================================
+/// separable kernel over bands [begin,end).
+class SeparablePass : public ThreadPool::RangeTask {
+public:
+    const int*    mSrc;
+    int*          mDst;
+    int           mW, mH, mSpp, mBand;
+    const float*  mKx;
+    const float*  mKy;
+    int           mRx, mRy;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const int  n = mW * mSpp;  //samples per row
+        std::vector<float>  pad( (size_t)(mW + 2*mRx) * mSpp );
+        std::vector<float>  rows( (size_t)(mBand + 2*mRy) * n );
+        std::vector<float>  acc( StripSamples );
+        for (int b=begin; b<end; b++) {
+            const int  y0 = b * mBand;
+            const int  y1 = (y0 + mBand < mH) ? y0 + mBand : mH;
+            const int  lo = (y0 - mRy > 0) ? y0 - mRy : 0;
+            const int  hi = (y1 - 1 + mRy < mH) ? y1 - 1 + mRy : mH - 1;
+            //horizontal: rows lo..hi (each once, even if the edge repeats)
+            for (int y=lo; y<=hi; y++) {
+                const int*  s = mSrc + (size_t)y * n;
+                for (int x=-mRx; x<mW+mRx; x++) {
+                    const int*  p = s + (size_t)clamp( x, mW ) * mSpp;
+                    float*      d = &pad[ (size_t)(x + mRx) * mSpp ];
+                    for (int c=0; c<mSpp; c++)    d[c] = (float)p[c];
+                }
+                correlate( &pad[0], n, mSpp, mKx, 2*mRx+1,
+                           &rows[ (size_t)(y - lo) * n ] );
+            }
+            //vertical: a strip at a time (its rows stay in cache)
+            for (int c0=0; c0<n; c0+=StripSamples) {
+                const int  m = (n - c0 < StripSamples) ? n - c0 : StripSamples;
+                for (int y=y0; y<y1; y++) {
+                    for (int j=0; j<=2*mRy; j++) {
+                        const int  r = clamp( y - mRy + j, mH ) - lo;
+                        axpy( mKy[j], &rows[ (size_t)r * n + c0 ], &acc[0], m,
+                              j==0 );
+                    }
+                    storeRounded( &acc[0], mDst + (size_t)y * n + c0, m );
+                }
+            }
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// Young/van Vliet recursive gaussian coefficients.
+struct Recursive {
+    float  B, a1, a2, a3;
+    float  M[3][3];  ///< backward start (see end)
+
+    Recursive ( const double sigma ) {
+        const double  q = (sigma >= 2.5) ? 0.98711 * sigma - 0.96330
+                                         : 3.97156 - 4.14554 * sqrt( 1 - 0.26891 * sigma );
+        const double  q2 = q * q, q3 = q2 * q;
+        const double  b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+        const double  b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+        const double  b2 = -(1.4281 * q2 + 1.26661 * q3);
+        const double  b3 = 0.422205 * q3;
+        const double  d1 = b1 / b0, d2 = b2 / b0, d3 = b3 / b0;
+        const double  dB = 1 - (d1 + d2 + d3);
+        a1 = (float)d1;    a2 = (float)d2;    a3 = (float)d3;    B = (float)dB;
+        //where the input repeats its last value u, the backward states
+        //after the end are u plus M times the last forward states' excess
+        //over u (Triggs/Sdika).  M is found by running each excess out
+        //(with 0 input) until it has died away, and then back.
+        const int  n = (int)(40 * q) + 100;
+        std::vector<double>  t( n + 3 );
+        for (int k=0; k<3; k++) {
+            double  p[3] = { 0, 0, 0 };
+            p[k] = 1;
+            for (int i=0; i<n; i++) {
+                t[i] = d1 * p[0] + d2 * p[1] + d3 * p[2];
+                p[2] = p[1];    p[1] = p[0];    p[0] = t[i];
+            }
+            double  y1 = 0, y2 = 0, y3 = 0;
+            for (int i=n-1; i>=0; i--) {
+                const double  y = dB * t[i] + d1 * y1 + d2 * y2 + d3 * y3;
+                y3 = y2;    y2 = y1;    y1 = y;
+                if (i<3)    M[i][k] = (float)y;
+            }
+        }
+    }
+
+    /// the backward states (y[n], y[n+1], y[n+2]) for last input u and
+    /// last forward states w1=w[n-1], w2, w3.
+    inline void start ( const float u, const float w1, const float w2,
+                        const float w3, float* y ) const
+    {
+        for (int j=0; j<3; j++)
+            y[j] = u + M[j][0] * (w1 - u) + M[j][1] * (w2 - u) + M[j][2] * (w3 - u);
+    }
+
+    /// filter n values (step apart) forward and then backward, in place.
+    void line ( float* v, const int n, const int step ) const {
+        //(before the start, the recursion has settled to the first value)
+        float  p1 = v[0], p2 = p1, p3 = p1;
+        const float  u = v[(n-1)*step];
+        for (int i=0; i<n; i++) {
+            const float  o = B * v[i*step] + a1 * p1 + a2 * p2 + a3 * p3;
+            p3 = p2;    p2 = p1;    p1 = o;
+            v[i*step] = o;
+        }
+        float  y[3];
+        start( u, p1, p2, p3, y );
+        p1 = y[0];    p2 = y[1];    p3 = y[2];
+        for (int i=n-1; i>=0; i--) {
+            const float  o = B * v[i*step] + a1 * p1 + a2 * p2 + a3 * p3;
+            p3 = p2;    p2 = p1;    p1 = o;
+            v[i*step] = o;
+        }
+    }
+
+    /// d[i] = B*x[i] + a1*p1[i] + a2*p2[i] + a3*p3[i] for n values (d may be x).
+    void step ( const float* x, const float* p1, const float* p2,
+                const float* p3, float* d, const int n ) const
+    {
+        int  i = 0;
+#ifdef USE_SSE2
+        const __m128  vB = _mm_set1_ps( B ), v1 = _mm_set1_ps( a1 );
+        const __m128  v2 = _mm_set1_ps( a2 ), v3 = _mm_set1_ps( a3 );
+        for ( ; i+4<=n; i+=4) {
+            __m128  o = _mm_mul_ps( vB, _mm_loadu_ps( x+i ) );
+            o = _mm_add_ps( o, _mm_mul_ps( v1, _mm_loadu_ps( p1+i ) ) );
+            o = _mm_add_ps( o, _mm_mul_ps( v2, _mm_loadu_ps( p2+i ) ) );
+            o = _mm_add_ps( o, _mm_mul_ps( v3, _mm_loadu_ps( p3+i ) ) );
+            _mm_storeu_ps( d+i, o );
+        }
+#endif
+        for ( ; i<n; i++)
+            d[i] = B * x[i] + a1 * p1[i] + a2 * p2[i] + a3 * p3[i];
+    }
+};
+//---------------------------------------------------------------------------
+/// recursive gaussian along rows [begin,end) (into the float image).
+class RecursiveRowPass : public ThreadPool::RangeTask {
+public:
+    const int*        mSrc;
+    float*            mTmp;
+    int               mW, mSpp;
+    const Recursive*  mR;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const size_t  n = (size_t)mW * mSpp;
+        for (int y=begin; y<end; y++) {
+            const int*  s = mSrc + y * n;
+            float*      t = mTmp + y * n;
+            for (size_t i=0; i<n; i++)    t[i] = (float)s[i];
+            for (int c=0; c<mSpp; c++)    mR->line( t + c, mW, mSpp );
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// recursive gaussian along the columns of strips [begin,end) (a row of a
+/// strip at a time), rounded into dst.
+class RecursiveColumnPass : public ThreadPool::RangeTask {
+public:
+    float*            mTmp;
+    int*              mDst;
+    int               mN, mH;  ///< samples per row, rows
+    const Recursive*  mR;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        float  first[IIRStripSamples], last[IIRStripSamples];
+        float  after[3][IIRStripSamples];
+        for (int s=begin; s<end; s++) {
+            const int  c0 = s * IIRStripSamples;
+            const int  m  = (mN - c0 < IIRStripSamples) ? mN - c0 : IIRStripSamples;
+            //forward (rows before the first repeat it)
+            memcpy( first, row( 0, c0 ), m * sizeof(float) );
+            memcpy( last, row( mH-1, c0 ), m * sizeof(float) );
+            for (int y=0; y<mH; y++)
+                mR->step( row( y, c0 ), y>=1 ? row( y-1, c0 ) : first,
+                          y>=2 ? row( y-2, c0 ) : first,
+                          y>=3 ? row( y-3, c0 ) : first, row( y, c0 ), m );
+            //backward (rows after the last repeat it)
+            const float*  w1 = row( mH-1, c0 );
+            const float*  w2 = (mH>=2) ? row( mH-2, c0 ) : first;
+            const float*  w3 = (mH>=3) ? row( mH-3, c0 ) : first;
+            for (int i=0; i<m; i++) {
+                float  y[3];
+                mR->start( last[i], w1[i], w2[i], w3[i], y );
+                after[0][i] = y[0];    after[1][i] = y[1];    after[2][i] = y[2];
+            }
+            for (int y=mH-1; y>=0; y--)
+                mR->step( row( y, c0 ), y+1<mH ? row( y+1, c0 ) : after[0],
+                          y+2<mH ? row( y+2, c0 ) : after[y+2-mH],
+                          y+3<mH ? row( y+3, c0 ) : after[y+3-mH], row( y, c0 ), m );
+            for (int y=0; y<mH; y++)
+                storeRounded( row( y, c0 ), mDst + (size_t)y * mN + c0, m );
+        }
+    }
+
+    inline float* row ( const int y, const int c0 ) const {
+        return mTmp + (size_t)y * mN + c0;
+    }
+};
+//---------------------------------------------------------------------------
+/// box (mean) over bands [begin,end) with running sums.
+class BoxPass : public ThreadPool::RangeTask {
+public:
+    const int*  mSrc;
+    int*        mDst;
+    int         mW, mH, mSpp, mBand, mRx, mRy;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const int  n = mW * mSpp;
+        std::vector<long long>  col( n ), add( n ), sub( n );
+        const double  scale = 1.0 / ((2.0*mRx + 1) * (2.0*mRy + 1));
+        for (int b=begin; b<end; b++) {
+            const int  y0 = b * mBand;
+            const int  y1 = (y0 + mBand < mH) ? y0 + mBand : mH;
+            //column sums of the row sums of the first window
+            rowSums( y0 - mRy, &col[0] );
+            for (int j=y0-mRy+1; j<=y0+mRy; j++) {
+                rowSums( j, &add[0] );
+                for (int i=0; i<n; i++)    col[i] += add[i];
+            }
+            for (int y=y0; y<y1; y++) {
+                int*  d = mDst + (size_t)y * n;
+                for (int i=0; i<n; i++)
+                    d[i] = (int)floor( col[i] * scale + 0.5 );
+                if (y+1==y1)    break;
+                //slide the window down a row
+                rowSums( y + mRy + 1, &add[0] );
+                rowSums( y - mRy, &sub[0] );
+                for (int i=0; i<n; i++)    col[i] += add[i] - sub[i];
+            }
+        }
+    }
+
+    /// sums of the horizontal windows of row y (clamped) into d.
+    void rowSums ( const int y, long long* d ) const {
+        const int*  s = mSrc + (size_t)clamp( y, mH ) * mW * mSpp;
+        for (int c=0; c<mSpp; c++) {
+            long long  sum = 0;
+            for (int x=-mRx; x<=mRx; x++)    sum += s[ clamp( x, mW ) * mSpp + c ];
+            d[c] = sum;
+            for (int x=1; x<mW; x++) {
+                sum += s[ clamp( x + mRx, mW ) * mSpp + c ]
+                     - s[ clamp( x - mRx - 1, mW ) * mSpp + c ];
+                d[ x * mSpp + c ] = sum;
+            }
+        }
+    }
+};
+//===========================================================================
+/** \brief Filter with a separable kernel (kx along rows, then ky along
+ *  columns), i.e., dst(x,y) is the sum of kx[i] * ky[j] * src(x-rx+i,
+ *  y-ry+j).
+ *  \param src w*h pixels (spp samples each)
+ *  \param w image width
+ *  \param h image height
+ *  \param spp samples per pixel (1 or 3)
+ *  \param dst receives w*h pixels
+ *  \param kx 2*rx+1 weights
+ *  \param rx radius of kx
+ *  \param ky 2*ry+1 weights
+ *  \param ry radius of ky
+ */
+void Convolution::separable ( const int* const src, const int w,
+                              const int h, const int spp, int* const dst,
+                              const float* const kx, const int rx,
+                              const float* const ky, const int ry )
+{
+    assert( src!=NULL && dst!=NULL && src!=dst && w>0 && h>0 );
+    assert( spp==1 || spp==3 );
+    assert( kx!=NULL && ky!=NULL && rx>=0 && ry>=0 );
+    SeparablePass  p;
+    p.mSrc = src;    p.mDst = dst;    p.mW = w;    p.mH = h;    p.mSpp = spp;
+    p.mKx = kx;      p.mRx = rx;      p.mKy = ky;   p.mRy = ry;
+    //(bands much taller than the kernel, so little is filtered twice)
+    p.mBand = (4*ry > BandRows) ? 4*ry : BandRows;
+    ThreadPool::instance().parallelFor( (h + p.mBand - 1) / p.mBand, p, 1 );
+}
+//---------------------------------------------------------------------------
+/** \brief Gaussian smoothing (sampled for sigmas below RecursiveSigma, and
+ *  recursive otherwise).
+ *  \param src w*h pixels (spp samples each)
+ *  \param w image width
+ *  \param h image height
+ *  \param spp samples per pixel (1 or 3)
+ *  \param dst receives w*h pixels
+ *  \param sigma standard deviation (in pixels; 0 copies)
+ *  \returns false if there isn't enough memory (for the recursive
+ *  filter's w*h float intermediate).
+ */
+bool Convolution::gaussian ( const int* const src, const int w, const int h,
+                             const int spp, int* const dst,
+                             const double sigma )
+{
+    assert( src!=NULL && dst!=NULL && src!=dst && w>0 && h>0 );
+    assert( (spp==1 || spp==3) && sigma>=0 );
+    if (sigma < RecursiveSigma) {
+        const int  r = (int)ceil( 3 * sigma );
+        std::vector<float>  k( 2*r + 1 );
+        double  sum = 0;
+        for (int i=-r; i<=r; i++)    sum += exp( -i * i / (2 * sigma * sigma) );
+        for (int i=-r; i<=r; i++)
+            k[i+r] = (r==0) ? 1.0f : (float)(exp( -i * i / (2 * sigma * sigma) ) / sum);
+        separable( src, w, h, spp, dst, &k[0], r, &k[0], r );
+        return true;
+    }
+    const size_t  n = (size_t)w * spp;
+    BufferPool&  buffers = BufferPool::instance();
+    float*  tmp = (float*)buffers.allocate( n * h * sizeof(float) );
+    if (tmp==NULL)    return false;
+    const Recursive  r( sigma );
+    ThreadPool&  pool = ThreadPool::instance();
+    RecursiveRowPass  rows;
+    rows.mSrc = src;    rows.mTmp = tmp;    rows.mW = w;    rows.mSpp = spp;
+    rows.mR = &r;
+    pool.parallelFor( h, rows, 4 );
+    RecursiveColumnPass  cols;
+    cols.mTmp = tmp;    cols.mDst = dst;    cols.mN = (int)n;    cols.mH = h;
+    cols.mR = &r;
+    pool.parallelFor( (int)((n + IIRStripSamples - 1) / IIRStripSamples), cols, 1 );
+    buffers.release( tmp );
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Box (mean) filter: each pixel becomes the (rounded) mean of the
+ *  (2*rx+1) x (2*ry+1) rectangle centered on it.
+ *  \param src w*h pixels (spp samples each)
+ *  \param w image width
+ *  \param h image height
+ *  \param spp samples per pixel (1 or 3)
+ *  \param dst receives w*h pixels
+ *  \param rx horizontal radius
+ *  \param ry vertical radius
+ */
+void Convolution::box ( const int* const src, const int w, const int h,
+                        const int spp, int* const dst, const int rx,
+                        const int ry )
+{
+    assert( src!=NULL && dst!=NULL && src!=dst && w>0 && h>0 );
+    assert( (spp==1 || spp==3) && rx>=0 && ry>=0 );
+    BoxPass  p;
+    p.mSrc = src;    p.mDst = dst;    p.mW = w;    p.mH = h;    p.mSpp = spp;
+    p.mRx = rx;      p.mRy = ry;
+    //(each band starts with 2*ry+1 rows of sums)
+    p.mBand = (4*ry > BandRows) ? 4*ry : BandRows;
+    ThreadPool::instance().parallelFor( (h + p.mBand - 1) / p.mBand, p, 1 );
+}
+//---------------------------------------------------------------------------
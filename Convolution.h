@@ -0,0 +1,67 @@
+/**
+    \file Convolution.h
+    Definition of the Convolution class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef Convolution_h
+#define Convolution_h
+
+//----------------------------------------------------------------------
+/** \brief Smoothing (and other separable) filters of gray or color
+ *  (interleaved rgb) images.
+ *
+ *  Separable kernels are applied along rows and then along columns in
+ *  float.  Bands of rows are processed in parallel: each band's rows
+ *  (plus the rows the kernel reaches above and below it) are filtered
+ *  horizontally into a private buffer, and the vertical pass then runs
+ *  over that buffer a strip of columns at a time, so the rows it
+ *  combines stay in cache.  Both passes use SSE2 (4 samples at a time).
+ *
+ *  Gaussians with small sigmas use a sampled kernel; larger ones use the
+ *  Young/van Vliet recursive (IIR) filter, whose cost doesn't depend on
+ *  sigma.  Box (mean) filters use running sums (exact, and also
+ *  independent of the size of the box).
+ *
+ *  Pixels outside the image repeat the edge of the image.  Results are
+ *  rounded to the nearest integer.  dst may not be src.
+ */
+class Convolution {
+public:
+    /// gaussians with at least this sigma use the recursive filter.
+    static const double  RecursiveSigma;
+
+    static void separable ( const int* const src, const int w, const int h,
+                            const int spp, int* const dst,
+                            const float* const kx, const int rx,
+                            const float* const ky, const int ry );
+    static bool gaussian  ( const int* const src, const int w, const int h,
+                            const int spp, int* const dst,
+                            const double sigma );
+    static void box       ( const int* const src, const int w, const int h,
+                            const int spp, int* const dst, const int rx,
+                            const int ry );
+};
+
+#endif
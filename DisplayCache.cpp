@@ -0,0 +1,203 @@
+/**
+    \file DisplayCache.cpp
+    Implementation of the DisplayCache class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <algorithm>
+#include  "BufferPool.h"
+#include  "DisplayCache.h"
+#include  "ThreadPool.h"
+//---------------------------------------------------------------------------
+DisplayCache::DisplayCache ( ) {
+    mCapacity = 64;
+    mBytes = 0;
+}
+//---------------------------------------------------------------------------
+/** \brief The caller must make sure that no tiles are being converted.
+ */
+DisplayCache::~DisplayCache ( ) {
+    clear();
+}
+//---------------------------------------------------------------------------
+/** \returns the cached tile (or NULL if not cached).
+ */
+DisplayCache::Tile* DisplayCache::find ( const int level, const int tx,
+                                         const int ty )
+{
+    std::map<Key, Tile*>::iterator  it = mTiles.find( makeKey(level, tx, ty) );
+    return (it==mTiles.end()) ? NULL : it->second;
+}
+//---------------------------------------------------------------------------
+/** \brief Get a tile (creating an Empty one if necessary).  It becomes the
+ *  most recently used.  Less recently used tiles may be discarded.
+ *  \param level pyramid level
+ *  \param tx tile column
+ *  \param ty tile row
+ *  \param levelW width of the level
+ *  \param levelH height of the level
+ *  \returns the tile (or NULL if out of memory).
+ */
+DisplayCache::Tile* DisplayCache::acquire ( const int level, const int tx,
+                                            const int ty, const int levelW,
+                                            const int levelH )
+{
+    Tile*  t = find( level, tx, ty );
+    if (t!=NULL) {
+        touch( t );
+        return t;
+    }
+    assert( tx*TileSize < levelW && ty*TileSize < levelH );
+    t = new Tile();
+    t->level = level;    t->tx = tx;    t->ty = ty;
+    t->x0 = tx * TileSize;    t->y0 = ty * TileSize;
+    t->w = (levelW - t->x0 < TileSize) ? levelW - t->x0 : TileSize;
+    t->h = (levelH - t->y0 < TileSize) ? levelH - t->y0 : TileSize;
+    t->state = Empty;
+    t->version = 0;
+    t->changed = false;
+    //make room first (so that the memory can be reused)
+    mLRU.push_back( t );
+    t->lru = --mLRU.end();
+    t->buffer = t->pixels = t->spare = t->target = NULL;
+    t->stride = t->w + 2;
+    mTiles[ makeKey(level, tx, ty) ] = t;
+    trim( t );
+    const size_t  bytes = bufferBytes( t );
+    t->buffer = (unsigned int*)BufferPool::instance().allocate( bytes );
+    if (t->buffer==NULL) {
+        discard( t );
+        return NULL;
+    }
+    t->pixels = t->target = t->buffer + t->stride + 1;
+    mBytes += bytes;
+    return t;
+}
+//---------------------------------------------------------------------------
+/// make a tile the most recently used.
+void DisplayCache::touch ( Tile* t ) {
+    mLRU.splice( mLRU.end(), mLRU, t->lru );
+}
+//---------------------------------------------------------------------------
+/** \brief Choose where a tile (being queued) is converted into: a
+ *  tile that has pixels is converted into its spare buffer, so that it
+ *  can still be drawn meanwhile (if there's no memory for one, it isn't
+ *  drawn until it's converted again).
+ */
+void DisplayCache::prepare ( Tile* t ) {
+    assert( t->state!=Queued );
+    if (t->version!=0 && t->spare==NULL) {
+        t->spare = (unsigned int*)BufferPool::instance().allocate( bufferBytes(t) );
+        if (t->spare!=NULL)    mBytes += bufferBytes( t );
+        else                   t->version = 0;
+    }
+    t->target = (t->version!=0) ? t->spare + t->stride + 1 : t->pixels;
+    t->changed = false;
+}
+//---------------------------------------------------------------------------
+/** \brief Show a tile's newly converted pixels (if it's Converted, it
+ *  becomes Ready; the pixels that were shown are released).
+ */
+void DisplayCache::commit ( Tile* t ) {
+    if (t->state!=Converted)    return;
+    //(a barrier: the worker's pixels and version are seen from here on)
+    atomicExchange( &t->state, Ready );
+    if (t->target!=t->pixels) {
+        std::swap( t->buffer, t->spare );
+        t->pixels = t->target;
+        mBytes -= bufferBytes( t );
+        BufferPool::instance().release( t->spare );
+        t->spare = NULL;
+    }
+    t->version = t->converted;
+}
+//---------------------------------------------------------------------------
+/** \brief Discard all tiles.  The caller must make sure that none are
+ *  being converted.
+ */
+void DisplayCache::clear ( void ) {
+    while (!mLRU.empty())    discard( mLRU.front() );
+    assert( mTiles.empty() && mBytes==0 );
+}
+//---------------------------------------------------------------------------
+/** \brief Mark the tiles (of every level) over a rect of the image as
+ *  changed, so they're converted again (and shown until they are).  The
+ *  caller must make sure that none are being converted.
+ *  \param x0 left of the rect (level 0 coordinates)
+ *  \param y0 top of the rect
+ *  \param x1 right of the rect (exclusive)
+ *  \param y1 bottom of the rect (exclusive)
+ */
+void DisplayCache::invalidate ( const int x0, const int y0, const int x1,
+                                const int y1 )
+{
+    if (x0>=x1 || y0>=y1)    return;
+    for (std::map<Key, Tile*>::iterator it=mTiles.begin(); it!=mTiles.end(); ++it) {
+        Tile*  t = it->second;
+        //(the pixels of older conversions are shown first)
+        commit( t );
+        //the rect in the tile's level (each pixel of which is a 2x2 box of
+        // the one below), grown by the apron
+        const int  lx0 = (x0 >> t->level) - 1, ly0 = (y0 >> t->level) - 1;
+        const int  lx1 = ((x1 - 1) >> t->level) + 2, ly1 = ((y1 - 1) >> t->level) + 2;
+        if (lx0 < t->x0 + t->w && t->x0 < lx1 && ly0 < t->y0 + t->h && t->y0 < ly1)
+            t->changed = true;
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Set the max number of tiles kept (beyond those queued for
+ *  conversion).
+ */
+void DisplayCache::setCapacity ( const int tiles ) {
+    assert( tiles>0 );
+    mCapacity = tiles;
+    trim( NULL );
+}
+//---------------------------------------------------------------------------
+/// discard least recently used (unqueued) tiles (except keep) until within capacity.
+void DisplayCache::trim ( Tile* keep ) {
+    std::list<Tile*>::iterator  it = mLRU.begin();
+    while ((int)mTiles.size() > mCapacity && it!=mLRU.end()) {
+        Tile*  t = *it;
+        ++it;
+        if (t!=keep && t->state!=Queued)    discard( t );
+    }
+}
+//---------------------------------------------------------------------------
+void DisplayCache::discard ( Tile* t ) {
+    assert( t->state!=Queued );
+    if (t->buffer!=NULL) {
+        mBytes -= bufferBytes( t );
+        BufferPool::instance().release( t->buffer );
+    }
+    if (t->spare!=NULL) {
+        mBytes -= bufferBytes( t );
+        BufferPool::instance().release( t->spare );
+    }
+    mLRU.erase( t->lru );
+    mTiles.erase( makeKey(t->level, t->tx, t->ty) );
+    delete t;
+}
+//---------------------------------------------------------------------------
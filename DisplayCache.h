@@ -0,0 +1,115 @@
+/**
+    \file DisplayCache.h
+    Definition of the DisplayCache class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef DisplayCache_h
+#define DisplayCache_h
+
+#include  <stddef.h>
+#include  <list>
+#include  <map>
+//----------------------------------------------------------------------
+/** \brief Cache of displayable (BGRX) tiles of an image, keyed by
+ *  (level, tile x, tile y) and bounded (least recently used tiles are
+ *  discarded first).
+ *
+ *  Only the tiles that are (or were recently) on screen are converted
+ *  and kept, so memory used for display depends on the window size
+ *  rather than the image size.  The cache itself is only used by one
+ *  thread (a view's render thread, see FrameRenderer); workers (see
+ *  TileRenderer) only fill the target pixels of tiles that are queued
+ *  (which are never discarded).  A tile that's shown is reconverted into
+ *  a spare buffer that the render thread swaps in when it's done (see
+ *  commit), so pixels are never drawn while they're being written.
+ *
+ *  Each tile has a 1 pixel apron (copies of the neighboring pixels of the
+ *  level, or of its edge) so that it can be filtered (see
+ *  DisplaySurface::drawScaled) without seams.
+ */
+class DisplayCache {
+public:
+    enum { TileSize = 256 };  ///< tile width and height
+
+    /// state of a tile's pixels.
+    enum { Empty, Queued, Converted, Ready };
+
+    /// one tile.
+    struct Tile {
+        int            level;       ///< 0 is full resolution
+        int            tx, ty;      ///< tile column and row
+        int            x0, y0;      ///< upper left (level coordinates)
+        int            w, h;        ///< size (smaller at right/bottom edges)
+        unsigned int*  buffer;      ///< (w+2)*(h+2) BGRX pixels (incl. a 1 pixel apron)
+        unsigned int*  pixels;      ///< upper left pixel (in buffer)
+        unsigned int*  spare;       ///< second buffer, converted into while the tile is shown (or NULL)
+        unsigned int*  target;      ///< upper left pixel to convert into (pixels, or in spare)
+        int            stride;      ///< row length (w+2)
+        volatile long  state;       ///< one of the above
+        unsigned int   version;     ///< DisplayLUT version of the pixels (0 if none yet; render thread only)
+        unsigned int   converted;   ///< DisplayLUT version of the target pixels (set before Converted)
+        bool           changed;     ///< the image changed since the pixels were converted (see invalidate)
+        std::list<Tile*>::iterator  lru;  ///< position in mLRU
+    };
+
+    DisplayCache  ( );
+    ~DisplayCache ( );
+
+    Tile*  find    ( const int level, const int tx, const int ty );
+    Tile*  acquire ( const int level, const int tx, const int ty,
+                     const int levelW, const int levelH );
+    void   touch   ( Tile* t );
+    void   prepare ( Tile* t );
+    void   commit  ( Tile* t );
+    void   clear   ( void );
+    void   invalidate ( const int x0, const int y0, const int x1, const int y1 );
+    void   setCapacity ( const int tiles );
+
+    inline int    getCapacity ( void ) const {  return mCapacity;  }
+    inline int    getCount    ( void ) const {  return (int)mTiles.size();  }
+    /// \returns the memory held by tile pixels (in bytes).
+    inline size_t getBytes    ( void ) const {  return mBytes;  }
+
+protected:
+    typedef long long  Key;
+    static inline Key makeKey ( const int level, const int tx, const int ty ) {
+        return ((Key)level << 48) | ((Key)ty << 24) | (Key)tx;
+    }
+
+    std::map<Key, Tile*>  mTiles;     ///< all cached tiles
+    std::list<Tile*>      mLRU;       ///< least recently used first
+    int                   mCapacity;  ///< max number of (unqueued) tiles
+    size_t                mBytes;     ///< pixel memory held
+
+    void   trim ( Tile* keep );
+    /// \returns the size of a tile's buffer (in bytes).
+    static inline size_t bufferBytes ( const Tile* t ) {
+        return (size_t)(t->w + 2) * (t->h + 2) * sizeof(unsigned int);
+    }
+    void   discard ( Tile* t );
+};
+
+#endif
+//----------------------------------------------------------------------
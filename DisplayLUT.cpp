@@ -0,0 +1,358 @@
+/**
+    \file DisplayLUT.cpp
+    Implementation of the DisplayLUT class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <math.h>
+#include  "DisplayLUT.h"
+#include  "Simd.h"
+//---------------------------------------------------------------------------
+DisplayLUT::DisplayLUT ( ) {
+    mWindowed = false;
+    mCenter = 127.5;
+    mWidth = 256;
+    mVersion = 0;
+    mMode = Linear;
+    mGamma = 1;
+    mHistFirst = mHistShift = 0;
+    build( 0, 255 );
+}
+//---------------------------------------------------------------------------
+/** \brief Map a sample value to an 8 bit display value.  With a window,
+ *  center-width/2 .. center+width/2 is linearly stretched to 0..255.
+ *  Otherwise, images within 0..255 are shown as is (except that a 0/1
+ *  binary image is shown as black/white) and anything else is linearly
+ *  stretched from min..max.
+ */
+int DisplayLUT::transfer ( const int v ) const {
+    int  g = v;
+    if (mMode!=Linear) {
+        //the window, or the image range (the display range for 8 bit data)
+        double  lo = mMin, hi = mMax;
+        if (mWindowed) {
+            lo = mCenter - mWidth/2;
+            hi = mCenter + mWidth/2;
+        } else if (mMin>=0 && mMax<=255 && !(mMin==0 && mMax==1)) {
+            lo = 0;
+            hi = 255;
+        }
+        if (hi<=lo)    return (v>=hi) ? 255 : 0;
+        double  x = (v<lo) ? lo : (v>hi ? hi : (double)v);
+        double  t = 0;
+        switch (mMode) {
+            case Gamma :
+                t = pow( (x - lo) / (hi - lo), 1 / mGamma );
+                break;
+            case Log :
+                t = log( 1 + (x - lo) ) / log( 1 + (hi - lo) );
+                break;
+            case Equalize : {
+                const double  c0 = cdf( lo - 1 ), c1 = cdf( hi );
+                t = (c1>c0) ? (cdf( x ) - c0) / (c1 - c0) : 0;
+                break;
+            }
+        }
+        g = (int)(255 * t + 0.5);
+    } else if (mWindowed) {
+        const double  d = 256.0 * (v - (mCenter - mWidth/2)) / mWidth;
+        g = (d<0) ? 0 : (d>255 ? 255 : (int)d);
+    } else if (mMin<0 || mMax>255) {
+        const long long  diff = (long long)mMax - mMin;
+        if (diff!=0)    g = (int)(255 * ((long long)v - mMin) / diff);
+        else            g = 127;
+    } else if (mMin==0 && mMax==1) {
+        //handle special case of binary image (otherwise, we
+        // won't be able to distinguish between black and white).
+        if (g==1)    g = 255;
+    }
+    if (g<0)      g = 0;
+    if (g>255)    g = 255;
+    return g;
+}
+//---------------------------------------------------------------------------
+/** \brief (Re)build the table for an image with the given sample range.
+ */
+void DisplayLUT::build ( const int min, const int max ) {
+    assert( min<=max );
+    mMin = min;
+    mMax = max;
+    fill();
+}
+//---------------------------------------------------------------------------
+/** \brief Use (and rebuild the table for) a window.
+ *  \param center sample value shown as mid gray
+ *  \param width range of sample values (centered there) shown as 0..255
+ */
+void DisplayLUT::setWindow ( const double center, const double width ) {
+    mWindowed = true;
+    mCenter = center;
+    mWidth = (width<1) ? 1 : width;
+    fill();
+}
+//---------------------------------------------------------------------------
+/** \brief Go back to the default (image range) mapping.
+ */
+void DisplayLUT::clearWindow ( void ) {
+    mWindowed = false;
+    fill();
+}
+//---------------------------------------------------------------------------
+/** \brief Use (and rebuild the table for) a different curve.  For
+ *  Equalize, set the histogram first.
+ *  \param mode Linear, Gamma, Log, or Equalize
+ */
+void DisplayLUT::setMode ( const int mode ) {
+    assert( mode>=Linear && mode<ModeCount );
+    mMode = mode;
+    fill();
+}
+//---------------------------------------------------------------------------
+/** \brief Set the exponent used by Gamma (> 1 brightens dark values).
+ */
+void DisplayLUT::setGamma ( const double gamma ) {
+    assert( gamma>0 );
+    mGamma = gamma;
+    if (mMode==Gamma)    fill();
+}
+//---------------------------------------------------------------------------
+/** \brief Set the histogram used by Equalize (e.g., from
+ *  ImageStats::getHistogram).  Bin i counts the values in
+ *  [first + (i<<shift), first + ((i+1)<<shift)).  Takes effect when the
+ *  table is next rebuilt (e.g., by build).
+ */
+void DisplayLUT::setHistogram ( const std::vector<unsigned int>& hist,
+                                const int first, const int shift )
+{
+    mHistFirst = first;
+    mHistShift = shift;
+    mCDF.resize( hist.size() + 1 );
+    double  sum = 0;
+    for (size_t i=0; i<hist.size(); i++) {
+        mCDF[i] = sum;
+        sum += hist[i];
+    }
+    mCDF[ hist.size() ] = sum;
+    if (sum>0)    for (size_t i=0; i<mCDF.size(); i++)    mCDF[i] /= sum;
+}
+//---------------------------------------------------------------------------
+/** \brief Show display values with a (pseudo color) map.
+ */
+void DisplayLUT::setColormap ( const Colormap& map ) {
+    mColormap = map;
+    fill();
+}
+//---------------------------------------------------------------------------
+/** \brief Fraction of samples <= v (interpolated within a histogram bin).
+ */
+double DisplayLUT::cdf ( const double v ) const {
+    const int  bins = (int)mCDF.size() - 1;
+    if (bins<=0)    return 0;
+    const double  width = (double)(1LL << mHistShift);
+    const double  pos = (v + 1 - mHistFirst) / width;  //bins fully below v+1
+    if (pos<=0)       return 0;
+    if (pos>=bins)    return 1;
+    const int  i = (int)pos;
+    return mCDF[i] + (mCDF[i+1] - mCDF[i]) * (pos - i);
+}
+//---------------------------------------------------------------------------
+/// \returns a mode's name (e.g., for the status bar).
+const char* DisplayLUT::getModeName ( const int mode ) {
+    switch (mode) {
+        case Linear :    return "linear";
+        case Gamma :     return "gamma";
+        case Log :       return "log";
+        case Equalize :  return "equalized";
+    }
+    return "?";
+}
+//---------------------------------------------------------------------------
+/// evaluate the mapping for each entry.
+void DisplayLUT::fill ( void ) {
+    const int  min = mMin, max = mMax;
+    ++mVersion;
+    mFirst = min;
+    const unsigned int  range = (unsigned int)max - (unsigned int)min;
+    mShift = 0;
+    while ((range >> mShift) >= MaxEntries)    ++mShift;
+    const unsigned int  entries = (range >> mShift) + 1;
+    mTable.resize( entries );
+    const long long  half = (mShift>0) ? (1LL << (mShift-1)) : 0;
+    for (unsigned int i=0; i<entries; i++) {
+        //center of the piece (but within the range)
+        long long  v = (long long)min + ((long long)i << mShift) + half;
+        if (v>max)    v = max;
+        mTable[i] = mColormap.get( transfer( (int)v ) );
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Convert gray samples to BGRX pixels.
+ *  \param src samples
+ *  \param dst displayable pixels
+ *  \param n   number of samples
+ */
+void DisplayLUT::mapGray ( const int* const src, unsigned int* const dst,
+                           const size_t n ) const
+{
+    const unsigned int*  t = &mTable[0];
+    const int  lo = mMin, hi = mMax;
+    size_t  i = 0;
+#ifdef USE_SSE2
+    //4 at a time: clamp, offset, and shift (SSE2 has no gather, so the
+    // table loads are scalar)
+    const __m128i  vlo    = _mm_set1_epi32( lo );
+    const __m128i  vhi    = _mm_set1_epi32( hi );
+    const __m128i  vfirst = _mm_set1_epi32( mFirst );
+    const __m128i  vsh    = _mm_cvtsi32_si128( mShift );
+    for ( ; i+4<=n; i+=4) {
+        __m128i  v = _mm_loadu_si128( (const __m128i*)(src+i) );
+        __m128i  m = _mm_cmplt_epi32( v, vlo );
+        v = _mm_or_si128( _mm_and_si128( m, vlo ), _mm_andnot_si128( m, v ) );
+        m = _mm_cmpgt_epi32( v, vhi );
+        v = _mm_or_si128( _mm_and_si128( m, vhi ), _mm_andnot_si128( m, v ) );
+        v = _mm_srl_epi32( _mm_sub_epi32( v, vfirst ), vsh );
+        dst[i]   = t[ _mm_cvtsi128_si32( v ) ];
+        dst[i+1] = t[ _mm_cvtsi128_si32( _mm_srli_si128( v, 4 ) ) ];
+        dst[i+2] = t[ _mm_cvtsi128_si32( _mm_srli_si128( v, 8 ) ) ];
+        dst[i+3] = t[ _mm_cvtsi128_si32( _mm_srli_si128( v, 12 ) ) ];
+    }
+#endif
+    const unsigned int  first = (unsigned int)mFirst;
+    const int           shift = mShift;
+    for ( ; i<n; i++) {
+        int  v = src[i];
+        v = (v<lo) ? lo : v;
+        v = (v>hi) ? hi : v;
+        dst[i] = t[ ((unsigned int)v - first) >> shift ];
+    }
+}
+//---------------------------------------------------------------------------
+#ifdef USE_SSE2
+/// pack 4 pixels (one channel per vector; clamped to 0..255) as BGRX.
+static inline __m128i packBGRX ( const __m128i r, const __m128i g,
+                                 const __m128i b )
+{
+    const __m128i  zero = _mm_setzero_si128();
+    const __m128i  br = _mm_packs_epi32( b, r );     //b0..b3 r0..r3 (16 bit)
+    const __m128i  g0 = _mm_packs_epi32( g, zero );  //g0..g3 0..0
+    const __m128i  bg = _mm_unpacklo_epi16( br, g0 );                        //b g b g ...
+    const __m128i  rx = _mm_unpacklo_epi16( _mm_srli_si128( br, 8 ), zero ); //r 0 r 0 ...
+    return _mm_packus_epi16( _mm_unpacklo_epi32( bg, rx ),
+                             _mm_unpackhi_epi32( bg, rx ) );
+}
+//---------------------------------------------------------------------------
+/// stretch (v - first) * scale (rounded) if necessary.
+static inline __m128i stretch ( const __m128i v, const bool scaled,
+                                const __m128 first, const __m128 scale )
+{
+    if (!scaled)    return v;
+    return _mm_cvtps_epi32( _mm_mul_ps( _mm_sub_ps( _mm_cvtepi32_ps( v ), first ), scale ) );
+}
+#endif
+//---------------------------------------------------------------------------
+/** \brief Convert interleaved rgb samples to BGRX pixels (clamped to
+ *  0..255, or stretched from min..max if the image range isn't within
+ *  0..255).  Vectorized (4 pixels at a time) with SSE2.
+ *  \param src samples (3 per pixel)
+ *  \param dst displayable pixels
+ *  \param n   number of pixels
+ */
+void DisplayLUT::mapRGB ( const int* const src, unsigned int* const dst,
+                          const size_t n ) const
+{
+    const bool    scaled = (mMin<0 || mMax>255);
+    const double  scale = (mMax>mMin) ? 255.0 / ((double)mMax - mMin) : 0;
+    size_t  i = 0;
+#ifdef USE_SSE2
+    const __m128  vfirst = _mm_set1_ps( (float)mMin );
+    const __m128  vscale = _mm_set1_ps( (float)scale );
+    for ( ; i+4<=n; i+=4) {
+        //r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+        const __m128  v0 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i*)(src + 3*i) ) );
+        const __m128  v1 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i*)(src + 3*i + 4) ) );
+        const __m128  v2 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i*)(src + 3*i + 8) ) );
+        //(shuffle_ps just moves the bits) pairs of each channel, then merge
+        const __m128  hr = _mm_shuffle_ps( v0, v0, _MM_SHUFFLE(3,3,0,0) );  //r0 r0 r1 r1
+        const __m128  hg = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE(0,0,1,1) );  //g0 g0 g1 g1
+        const __m128  hb = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE(1,1,2,2) );  //b0 b0 b1 b1
+        const __m128  ur = _mm_shuffle_ps( v1, v2, _MM_SHUFFLE(1,1,2,2) );  //r2 r2 r3 r3
+        const __m128  ug = _mm_shuffle_ps( v1, v2, _MM_SHUFFLE(2,2,3,3) );  //g2 g2 g3 g3
+        const __m128  ub = _mm_shuffle_ps( v2, v2, _MM_SHUFFLE(3,3,0,0) );  //b2 b2 b3 b3
+        const __m128i  r = _mm_castps_si128( _mm_shuffle_ps( hr, ur, _MM_SHUFFLE(2,0,2,0) ) );
+        const __m128i  g = _mm_castps_si128( _mm_shuffle_ps( hg, ug, _MM_SHUFFLE(2,0,2,0) ) );
+        const __m128i  b = _mm_castps_si128( _mm_shuffle_ps( hb, ub, _MM_SHUFFLE(2,0,2,0) ) );
+        _mm_storeu_si128( (__m128i*)(dst + i),
+            packBGRX( stretch( r, scaled, vfirst, vscale ),
+                      stretch( g, scaled, vfirst, vscale ),
+                      stretch( b, scaled, vfirst, vscale ) ) );
+    }
+#endif
+    for ( ; i<n; i++)
+        dst[i] = packRGB( src[3*i], src[3*i+1], src[3*i+2], scaled, scale );
+}
+//---------------------------------------------------------------------------
+/** \brief Convert planar rgb samples (e.g., from separate channel images)
+ *  to BGRX pixels (as mapRGB).
+ *  \param r red samples
+ *  \param g green samples
+ *  \param b blue samples
+ *  \param dst displayable pixels
+ *  \param n   number of pixels
+ */
+void DisplayLUT::mapPlanar ( const int* const r, const int* const g,
+                             const int* const b, unsigned int* const dst,
+                             const size_t n ) const
+{
+    const bool    scaled = (mMin<0 || mMax>255);
+    const double  scale = (mMax>mMin) ? 255.0 / ((double)mMax - mMin) : 0;
+    size_t  i = 0;
+#ifdef USE_SSE2
+    const __m128  vfirst = _mm_set1_ps( (float)mMin );
+    const __m128  vscale = _mm_set1_ps( (float)scale );
+    for ( ; i+4<=n; i+=4) {
+        _mm_storeu_si128( (__m128i*)(dst + i), packBGRX(
+            stretch( _mm_loadu_si128( (const __m128i*)(r + i) ), scaled, vfirst, vscale ),
+            stretch( _mm_loadu_si128( (const __m128i*)(g + i) ), scaled, vfirst, vscale ),
+            stretch( _mm_loadu_si128( (const __m128i*)(b + i) ), scaled, vfirst, vscale ) ) );
+    }
+#endif
+    for ( ; i<n; i++)    dst[i] = packRGB( r[i], g[i], b[i], scaled, scale );
+}
+//---------------------------------------------------------------------------
+/// one pixel (as the vectorized loops).
+unsigned int DisplayLUT::packRGB ( int r, int g, int b, const bool scaled,
+                                   const double scale ) const
+{
+    if (scaled) {
+        r = (int)floor( (r - (double)mMin) * scale + 0.5 );
+        g = (int)floor( (g - (double)mMin) * scale + 0.5 );
+        b = (int)floor( (b - (double)mMin) * scale + 0.5 );
+    }
+    r = (r<0) ? 0 : (r>255 ? 255 : r);
+    g = (g<0) ? 0 : (g>255 ? 255 : g);
+    b = (b<0) ? 0 : (b>255 ? 255 : b);
+    return ((unsigned int)r << 16) | ((unsigned int)g << 8) | (unsigned int)b;
+}
+//---------------------------------------------------------------------------
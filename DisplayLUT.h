@@ -0,0 +1,134 @@
+/**
+    \file DisplayLUT.h
+    Definition of the DisplayLUT class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef DisplayLUT_h
+#define DisplayLUT_h
+
+#include  <stddef.h>
+#include  <vector>
+#include  "Colormap.h"
+//----------------------------------------------------------------------
+/** \brief Lookup table that maps sample values directly to displayable
+ *  (BGRX, 32 bit) pixels.
+ *
+ *  The mapping (range stretch, etc.) is evaluated once per table entry
+ *  when the table is built rather than once per pixel.  There is one
+ *  entry per value for images with at most 65536 distinct values (e.g.,
+ *  256 entries for 8 bit data).  Wider ranges are split into 65536 equal,
+ *  power of 2 wide pieces (each mapped to the display value at its
+ *  center).
+ *
+ *  By default, the image range is stretched to the display range.  A
+ *  window (center and width, e.g., adjusted interactively) may be given
+ *  instead.  Changing it only rebuilds the table.
+ *
+ *  The window (or image range) is mapped to the display range linearly
+ *  or, e.g., for high dynamic range data, with a gamma or log curve or
+ *  by histogram equalization (using a histogram of the image, such as
+ *  the cached one in ImageStats).  These, too, are evaluated per entry.
+ *  So is the (pseudo color) Colormap that display values are shown with.
+ *
+ *  Color (rgb) samples aren't looked up; they're packed directly (see
+ *  mapRGB), stretched if the image range (see build) isn't within 0..255.
+ */
+class DisplayLUT {
+public:
+    enum { MaxEntries = 65536 };
+    /// how the window (or image range) is mapped to the display range.
+    enum { Linear, Gamma, Log, Equalize, ModeCount };
+
+    DisplayLUT ( );
+
+    void build ( const int min, const int max );
+    void setWindow ( const double center, const double width );
+    void clearWindow ( void );
+    void setMode ( const int mode );
+    void setGamma ( const double gamma );
+    void setHistogram ( const std::vector<unsigned int>& hist,
+                        const int first, const int shift );
+    void setColormap ( const Colormap& map );
+
+    /// \returns the BGRX pixel for a sample value.
+    inline unsigned int lookup ( int v ) const {
+        if (v<mMin)    v = mMin;
+        if (v>mMax)    v = mMax;
+        return mTable[ ((unsigned int)v - (unsigned int)mFirst) >> mShift ];
+    }
+
+    void mapGray ( const int* const src, unsigned int* const dst,
+                   const size_t n ) const;
+    void mapRGB ( const int* const src, unsigned int* const dst,
+                  const size_t n ) const;
+    void mapPlanar ( const int* const r, const int* const g,
+                     const int* const b, unsigned int* const dst,
+                     const size_t n ) const;
+
+    inline bool   isWindowed ( void ) const {  return mWindowed;  }
+    inline double getCenter  ( void ) const {  return mCenter;  }
+    inline double getWidth   ( void ) const {  return mWidth;  }
+    inline int    getMode    ( void ) const {  return mMode;  }
+    inline double getGamma   ( void ) const {  return mGamma;  }
+    inline const Colormap& getColormap ( void ) const {  return mColormap;  }
+    static const char* getModeName ( const int mode );
+    /// \returns a number that changes whenever the table does.
+    inline unsigned int getVersion ( void ) const {  return mVersion;  }
+    inline int  getMin ( void ) const {  return mMin;  }
+    inline int  getMax ( void ) const {  return mMax;  }
+    inline int  getEntryCount ( void ) const {  return (int)mTable.size();  }
+    inline const unsigned int* getTable ( void ) const {  return &mTable[0];  }
+
+    /// pack an 8 bit gray value as BGRX.
+    static inline unsigned int gray ( const int g ) {
+        return (unsigned int)g * 0x010101u;
+    }
+
+protected:
+    std::vector<unsigned int>  mTable;  ///< BGRX pixel per entry
+    int   mFirst;       ///< sample value of entry 0
+    int   mShift;       ///< log2 of the number of values per entry
+    int   mMin, mMax;   ///< values outside of this range are clamped
+    bool  mWindowed;    ///< use the window below (instead of min..max)
+    double  mCenter;    ///< window center (sample value)
+    double  mWidth;     ///< window width (sample values, >= 1)
+    unsigned int  mVersion;  ///< incremented whenever the table is rebuilt
+    int     mMode;      ///< Linear, Gamma, etc.
+    double  mGamma;     ///< exponent (display = input^(1/gamma)) for Gamma
+    /// for Equalize: fraction of samples in histogram bins before bin i.
+    std::vector<double>  mCDF;
+    int     mHistFirst;   ///< value of the first histogram bin
+    int     mHistShift;   ///< log2 of the histogram bin width
+    Colormap  mColormap;  ///< display value to BGRX pixel
+
+    int     transfer ( const int v ) const;
+    unsigned int packRGB ( int r, int g, int b, const bool scaled,
+                           const double scale ) const;
+    double  cdf ( const double v ) const;
+    void  fill ( void );
+};
+
+#endif
+//----------------------------------------------------------------------
@@ -0,0 +1,260 @@
+/**
+    \file DisplaySurface.cpp
+    Implementation of the DisplaySurface class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <math.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <vector>
+#include  "DisplaySurface.h"
+#include  "Simd.h"
+//---------------------------------------------------------------------------
+DisplaySurface::DisplaySurface ( ) {
+    mW = mH = 0;
+    mPixels = NULL;
+    #ifdef WIN32
+        mBitmap = NULL;
+    #endif
+}
+//---------------------------------------------------------------------------
+DisplaySurface::~DisplaySurface ( ) {
+    release();
+}
+//---------------------------------------------------------------------------
+/** \brief Change the size (the contents are undefined afterwards).
+ *  \returns false if out of memory (the surface is then empty).
+ */
+bool DisplaySurface::resize ( const int w, const int h ) {
+    assert( w>=0 && h>=0 );
+    if (w==mW && h==mH && mPixels!=NULL)    return true;
+    release();
+    if (w==0 || h==0)    return true;
+    #ifdef WIN32
+        BITMAPINFO  bmi;
+        memset( &bmi, 0, sizeof bmi );
+        bmi.bmiHeader.biSize        = sizeof( BITMAPINFOHEADER );
+        bmi.bmiHeader.biWidth       = w;
+        bmi.bmiHeader.biHeight      = -h;  //top down
+        bmi.bmiHeader.biPlanes      = 1;
+        bmi.bmiHeader.biBitCount    = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        void*  bits = NULL;
+        mBitmap = CreateDIBSection( NULL, &bmi, DIB_RGB_COLORS, &bits, NULL, 0 );
+        if (mBitmap==NULL)    return false;
+        mPixels = (unsigned int*)bits;
+    #else
+        mPixels = (unsigned int*)malloc( (size_t)w * h * 4 );
+        if (mPixels==NULL)    return false;
+    #endif
+    mW = w;
+    mH = h;
+    return true;
+}
+//---------------------------------------------------------------------------
+void DisplaySurface::release ( void ) {
+    #ifdef WIN32
+        if (mBitmap!=NULL)    DeleteObject( mBitmap );
+        mBitmap = NULL;
+    #else
+        free( mPixels );
+    #endif
+    mPixels = NULL;
+    mW = mH = 0;
+}
+//---------------------------------------------------------------------------
+/** \brief Fill [x0,x1) x [y0,y1) (clipped to the surface) with a pixel value.
+ */
+void DisplaySurface::fill ( int x0, int y0, int x1, int y1,
+                            const unsigned int bgrx )
+{
+    if (x0<0)    x0 = 0;
+    if (y0<0)    y0 = 0;
+    if (x1>mW)   x1 = mW;
+    if (y1>mH)   y1 = mH;
+    for (int y=y0; y<y1; y++) {
+        unsigned int*  d = mPixels + (size_t)y * mW;
+        for (int x=x0; x<x1; x++)    d[x] = bgrx;
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Copy a block of pixels (e.g., a tile) to (dx,dy), clipped to the
+ *  surface.
+ *  \param src source pixels
+ *  \param srcStride source row length (in pixels)
+ *  \param w block width
+ *  \param h block height
+ *  \param dx destination column of the block's upper left
+ *  \param dy destination row of the block's upper left
+ */
+void DisplaySurface::copy ( const unsigned int* const src, const int srcStride,
+                            const int w, const int h, const int dx,
+                            const int dy )
+{
+    const int  x0 = (dx<0) ? -dx : 0, y0 = (dy<0) ? -dy : 0;
+    const int  x1 = (dx+w > mW) ? mW-dx : w;
+    const int  y1 = (dy+h > mH) ? mH-dy : h;
+    if (x0>=x1)    return;
+    for (int y=y0; y<y1; y++) {
+        memcpy( mPixels + (size_t)(dy+y) * mW + dx + x0,
+                src + (size_t)y * srcStride + x0,
+                (size_t)(x1-x0) * sizeof(unsigned int) );
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Surface pixels [*a,*b) (along one axis) whose centers fall on n
+ *  source pixels that start at s and are scaled by f.  Adjacent blocks of
+ *  source pixels (e.g., tiles) cover adjacent spans (no gaps or overlap).
+ */
+void DisplaySurface::span ( const double s, const int n, const double f,
+                            int* a, int* b )
+{
+    *a = (int)ceil( s - 0.5 );
+    *b = (int)ceil( s + n * f - 0.5 );
+}
+//---------------------------------------------------------------------------
+/** \brief Draw a block of pixels (e.g., a tile) scaled, clipped to
+ *  [cx0,cx1) x [cy0,cy1) and to the surface.  Surface pixel (x,y) shows
+ *  source position ((x+0.5-sx)/f, (y+0.5-sy)/f).
+ *
+ *  Bilinear filtering reads one pixel beyond each edge of the block (see
+ *  the apron of DisplayCache::Tile).  Nearest uses only the block.
+ *  \param src upper left source pixel
+ *  \param srcStride source row length (in pixels)
+ *  \param w block width
+ *  \param h block height
+ *  \param sx surface position of the block's left edge
+ *  \param sy surface position of the block's top edge
+ *  \param f scale (surface pixels per source pixel)
+ *  \param bilinear filter (otherwise, nearest)
+ */
+void DisplaySurface::drawScaled ( const unsigned int* const src,
+                                  const int srcStride, const int w,
+                                  const int h, const double sx,
+                                  const double sy, const double f,
+                                  bool bilinear, int cx0, int cy0, int cx1,
+                                  int cy1 )
+{
+    assert( f>0 );
+    int  x0, x1, y0, y1;
+    span( sx, w, f, &x0, &x1 );
+    span( sy, h, f, &y0, &y1 );
+    if (cx0<x0)    cx0 = x0;
+    if (cy0<y0)    cy0 = y0;
+    if (cx1>x1)    cx1 = x1;
+    if (cy1>y1)    cy1 = y1;
+    if (cx0<0)     cx0 = 0;
+    if (cy0<0)     cy0 = 0;
+    if (cx1>mW)    cx1 = mW;
+    if (cy1>mH)    cy1 = mH;
+    if (cx0>=cx1 || cy0>=cy1)    return;
+    const int  n = cx1 - cx0;
+    //unscaled and aligned, the filter is a copy
+    if (f==1 && sx==floor(sx) && sy==floor(sy))    bilinear = false;
+
+    if (!bilinear) {
+        //source column of each surface column
+        std::vector<int>  col( n );
+        for (int i=0; i<n; i++) {
+            int  c = (int)floor( (cx0 + i + 0.5 - sx) / f );
+            col[i] = (c<0) ? 0 : (c>=w ? w-1 : c);
+        }
+        const bool  contiguous = (col[n-1] - col[0] == n-1);
+        int  lastRow = -1;
+        for (int y=cy0; y<cy1; y++) {
+            int  r = (int)floor( (y + 0.5 - sy) / f );
+            r = (r<0) ? 0 : (r>=h ? h-1 : r);
+            unsigned int*  d = mPixels + (size_t)y * mW + cx0;
+            if (r==lastRow) {
+                //(magnified) same as the row above
+                memcpy( d, d - mW, (size_t)n * sizeof(unsigned int) );
+                continue;
+            }
+            lastRow = r;
+            const unsigned int*  s = src + (size_t)r * srcStride;
+            if (contiguous)    memcpy( d, s + col[0], (size_t)n * sizeof(unsigned int) );
+            else               for (int i=0; i<n; i++)    d[i] = s[ col[i] ];
+        }
+        return;
+    }
+
+    //left neighbor (-1..w-1) and 8 bit weight (0..256) of the right one
+    std::vector<int>  col( n ), wt( n );
+    for (int i=0; i<n; i++) {
+        const double  u = (cx0 + i + 0.5 - sx) / f - 0.5;
+        int  c = (int)floor( u );
+        int  a = (int)((u - c) * 256 + 0.5);
+        if (c<-1)     {  c = -1;     a = 0;    }
+        if (c>w-1)    {  c = w-1;    a = 256;  }
+        col[i] = c;
+        wt[i]  = a;
+    }
+    for (int y=cy0; y<cy1; y++) {
+        const double  v = (y + 0.5 - sy) / f - 0.5;
+        int  r = (int)floor( v );
+        int  b = (int)((v - r) * 256 + 0.5);
+        if (r<-1)     {  r = -1;     b = 0;    }
+        if (r>h-1)    {  r = h-1;    b = 256;  }
+        const unsigned int*  s0 = src + (ptrdiff_t)r * srcStride;
+        const unsigned int*  s1 = s0 + srcStride;
+        unsigned int*  d = mPixels + (size_t)y * mW + cx0;
+    #ifdef USE_SSE2
+        //each pixel: both columns (as 16 bit lanes) blended vertically,
+        // then the two halves blended horizontally
+        const __m128i  zero = _mm_setzero_si128();
+        const __m128i  round = _mm_set1_epi16( 128 );
+        const __m128i  wb = _mm_set1_epi16( (short)b );
+        const __m128i  wa = _mm_set1_epi16( (short)(256 - b) );
+        for (int i=0; i<n; i++) {
+            const int  c = col[i];
+            const __m128i  top = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i*)(s0+c) ), zero );
+            const __m128i  bot = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i*)(s1+c) ), zero );
+            __m128i  p = _mm_add_epi16( _mm_mullo_epi16( top, wa ), _mm_mullo_epi16( bot, wb ) );
+            p = _mm_srli_epi16( _mm_add_epi16( p, round ), 8 );
+            const __m128i  wx = _mm_unpacklo_epi64( _mm_set1_epi16( (short)(256 - wt[i]) ),
+                                                    _mm_set1_epi16( (short)wt[i] ) );
+            p = _mm_mullo_epi16( p, wx );
+            p = _mm_add_epi16( _mm_add_epi16( p, _mm_srli_si128( p, 8 ) ), round );
+            p = _mm_srli_epi16( p, 8 );
+            d[i] = (unsigned int)_mm_cvtsi128_si32( _mm_packus_epi16( p, p ) );
+        }
+    #else
+        for (int i=0; i<n; i++) {
+            const int  c = col[i], a = wt[i];
+            unsigned int  out = 0;
+            for (int shift=0; shift<32; shift+=8) {
+                const unsigned int  p00 = (s0[c] >> shift) & 0xff, p01 = (s0[c+1] >> shift) & 0xff;
+                const unsigned int  p10 = (s1[c] >> shift) & 0xff, p11 = (s1[c+1] >> shift) & 0xff;
+                const unsigned int  l = (p00 * (256 - b) + p10 * b + 128) >> 8;
+                const unsigned int  r = (p01 * (256 - b) + p11 * b + 128) >> 8;
+                out |= ((l * (256 - a) + r * a + 128) >> 8) << shift;
+            }
+            d[i] = out;
+        }
+    #endif
+    }
+}
+//---------------------------------------------------------------------------
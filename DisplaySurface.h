@@ -0,0 +1,91 @@
+/**
+    \file DisplaySurface.h
+    Definition of the DisplaySurface class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef DisplaySurface_h
+#define DisplaySurface_h
+
+#include  <stddef.h>
+
+#ifdef WIN32
+#  include <windows.h>
+#endif
+//----------------------------------------------------------------------
+/** \brief Persistent BGRX (32 bit, top down) pixel surface that a view
+ *  composes its display into.
+ *
+ *  A frame is composed into one (see FrameRenderer) and painting simply
+ *  copies the invalid rect of it to the screen.  On Windows, the pixels
+ *  belong to a DIB section (see getBitmap) so that copy is a plain BitBlt;
+ *  elsewhere (e.g., headless rendering) they're ordinary memory.
+ *
+ *  Zoomed tiles are drawn with drawScaled (nearest or bilinear).
+ */
+class DisplaySurface {
+public:
+    DisplaySurface  ( );
+    ~DisplaySurface ( );
+
+    bool  resize  ( const int w, const int h );
+    void  release ( void );
+
+    void  fill ( int x0, int y0, int x1, int y1, const unsigned int bgrx );
+    void  copy ( const unsigned int* const src, const int srcStride,
+                 const int w, const int h, const int dx, const int dy );
+    void  drawScaled ( const unsigned int* const src, const int srcStride,
+                       const int w, const int h, const double sx,
+                       const double sy, const double f, bool bilinear,
+                       int cx0, int cy0, int cx1, int cy1 );
+
+    static void span ( const double s, const int n, const double f,
+                       int* a, int* b );
+
+    inline int   getWidth  ( void ) const {  return mW;  }
+    inline int   getHeight ( void ) const {  return mH;  }
+    /// row r starts at getPixels() + r*getWidth().
+    inline unsigned int* getPixels ( void ) const {  return mPixels;  }
+    inline size_t getBytes ( void ) const {  return (size_t)mW * mH * 4;  }
+    /// the DIB section, for selecting into a memory DC (NULL if headless).
+    #ifdef WIN32
+        inline HBITMAP getBitmap ( void ) const {  return mBitmap;  }
+    #else
+        inline void*   getBitmap ( void ) const {  return NULL;  }
+    #endif
+
+protected:
+    int            mW, mH;    ///< size (in pixels)
+    unsigned int*  mPixels;   ///< mW*mH BGRX pixels (or NULL)
+    #ifdef WIN32
+        HBITMAP    mBitmap;   ///< owns mPixels
+    #endif
+
+private:
+    DisplaySurface ( const DisplaySurface& );
+    DisplaySurface& operator= ( const DisplaySurface& );
+};
+
+#endif
+//----------------------------------------------------------------------
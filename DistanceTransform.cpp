@@ -0,0 +1,312 @@
+/**
+    \file DistanceTransform.cpp
+    Implementation of the DistanceTransform class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <float.h>
+#include  <limits.h>
+#include  <math.h>
+#include  <stdio.h>
+#include  "BufferPool.h"
+#include  "DistanceTransform.h"
+#include  "ThreadPool.h"
+
+#ifndef WIN32
+#  include <sys/time.h>
+#endif
+
+/// squared distances of pixels with no 0 pixel in their row/column/image.
+static const long long  Infinite = 0x7fffffffffffffffLL;
+/// columns gathered (and transformed) together.
+static const int  ColumnBlock = 16;
+//---------------------------------------------------------------------------
+/// first pass: distance along each row (of rows [begin,end)) to a 0 pixel.
+class RowTask : public ThreadPool::RangeTask {
+public:
+    const int*  mSrc;
+    int*        mDist;   ///< w*h distances (or mInf)
+    int         mW;
+    int         mInf;    ///< larger than any distance within a row
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        for (int y=begin; y<end; y++) {
+            const int*  s = mSrc  + (size_t)y * mW;
+            int*        g = mDist + (size_t)y * mW;
+            int  d = mInf;
+            for (int x=0; x<mW; x++) {
+                d = (s[x]==0) ? 0 : (d < mInf ? d+1 : mInf);
+                g[x] = d;
+            }
+            d = mInf;
+            for (int x=mW-1; x>=0; x--) {
+                d = (s[x]==0) ? 0 : (d < mInf ? d+1 : mInf);
+                if (d < g[x])    g[x] = d;
+            }
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// second pass: lower envelope along blocks [begin,end) of columns.
+class ColumnTask : public ThreadPool::RangeTask {
+public:
+    const int*  mDist;   ///< results of the first pass
+    void*       mOut;
+    int         mW, mH;
+    int         mInf;
+    int         mKind;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        //columns are gathered so that each is contiguous
+        std::vector<int>        g( (size_t)ColumnBlock * mH );
+        std::vector<long long>  d( (size_t)ColumnBlock * mH );
+        std::vector<int>        s( mH ), t( mH );
+        for (int b=begin; b<end; b++) {
+            const int  x0 = b * ColumnBlock;
+            const int  n  = (mW - x0 < ColumnBlock) ? mW - x0 : ColumnBlock;
+            for (int y=0; y<mH; y++) {
+                const int*  row = mDist + (size_t)y * mW + x0;
+                for (int c=0; c<n; c++)    g[ (size_t)c*mH + y ] = row[c];
+            }
+            for (int c=0; c<n; c++)
+                column( &g[ (size_t)c*mH ], &d[ (size_t)c*mH ], &s[0], &t[0] );
+            for (int y=0; y<mH; y++)
+                store( &d[y], (size_t)y * mW + x0, n );
+        }
+    }
+
+    /// squared distance from i to the parabola of row u.
+    static inline long long f ( const int i, const int u, const int* g ) {
+        const long long  di = i - u;
+        return di*di + (long long)g[u] * g[u];
+    }
+
+    /** \brief Lower envelope of the parabolas of a column.
+     *  \param g row distances
+     *  \param d receives the squared distances (or Infinite)
+     *  \param s scratch: rows of the parabolas in the envelope
+     *  \param t scratch: where each of them starts
+     */
+    void column ( const int* g, long long* d, int* s, int* t ) const {
+        int  q = -1;
+        for (int u=0; u<mH; u++) {
+            if (g[u] >= mInf)    continue;
+            while (q>=0 && f( t[q], s[q], g ) > f( t[q], u, g ))    q--;
+            if (q<0) {
+                q = 0;    s[0] = u;    t[0] = 0;
+                continue;
+            }
+            //first row at which u is nearer than s[q] (floor of the
+            //intersection, plus 1)
+            const long long  i = s[q];
+            const long long  num = (long long)u*u - i*i
+                + (long long)g[u]*g[u] - (long long)g[s[q]]*g[s[q]];
+            const long long  den = 2 * (u - i);
+            long long  sep = num / den;
+            if (num % den != 0 && num < 0)    sep--;
+            if (sep + 1 < mH) {
+                q++;    s[q] = u;    t[q] = (int)(sep + 1);
+            }
+        }
+        if (q<0) {
+            for (int y=0; y<mH; y++)    d[y] = Infinite;
+            return;
+        }
+        for (int y=mH-1; y>=0; y--) {
+            d[y] = f( y, s[q], g );
+            if (y==t[q])    q--;
+        }
+    }
+
+    /** \brief Store the results for one row of a block of columns.
+     *  \param d squared distance of the first column (the others follow
+     *  every mH)
+     *  \param offset where the first column's result goes
+     *  \param n columns in the block
+     */
+    void store ( const long long* d, const size_t offset, const int n ) const {
+        if (mKind==DistanceTransform::Float) {
+            float*  o = (float*)mOut + offset;
+            for (int c=0; c<n; c++) {
+                const long long  v = d[ (size_t)c*mH ];
+                o[c] = (v==Infinite) ? FLT_MAX : (float)sqrt( (double)v );
+            }
+        } else if (mKind==DistanceTransform::Rounded) {
+            int*  o = (int*)mOut + offset;
+            for (int c=0; c<n; c++) {
+                const long long  v = d[ (size_t)c*mH ];
+                o[c] = (v==Infinite) ? INT_MAX : (int)(sqrt( (double)v ) + 0.5);
+            }
+        } else {
+            int*  o = (int*)mOut + offset;
+            for (int c=0; c<n; c++) {
+                const long long  v = d[ (size_t)c*mH ];
+                o[c] = (v > INT_MAX) ? INT_MAX : (int)v;
+            }
+        }
+    }
+};
+//===========================================================================
+/** \brief Squared distances (exact).  Images up to 32767x32767 can't
+ *  overflow; larger distances (and infinite ones) are INT_MAX.
+ *  \param src w*h pixels (0 is background)
+ *  \param w image width
+ *  \param h image height
+ *  \param out receives w*h squared distances
+ *  \returns false if out of memory.
+ */
+bool DistanceTransform::squared ( const int* const src, const int w,
+                                  const int h, int* const out )
+{
+    return compute( src, w, h, Squared, out );
+}
+//---------------------------------------------------------------------------
+/** \brief Distances, rounded to the nearest integer (INT_MAX if infinite).
+ *  \param src w*h pixels (0 is background)
+ *  \param w image width
+ *  \param h image height
+ *  \param out receives w*h distances
+ *  \returns false if out of memory.
+ */
+bool DistanceTransform::distance ( const int* const src, const int w,
+                                   const int h, int* const out )
+{
+    return compute( src, w, h, Rounded, out );
+}
+//---------------------------------------------------------------------------
+/** \brief Distances (FLT_MAX if infinite).
+ *  \param src w*h pixels (0 is background)
+ *  \param w image width
+ *  \param h image height
+ *  \param out receives w*h distances
+ *  \returns false if out of memory.
+ */
+bool DistanceTransform::distance ( const int* const src, const int w,
+                                   const int h, float* const out )
+{
+    return compute( src, w, h, Float, out );
+}
+//---------------------------------------------------------------------------
+/** \brief Transform src into out (results of the given kind).
+ *  \param threads use at most this many threads (0 for all)
+ */
+bool DistanceTransform::compute ( const int* const src, const int w,
+                                  const int h, const int kind,
+                                  void* const out, const int threads )
+{
+    assert( src!=NULL && out!=NULL && w>0 && h>0 );
+    BufferPool&  pool = BufferPool::instance();
+    int*  rows = (int*)pool.allocate( (size_t)w * h * sizeof(int) );
+    if (rows==NULL)    return false;
+    //no row distance reaches w, and no column is longer than h
+    const int  inf = (w < INT_MAX - h) ? w + h : INT_MAX;
+
+    RowTask  r;
+    r.mSrc = src;    r.mDist = rows;    r.mW = w;    r.mInf = inf;
+    ThreadPool::instance().parallelFor( h, r, 16, threads );
+
+    ColumnTask  c;
+    c.mDist = rows;    c.mOut = out;    c.mW = w;    c.mH = h;
+    c.mInf  = inf;     c.mKind = kind;
+    ThreadPool::instance().parallelFor( (w + ColumnBlock - 1) / ColumnBlock,
+                                        c, 1, threads );
+    pool.release( rows );
+    return true;
+}
+//===========================================================================
+/// wall clock time (in seconds).
+static double now ( void ) {
+    #ifdef WIN32
+        LARGE_INTEGER  t, f;
+        QueryPerformanceCounter( &t );
+        QueryPerformanceFrequency( &f );
+        return (double)t.QuadPart / f.QuadPart;
+    #else
+        struct timeval  tv;
+        gettimeofday( &tv, NULL );
+        return tv.tv_sec + tv.tv_usec / 1E6;
+    #endif
+}
+//---------------------------------------------------------------------------
+/** \brief Measure how the transform scales with the number of threads.
+ *  A synthetic w x h image (about 1 pixel in 1000 is 0) is transformed
+ *  (float results) using 1, 2, ... up to all of the pool's threads.
+ *  Other work running meanwhile skews the times.  (See RenderPreviews'
+ *  -benchmark option.)
+ *  \param w image width
+ *  \param h image height
+ *  \param repeats runs per thread count (the fastest is reported)
+ *  \param report if not NULL, receives a table of times and speedups
+ *  \param seconds if not NULL, receives the times (element i is for i+1
+ *  threads)
+ *  \returns false if out of memory.
+ */
+bool DistanceTransform::benchmark ( const int w, const int h,
+                                    const int repeats, FILE* report,
+                                    std::vector<double>* seconds )
+{
+    assert( w>0 && h>0 && repeats>0 );
+    BufferPool&  pool = BufferPool::instance();
+    const size_t  n = (size_t)w * h;
+    int*    src = (int*)pool.allocate( n * sizeof(int) );
+    float*  out = (float*)pool.allocate( n * sizeof(float) );
+    if (src==NULL || out==NULL) {
+        pool.release( src );
+        pool.release( out );
+        return false;
+    }
+    unsigned int  seed = 12345;
+    for (size_t i=0; i<n; i++) {
+        seed = seed * 1103515245 + 12345;
+        src[i] = ((seed >> 16) % 1000 == 0) ? 0 : 1;
+    }
+
+    const int  maxThreads = ThreadPool::instance().getThreadCount();
+    if (seconds!=NULL)    seconds->assign( maxThreads, 0.0 );
+    if (report!=NULL) {
+        fprintf( report, "distance transform of %dx%d:\n", w, h );
+        fprintf( report, "threads   seconds   Mpixels/s   speedup\n" );
+    }
+    double  one = 0;
+    for (int t=1; t<=maxThreads; t++) {
+        double  best = 0;
+        for (int r=0; r<repeats; r++) {
+            const double  start = now();
+            compute( src, w, h, Float, out, t );
+            const double  elapsed = now() - start;
+            if (r==0 || elapsed < best)    best = elapsed;
+        }
+        if (t==1)    one = best;
+        if (seconds!=NULL)    (*seconds)[t-1] = best;
+        if (report!=NULL)
+            fprintf( report, "%7d  %8.4f  %10.1f  %8.2f\n", t, best,
+                     (best > 0) ? n / best / 1E6 : 0.0,
+                     (best > 0) ? one / best : 0.0 );
+    }
+    pool.release( src );
+    pool.release( out );
+    return true;
+}
+//---------------------------------------------------------------------------
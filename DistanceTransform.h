@@ -0,0 +1,69 @@
+/**
+    \file DistanceTransform.h
+    Definition of the DistanceTransform class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef DistanceTransform_h
+#define DistanceTransform_h
+
+#include  <stdio.h>
+#include  <vector>
+//----------------------------------------------------------------------
+/** \brief Exact Euclidean distance transform (Meijster et al.) of a
+ *  binary or label image: every nonzero pixel gets its distance to the
+ *  nearest 0 pixel (0 pixels get 0).
+ *
+ *  The transform is separable and linear in the number of pixels: first
+ *  each row is scanned for the nearest 0 in that row, then each column
+ *  takes the lower envelope of the resulting parabolas.  Rows (and then
+ *  blocks of columns) are independent, so both passes run in parallel
+ *  on the ThreadPool.
+ *
+ *  If an image has no 0 pixels, every distance is infinite: INT_MAX for
+ *  int results and FLT_MAX for float results (which is what
+ *  TIFFWriter::write_tiff_float_grey expects, so float results may be
+ *  written as is).
+ */
+class DistanceTransform {
+public:
+    /// kinds of results.
+    enum { Squared, Rounded, Float };
+
+    static bool squared  ( const int* const src, const int w, const int h,
+                           int* const out );
+    static bool distance ( const int* const src, const int w, const int h,
+                           int* const out );
+    static bool distance ( const int* const src, const int w, const int h,
+                           float* const out );
+    static bool benchmark ( const int w, const int h, const int repeats,
+                            FILE* report, std::vector<double>* seconds );
+
+protected:
+    static bool compute ( const int* const src, const int w, const int h,
+                          const int kind, void* const out,
+                          const int threads=0 );
+};
+
+#endif
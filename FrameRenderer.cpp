@@ -0,0 +1,367 @@
+/**
+    \file FrameRenderer.cpp
+    Implementation of the FrameRenderer class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <math.h>
+#include  "FrameRenderer.h"
+#include  "ImagePyramid.h"
+//---------------------------------------------------------------------------
+/** \brief Start the render thread.
+ *  \param listener told (on the render thread) about new frames
+ */
+FrameRenderer::FrameRenderer ( Listener* listener ) {
+    assert( listener!=NULL );
+    mListener = listener;
+    mFront = 0;    mReady = 1;    mBack = 2;
+    mBytes = 0;
+    mHasPending = mBusy = mHalt = mQuit = false;
+    mPending.src = NULL;
+    #ifdef WIN32
+        mThread = CreateThread( NULL, 0, threadMain, this, 0, NULL );
+    #else
+        mThreadValid = (pthread_create( &mThread, NULL, threadMain, this )==0);
+    #endif
+}
+//---------------------------------------------------------------------------
+FrameRenderer::~FrameRenderer ( ) {
+    {
+        Lock  l( mMutex );
+        mQuit = true;
+    }
+    mWake.set();
+    #ifdef WIN32
+        if (mThread!=NULL) {
+            WaitForSingleObject( mThread, INFINITE );
+            CloseHandle( mThread );
+        }
+    #else
+        if (mThreadValid)    pthread_join( mThread, NULL );
+    #endif
+}
+//---------------------------------------------------------------------------
+#ifdef WIN32
+DWORD WINAPI FrameRenderer::threadMain ( LPVOID arg ) {
+    ((FrameRenderer*)arg)->threadLoop();
+    return 0;
+}
+#else
+void* FrameRenderer::threadMain ( void* arg ) {
+    ((FrameRenderer*)arg)->threadLoop();
+    return NULL;
+}
+#endif
+//---------------------------------------------------------------------------
+/** \brief Show something else (replacing any request not yet taken).  The
+ *  source must remain valid until halt (or until the listener is told
+ *  that rendering has finished).
+ */
+void FrameRenderer::submit ( const Request& r ) {
+    assert( r.src!=NULL && r.spp>=1 );
+    {
+        Lock  l( mMutex );
+        mPending = r;
+        mHasPending = true;
+        mBusy = true;
+    }
+    mWake.set();
+}
+//---------------------------------------------------------------------------
+/** \brief Stop using the source (e.g., before the pixels change): any
+ *  conversion in progress is cancelled and pending requests are dropped.
+ *  Returns when the render thread is idle.  The latest frame is kept.
+ */
+void FrameRenderer::halt ( void ) {
+    #ifdef WIN32
+        if (mThread==NULL)    return;
+    #else
+        if (!mThreadValid)    return;
+    #endif
+    {
+        Lock  l( mMutex );
+        mHalt = true;
+        mHasPending = false;
+        mHalted.reset();
+    }
+    mWake.set();
+    mHalted.wait();
+}
+//---------------------------------------------------------------------------
+/** \brief Halt and discard the tiles (e.g., after the pixels changed; the
+ *  pool keeps the buffers for the next ones).  The latest frame is kept
+ *  (and shown until the next one is ready).
+ */
+void FrameRenderer::clear ( void ) {
+    halt();
+    //(the render thread is idle, so the cache is ours for now)
+    mCache.clear();
+    mBytes = (long)(mSurfaces[0].getBytes() + mSurfaces[1].getBytes()
+                  + mSurfaces[2].getBytes());
+}
+//---------------------------------------------------------------------------
+/** \brief Halt and mark the tiles over a rect of the image as changed
+ *  (e.g., after undo; see DisplayCache::invalidate).  The rest of the
+ *  tiles are kept.
+ */
+void FrameRenderer::invalidate ( const int x0, const int y0, const int x1,
+                                 const int y1 )
+{
+    halt();
+    mCache.invalidate( x0, y0, x1, y1 );
+}
+//---------------------------------------------------------------------------
+/** \brief Halt and free everything (tiles and frames).
+ */
+void FrameRenderer::release ( void ) {
+    clear();
+    for (int i=0; i<3; i++)    mSurfaces[i].release();
+    mBytes = 0;
+}
+//---------------------------------------------------------------------------
+/** \returns true if the latest request isn't complete yet.
+ */
+bool FrameRenderer::isBusy ( void ) {
+    Lock  l( mMutex );
+    return mBusy;
+}
+//---------------------------------------------------------------------------
+/** \brief (UI thread) \returns the latest complete frame (empty if there's
+ *  none).  It remains valid (and unchanged) until the next call.
+ */
+const DisplaySurface& FrameRenderer::frame ( void ) {
+    if (mReady & Fresh)    mFront = (int)(atomicExchange( &mReady, mFront ) & 3);
+    return mSurfaces[mFront];
+}
+//---------------------------------------------------------------------------
+/// (render thread) make the back buffer the latest complete frame.
+void FrameRenderer::publish ( void ) {
+    //(an untaken frame is simply replaced by this one)
+    mBack = (int)(atomicExchange( &mReady, mBack | Fresh ) & 3);
+    mListener->frameReady();
+}
+//---------------------------------------------------------------------------
+/** \brief The pyramid level that tiles are drawn from at a zoom (the
+ *  smallest one that's still at least window resolution), so the work per
+ *  frame depends on the window size rather than the image size.
+ *  \param zoom window pixels per image pixel
+ *  \param w image width
+ *  \param h image height
+ *  \param f receives the scale from that level to the window
+ */
+int FrameRenderer::displayLevel ( const double zoom, const int w,
+                                  const int h, double* f )
+{
+    const int  levels = ImagePyramid::levelCount( w, h );
+    int  level = 0;
+    while (level+1 < levels && zoom * (1 << (level+1)) <= 1)    ++level;
+    *f = zoom * (1 << level);
+    return level;
+}
+//---------------------------------------------------------------------------
+/** \brief Take requests, compose frames, and convert the missing tiles
+ *  (woken by requests and by the TileRenderer as tiles are ready).
+ */
+void FrameRenderer::threadLoop ( void ) {
+    Request  r;              //the request being shown
+    bool     have = false;   //r is valid
+    std::vector<DisplayCache::Tile*>  missing;
+    for ( ; ; ) {
+        mWake.wait();
+        bool  fresh = false;
+        {
+            Lock  l( mMutex );
+            //(anything that happens from here on wakes us again)
+            mWake.reset();
+            if (mQuit)    break;
+            if (mHalt) {
+                mRenderer.cancel();
+                have = false;
+                mHalt = mBusy = false;
+                mHalted.set();
+                continue;
+            }
+            if (mHasPending) {
+                r = mPending;
+                mHasPending = false;
+                fresh = have = true;
+            }
+        }
+        if (!have)    continue;
+        //claimed tiles are finished; the rest are requeued below (if
+        // they're still visible)
+        if (fresh)    mRenderer.cancel();
+        //(sampled first: tiles that become ready while composing wake us
+        // again, so the request isn't complete until they're shown)
+        const bool  converting = mRenderer.isBusy();
+        missing.clear();
+        if (compose( r, &missing ))    publish();
+        else                           missing.clear();  //out of memory
+        if (!missing.empty() && !converting) {
+            for (size_t i=0; i<missing.size(); i++)    mCache.prepare( missing[i] );
+            const double  scale = 1.0 / (1 << r.level);  //level 0 to this level
+            TileRenderer::prioritize( missing,
+                (int)((r.panX + r.w / (2 * r.zoom)) * scale),
+                (int)((r.panY + r.h / (2 * r.zoom)) * scale) );
+            mRenderer.start( r.src, r.levelW, r.levelH, r.spp, r.lut, missing,
+                             this, r.bits );
+        }
+        mBytes = (long)(mCache.getBytes() + mSurfaces[0].getBytes()
+                      + mSurfaces[1].getBytes() + mSurfaces[2].getBytes());
+        if (missing.empty() && !converting) {
+            bool  done = false;
+            {
+                Lock  l( mMutex );
+                if (!mHasPending && mBusy) {
+                    mBusy = false;
+                    done = true;
+                }
+            }
+            if (done)    mListener->renderFinished();
+        }
+    }
+    mRenderer.cancel();
+}
+//---------------------------------------------------------------------------
+/** \brief Compose the whole back buffer (window sized) from the cached
+ *  tiles of the requested level.  Tiles that aren't ready are shown from
+ *  a coarser level (or dark gray); the area outside of the image is gray.
+ *  \param missing receives the visible tiles that need converting
+ *  \returns false if out of memory.
+ */
+bool FrameRenderer::compose ( const Request& r,
+                              std::vector<DisplayCache::Tile*>* missing )
+{
+    DisplaySurface&  s = mSurfaces[mBack];
+    if (!s.resize( r.w, r.h ))    return false;
+    if (r.w==0 || r.h==0)    return true;  //(e.g., minimized)
+    const int  ts = DisplayCache::TileSize;
+    const double  f = r.zoom * (1 << r.level);
+    //keep about two screens worth of tiles
+    const int  screenTiles = (int)(r.w / (f*ts) + 2) * (int)(r.h / (f*ts) + 2);
+    mCache.setCapacity( 2 * screenTiles );
+
+    int  ix0, ix1, iy0, iy1;
+    DisplaySurface::span( -r.panX * r.zoom, r.levelW, f, &ix0, &ix1 );
+    DisplaySurface::span( -r.panY * r.zoom, r.levelH, f, &iy0, &iy1 );
+    s.fill( 0, 0, r.w, iy0, SurfaceGray );
+    s.fill( 0, iy1, r.w, r.h, SurfaceGray );
+    s.fill( 0, iy0, ix0, iy1, SurfaceGray );
+    s.fill( ix1, iy0, r.w, iy1, SurfaceGray );
+    int  tx0, ty0, tx1, ty1;
+    visibleTiles( r, f, &tx0, &ty0, &tx1, &ty1 );
+    for (int ty=ty0; ty<ty1; ty++) {
+        for (int tx=tx0; tx<tx1; tx++) {
+            DisplayCache::Tile*  t = mCache.acquire( r.level, tx, ty, r.levelW, r.levelH );
+            if (t!=NULL)    mCache.commit( t );
+            //(an out of date tile is shown until it's replaced; it's
+            // converted into a spare buffer meanwhile)
+            if (t!=NULL && t->version!=0)    drawTile( s, r, t, f, 0, 0, r.w, r.h );
+            else                             drawMissing( s, r, tx, ty, f );
+            if (t!=NULL && (t->state==DisplayCache::Empty
+                         || (t->state==DisplayCache::Ready && isStale( r, t ))))
+                missing->push_back( t );
+        }
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief The tiles of the requested level that are (at least partly) in
+ *  the window: [tx0,tx1) x [ty0,ty1).
+ */
+void FrameRenderer::visibleTiles ( const Request& r, const double f,
+                                   int* tx0, int* ty0, int* tx1, int* ty1 )
+{
+    const int  ts = DisplayCache::TileSize;
+    const double  scale = f * ts;  //window pixels per tile
+    *tx0 = (int)floor( r.panX * r.zoom / scale );
+    *ty0 = (int)floor( r.panY * r.zoom / scale );
+    *tx1 = (int)ceil( (r.panX * r.zoom + r.w) / scale );
+    *ty1 = (int)ceil( (r.panY * r.zoom + r.h) / scale );
+    if (*tx0<0)    *tx0 = 0;
+    if (*ty0<0)    *ty0 = 0;
+    if (*tx1 > (r.levelW + ts - 1) / ts)    *tx1 = (r.levelW + ts - 1) / ts;
+    if (*ty1 > (r.levelH + ts - 1) / ts)    *ty1 = (r.levelH + ts - 1) / ts;
+}
+//---------------------------------------------------------------------------
+/** \brief Draw a tile (of any level) at its place in a frame, clipped to
+ *  [cx0,cx1) x [cy0,cy1).
+ *  \param f scale from the tile's level to the window
+ */
+void FrameRenderer::drawTile ( DisplaySurface& s, const Request& r,
+                               const DisplayCache::Tile* t, const double f,
+                               const int cx0, const int cy0, const int cx1,
+                               const int cy1 )
+{
+    s.drawScaled( t->pixels, t->stride, t->w, t->h,
+                  t->x0 * f - r.panX * r.zoom, t->y0 * f - r.panY * r.zoom,
+                  f, r.bilinear, cx0, cy0, cx1, cy1 );
+}
+//---------------------------------------------------------------------------
+/** \brief Fill in for a tile that isn't ready: scaled up from a cached
+ *  coarser level if possible (otherwise dark gray).
+ *  \param tx tile column (of the requested level)
+ *  \param ty tile row
+ *  \param f scale from the level to the window
+ */
+void FrameRenderer::drawMissing ( DisplaySurface& s, const Request& r,
+                                  const int tx, const int ty, const double f )
+{
+    const int  ts = DisplayCache::TileSize;
+    const int  w = (r.levelW - tx*ts < ts) ? r.levelW - tx*ts : ts;
+    const int  h = (r.levelH - ty*ts < ts) ? r.levelH - ty*ts : ts;
+    int  cx0, cx1, cy0, cy1;
+    DisplaySurface::span( tx*ts*f - r.panX * r.zoom, w, f, &cx0, &cx1 );
+    DisplaySurface::span( ty*ts*f - r.panY * r.zoom, h, f, &cy0, &cy1 );
+    for (int k=1; k<=FallbackLevels; k++) {
+        DisplayCache::Tile*  p = mCache.find( r.level+k, tx >> k, ty >> k );
+        if (p!=NULL)    mCache.commit( p );
+        if (p!=NULL && p->version!=0) {
+            drawTile( s, r, p, f * (1 << k), cx0, cy0, cx1, cy1 );
+            return;
+        }
+    }
+    s.fill( cx0, cy0, cx1, cy1, SurfaceDarkGray );
+}
+//---------------------------------------------------------------------------
+/** \brief \returns true if a tile was converted with a different mapping
+ *  (e.g., before the window was changed), or before the image changed.
+ */
+bool FrameRenderer::isStale ( const Request& r,
+                              const DisplayCache::Tile* t ) const
+{
+    return t->changed || (r.spp==1 && t->version!=r.lut.getVersion());
+}
+//---------------------------------------------------------------------------
+/// (worker thread) recompose with the new tile.
+void FrameRenderer::tileReady ( const int level, const int tx, const int ty ) {
+    mWake.set();
+}
+//---------------------------------------------------------------------------
+/// (worker thread) recompose and see if the request is complete.
+void FrameRenderer::renderFinished ( void ) {
+    mWake.set();
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,151 @@
+/**
+    \file FrameRenderer.h
+    Definition of the FrameRenderer class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef FrameRenderer_h
+#define FrameRenderer_h
+
+#include  <vector>
+#include  "DisplayCache.h"
+#include  "DisplayLUT.h"
+#include  "DisplaySurface.h"
+#include  "ThreadPool.h"
+#include  "TileRenderer.h"
+//----------------------------------------------------------------------
+/** \brief Composes a view's frames (window sized, from the cached tiles
+ *  of the level for the zoom) on its own thread.
+ *
+ *  The thread owns the tile cache and the TileRenderer.  Each request
+ *  (the latest one wins) is composed into a back buffer at once (tiles
+ *  that aren't ready are shown from a coarser level or dark gray), and
+ *  again as the missing tiles are converted.  A complete frame is handed
+ *  to the UI thread by exchanging buffer indices (no lock), so painting
+ *  just copies the latest frame and never waits for pixel work.
+ *
+ *  There are three buffers: the one being painted (front, UI thread), the
+ *  one being composed (back, render thread), and the latest complete one
+ *  (ready) that either thread swaps its own for.
+ */
+class FrameRenderer : protected TileRenderer::Listener {
+public:
+    /// what to show (the source must remain valid until halt).
+    struct Request {
+        const int*  src;           ///< samples of the level (gray, or interleaved rgb)
+        const BitImage*  bits;     ///< src packed (binary level 0; or NULL)
+        int         level;         ///< pyramid level (see displayLevel)
+        int         levelW, levelH;///< size of the level
+        int         spp;           ///< samples per pixel (1 or 3)
+        int         w, h;          ///< window size
+        double      zoom;          ///< window pixels per image pixel
+        double      panX, panY;    ///< image position at the window's upper left
+        bool        bilinear;      ///< filter zoomed tiles (otherwise, nearest)
+        DisplayLUT  lut;           ///< gray value to display pixel
+    };
+
+    /// receives notifications (on the render thread).
+    class Listener {
+    public:
+        virtual ~Listener ( ) { }
+        /// a new frame is ready (see frame).
+        virtual void frameReady ( void ) = 0;
+        /// the latest request is complete (all of its tiles are ready).
+        virtual void renderFinished ( void ) = 0;
+    };
+
+    /// cached coarser levels shown (scaled) while a tile isn't ready.
+    enum { FallbackLevels = 3 };
+    /// colors (BGRX) outside the image and of tiles not yet ready.
+    enum { SurfaceGray = 0x808080, SurfaceDarkGray = 0x404040 };
+
+    FrameRenderer  ( Listener* listener );
+    ~FrameRenderer ( );
+
+    void   submit  ( const Request& r );
+    void   halt    ( void );
+    void   clear   ( void );
+    void   invalidate ( const int x0, const int y0, const int x1, const int y1 );
+    void   release ( void );
+    bool   isBusy  ( void );
+    const DisplaySurface&  frame ( void );
+    /// \returns the memory held by tiles and frames (in bytes).
+    inline size_t getBytes ( void ) const {  return (size_t)mBytes;  }
+
+    static int  displayLevel ( const double zoom, const int w, const int h,
+                               double* f );
+
+protected:
+    enum { Fresh = 4 };  ///< (in mReady) the frame hasn't been taken yet
+
+    Listener*       mListener;
+    DisplayCache    mCache;      ///< displayable tiles (render thread only)
+    TileRenderer    mRenderer;   ///< fills the tiles in mCache
+    DisplaySurface  mSurfaces[3];
+    int             mFront;      ///< index of the frame being painted (UI thread)
+    int             mBack;       ///< index of the frame being composed (render thread)
+    volatile long   mReady;      ///< index of the latest complete frame (| Fresh)
+    volatile long   mBytes;      ///< see getBytes
+
+    Mutex           mMutex;      ///< protects the members below
+    Request         mPending;    ///< the latest request (not yet taken)
+    bool            mHasPending; ///< mPending is valid
+    bool            mBusy;       ///< a request isn't complete yet
+    bool            mHalt;       ///< stop using the source (see halt)
+    bool            mQuit;       ///< the thread should exit
+    Event           mWake;       ///< something for the thread to do
+    Event           mHalted;     ///< the thread has halted
+
+    #ifdef WIN32
+        HANDLE      mThread;
+        static DWORD WINAPI  threadMain ( LPVOID arg );
+    #else
+        pthread_t   mThread;
+        bool        mThreadValid;
+        static void*         threadMain ( void* arg );
+    #endif
+
+    void   threadLoop ( void );
+    bool   compose ( const Request& r, std::vector<DisplayCache::Tile*>* missing );
+    void   visibleTiles ( const Request& r, const double f, int* tx0,
+                          int* ty0, int* tx1, int* ty1 );
+    void   drawTile ( DisplaySurface& s, const Request& r,
+                      const DisplayCache::Tile* t, const double f,
+                      const int cx0, const int cy0, const int cx1,
+                      const int cy1 );
+    void   drawMissing ( DisplaySurface& s, const Request& r, const int tx,
+                         const int ty, const double f );
+    bool   isStale ( const Request& r, const DisplayCache::Tile* t ) const;
+    void   publish ( void );
+
+    virtual void tileReady ( const int level, const int tx, const int ty );
+    virtual void renderFinished ( void );
+
+private:
+    FrameRenderer ( const FrameRenderer& );
+    FrameRenderer& operator= ( const FrameRenderer& );
+};
+
+#endif
+//----------------------------------------------------------------------
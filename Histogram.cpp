@@ -0,0 +1,230 @@
+/**
+    \file Histogram.cpp
+    Implementation of the Histogram class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <limits.h>
+#include  "Histogram.h"
+#include  "ThreadPool.h"
+
+/// at most this many bins get 4 sub-histograms per worker.
+static const int  SpreadBins = 4096;
+//---------------------------------------------------------------------------
+/// bins of 8 bit samples (one per value).
+struct ByteBins {
+    inline unsigned int operator() ( const unsigned char v ) const {  return v;  }
+};
+//---------------------------------------------------------------------------
+/// power of 2 wide bins of integer samples.
+template <class T>
+struct ShiftBins {
+    long long  first;
+    int        shift;
+    inline unsigned int operator() ( const T v ) const {
+        const long long  d = (long long)v - first;
+        return (d<0) ? UINT_MAX : (unsigned int)(d >> shift);
+    }
+};
+//---------------------------------------------------------------------------
+/// evenly divided [lo,hi) bins of float samples.
+struct FloatBins {
+    double        lo, scale;
+    unsigned int  bins;
+    inline unsigned int operator() ( const float v ) const {
+        const double  x = (v - lo) * scale;
+        return (x>=0 && x<bins) ? (unsigned int)x : bins;  //(NaN fails both)
+    }
+};
+//---------------------------------------------------------------------------
+/// count rows [begin,end) of the rect.
+template <class T, class Bins>
+class CountTask : public ThreadPool::RangeTask {
+public:
+    const T*      mSrc;
+    int           mW, mSpp, mX0, mX1, mY0;
+    Bins          mBins;
+    unsigned int  mCount;   ///< bins
+    int           mWays;    ///< sub-histograms per worker
+    std::vector< std::vector<unsigned int> >  mSub;      ///< per worker
+    std::vector<long long>                    mCounted;  ///< per worker
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const unsigned int  n = mCount;
+        if (mSub[worker].empty())    mSub[worker].assign( (size_t)n * mWays, 0 );
+        unsigned int*  h = &mSub[worker][0];
+        long long  counted = 0;
+        const int  samples = (mX1 - mX0) * mSpp;
+        for (int y=begin; y<end; y++) {
+            const T*  p = mSrc + ((size_t)(mY0 + y) * mW + mX0) * mSpp;
+            int  i = 0;
+            if (mWays==4) {
+                unsigned int*  h1 = h + n;
+                unsigned int*  h2 = h1 + n;
+                unsigned int*  h3 = h2 + n;
+                for ( ; i+4<=samples; i+=4) {
+                    const unsigned int  b0 = mBins( p[i] ),   b1 = mBins( p[i+1] );
+                    const unsigned int  b2 = mBins( p[i+2] ), b3 = mBins( p[i+3] );
+                    if (b0<n) {  ++h[b0];   ++counted;  }
+                    if (b1<n) {  ++h1[b1];  ++counted;  }
+                    if (b2<n) {  ++h2[b2];  ++counted;  }
+                    if (b3<n) {  ++h3[b3];  ++counted;  }
+                }
+            }
+            for ( ; i<samples; i++) {
+                const unsigned int  b = mBins( p[i] );
+                if (b<n) {  ++h[b];  ++counted;  }
+            }
+        }
+        mCounted[worker] += counted;
+    }
+};
+//---------------------------------------------------------------------------
+/// count the rect (clipped to the image) into hist (bins bins).
+template <class T, class Bins>
+static long long countRect ( const T* const src, const int w, const int h,
+                             const int spp, int x0, int y0, int x1, int y1,
+                             const Bins& bins, const int n,
+                             std::vector<unsigned int>* hist )
+{
+    assert( src!=NULL && w>0 && h>0 && (spp==1 || spp==3) );
+    assert( n>0 && hist!=NULL );
+    hist->assign( n, 0 );
+    if (x0<0)    x0 = 0;
+    if (y0<0)    y0 = 0;
+    if (x1>w)    x1 = w;
+    if (y1>h)    y1 = h;
+    if (x0>=x1 || y0>=y1)    return 0;
+
+    ThreadPool&  pool = ThreadPool::instance();
+    CountTask<T,Bins>  t;
+    t.mSrc = src;    t.mW = w;    t.mSpp = spp;
+    t.mX0 = x0;      t.mX1 = x1;  t.mY0 = y0;
+    t.mBins = bins;  t.mCount = n;
+    t.mWays = (n <= SpreadBins) ? 4 : 1;
+    t.mSub.resize( pool.getThreadCount() );
+    t.mCounted.assign( pool.getThreadCount(), 0 );
+    //(enough rows per range that a worker's sub-histograms pay off)
+    const int  grain = 1 + (int)(65536 / ((long long)(x1 - x0) * spp));
+    pool.parallelFor( y1 - y0, t, grain );
+
+    long long  counted = 0;
+    unsigned int*  d = &(*hist)[0];
+    for (size_t k=0; k<t.mSub.size(); k++) {
+        counted += t.mCounted[k];
+        if (t.mSub[k].empty())    continue;
+        const unsigned int*  s = &t.mSub[k][0];
+        for (int j=0; j<t.mWays; j++, s+=n)
+            for (int i=0; i<n; i++)    d[i] += s[i];
+    }
+    return counted;
+}
+//===========================================================================
+/** \brief Histogram (256 bins, one per value) of a rect of an 8 bit image.
+ *  \param src w*h pixels (spp samples each)
+ *  \param w image width
+ *  \param h image height
+ *  \param spp samples per pixel (1 or 3)
+ *  \param x0 left column of the rect (inclusive)
+ *  \param y0 top row (inclusive)
+ *  \param x1 right column (exclusive)
+ *  \param y1 bottom row (exclusive)
+ *  \param hist receives the counts
+ *  \returns the number of samples counted.
+ */
+long long Histogram::count ( const unsigned char* const src, const int w,
+                             const int h, const int spp, const int x0,
+                             const int y0, const int x1, const int y1,
+                             std::vector<unsigned int>* hist )
+{
+    return countRect( src, w, h, spp, x0, y0, x1, y1, ByteBins(), 256, hist );
+}
+//---------------------------------------------------------------------------
+/** \brief Histogram (65536>>shift bins) of a rect of a 16 bit image
+ *  (parameters as above).
+ *  \param shift log2 of the bin width
+ */
+long long Histogram::count ( const unsigned short* const src, const int w,
+                             const int h, const int spp, const int x0,
+                             const int y0, const int x1, const int y1,
+                             const int shift, std::vector<unsigned int>* hist )
+{
+    assert( shift>=0 && shift<16 );
+    ShiftBins<unsigned short>  b;
+    b.first = 0;    b.shift = shift;
+    return countRect( src, w, h, spp, x0, y0, x1, y1, b, 65536 >> shift, hist );
+}
+//---------------------------------------------------------------------------
+/** \brief Histogram of a rect of an int image (parameters as above).
+ *  \param first value of the first bin
+ *  \param shift log2 of the bin width
+ *  \param bins number of bins
+ */
+long long Histogram::count ( const int* const src, const int w, const int h,
+                             const int spp, const int x0, const int y0,
+                             const int x1, const int y1, const int first,
+                             const int shift, const int bins,
+                             std::vector<unsigned int>* hist )
+{
+    assert( shift>=0 && shift<32 );
+    ShiftBins<int>  b;
+    b.first = first;    b.shift = shift;
+    return countRect( src, w, h, spp, x0, y0, x1, y1, b, bins, hist );
+}
+//---------------------------------------------------------------------------
+/** \brief Histogram of a rect of a float image (parameters as above).
+ *  \param lo lower edge of the first bin
+ *  \param hi upper edge of the last bin
+ *  \param bins number of bins
+ */
+long long Histogram::count ( const float* const src, const int w,
+                             const int h, const int spp, const int x0,
+                             const int y0, const int x1, const int y1,
+                             const double lo, const double hi,
+                             const int bins, std::vector<unsigned int>* hist )
+{
+    assert( hi>lo );
+    FloatBins  b;
+    b.lo = lo;    b.scale = bins / (hi - lo);    b.bins = bins;
+    return countRect( src, w, h, spp, x0, y0, x1, y1, b, bins, hist );
+}
+//---------------------------------------------------------------------------
+/** \brief Choose int bins covering [lo,hi]: one bin per value when there
+ *  are at most 65536 distinct values, else power of 2 wide bins (as
+ *  ImageStats does).
+ *  \param lo value of the first bin
+ *  \param hi largest value
+ *  \param shift receives log2 of the bin width
+ *  \returns the number of bins.
+ */
+int Histogram::binning ( const int lo, const int hi, int* shift ) {
+    assert( lo<=hi && shift!=NULL );
+    const long long  range = (long long)hi - lo;
+    int  s = 0;
+    while ((range >> s) >= 65536)    ++s;
+    *shift = s;
+    return (int)(range >> s) + 1;
+}
+//---------------------------------------------------------------------------
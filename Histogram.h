@@ -0,0 +1,70 @@
+/**
+    \file Histogram.h
+    Definition of the Histogram class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef Histogram_h
+#define Histogram_h
+
+#include  <vector>
+//----------------------------------------------------------------------
+/** \brief Parallel histograms of (a rect of) 8 bit, 16 bit, int, or float
+ *  images (all samples, so r, g, and b are combined for color).
+ *
+ *  Rows are counted in parallel, each worker into its own sub-histograms,
+ *  and the sub-histograms are added up at the end.  With few bins (all 8
+ *  bit histograms), each worker keeps 4 sub-histograms and spreads
+ *  consecutive samples over them, so that runs of equal values don't
+ *  stall on incrementing the same count.
+ *
+ *  Integer bins are power of 2 wide (bin i counts values in
+ *  [first + (i<<shift), first + ((i+1)<<shift)), as for ImageStats);
+ *  float bins divide [lo,hi) evenly.  Samples outside the bins are not
+ *  counted.
+ */
+class Histogram {
+public:
+    static long long count ( const unsigned char* const src, const int w,
+                             const int h, const int spp, const int x0,
+                             const int y0, const int x1, const int y1,
+                             std::vector<unsigned int>* hist );
+    static long long count ( const unsigned short* const src, const int w,
+                             const int h, const int spp, const int x0,
+                             const int y0, const int x1, const int y1,
+                             const int shift, std::vector<unsigned int>* hist );
+    static long long count ( const int* const src, const int w, const int h,
+                             const int spp, const int x0, const int y0,
+                             const int x1, const int y1, const int first,
+                             const int shift, const int bins,
+                             std::vector<unsigned int>* hist );
+    static long long count ( const float* const src, const int w,
+                             const int h, const int spp, const int x0,
+                             const int y0, const int x1, const int y1,
+                             const double lo, const double hi,
+                             const int bins, std::vector<unsigned int>* hist );
+    static int binning ( const int lo, const int hi, int* shift );
+};
+
+#endif
@@ -0,0 +1,309 @@
+/**
+    \file ImageContainer.cpp
+    Implementation of the ImageContainer class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <ctype.h>
+#include  <limits.h>
+#include  <string.h>
+#include  "BufferPool.h"
+#include  "ImageContainer.h"
+#include  "ImagePyramid.h"
+
+static const char  Magic[8]  = "IVCNTNR";
+static const unsigned int  ByteOrderMark = 0x01020304;
+/// pyramid levels are added until the image fits in this many pixels.
+static const int  PyramidMinSize = 256;
+//----------------------------------------------------------------------
+/** \brief Is this the name of a native container file (.ivc)?
+ */
+bool ImageContainer::isContainerName ( const char* const fname ) {
+    if (fname==NULL)    return false;
+    const char*  dot = strrchr( fname, '.' );
+    if (dot==NULL || strlen(dot)!=4)    return false;
+    return tolower( (unsigned char)dot[1] )=='i'
+        && tolower( (unsigned char)dot[2] )=='v'
+        && tolower( (unsigned char)dot[3] )=='c';
+}
+//----------------------------------------------------------------------
+/** \brief Write zeros until the output position reaches to.
+ */
+bool ImageContainer::pad ( Sink& out, long long* pos, const long long to ) {
+    static const char  zeros[ Alignment ] = { 0 };
+    while (*pos < to) {
+        const size_t  n = (to - *pos < Alignment) ? (size_t)(to - *pos)
+                                                  : (size_t)Alignment;
+        if (!out.write( zeros, n ))    return false;
+        *pos += n;
+    }
+    return true;
+}
+//----------------------------------------------------------------------
+/** \brief Write an image (and, optionally, its statistics and a pyramid
+ *  of reduced resolution copies) as a native container.
+ *  \param out             destination
+ *  \param data            image samples (gray, or interleaved rgb)
+ *  \param w               image width
+ *  \param h               image height
+ *  \param samplesPerPixel 1 or 3
+ *  \param min             overall min sample value
+ *  \param max             overall max sample value
+ *  \param stats           statistics to be cached (may be NULL)
+ *  \param pyramid         if true, also write 1/2, 1/4, ... size levels
+ *                         (until the image fits in 256x256)
+ *  \param progress        receives progress reports (may be NULL)
+ *  \returns true if successful.
+ */
+bool ImageContainer::write ( Sink& out, const int* const data, const int w,
+                             const int h, const int samplesPerPixel,
+                             const int min, const int max,
+                             const ImageStats::Snapshot* stats, const bool pyramid,
+                             ImageSaver::Progress* progress )
+{
+    assert( data!=NULL && w>0 && h>0 );
+    assert( samplesPerPixel==1 || samplesPerPixel==3 );
+    const int  spp = samplesPerPixel;
+
+    //the pyramid is built first since its offsets go in the header
+    std::vector<const int*>  levelData( 1, data );
+    std::vector<int>         levelW( 1, w ), levelH( 1, h );
+    while ( pyramid && (int)levelData.size() < MaxLevels
+         && (levelW.back() > PyramidMinSize || levelH.back() > PyramidMinSize) )
+    {
+        int   nw, nh;
+        int*  p = ImagePyramid::halve( levelData.back(), levelW.back(),
+                                       levelH.back(), spp, min, max, &nw, &nh );
+        if (p==NULL)    break;  //just fewer levels
+        levelData.push_back( p );
+        levelW.push_back( nw );
+        levelH.push_back( nh );
+    }
+
+    Header  hdr;
+    memset( &hdr, 0, sizeof hdr );
+    memcpy( hdr.magic, Magic, sizeof hdr.magic );
+    hdr.byteOrder       = ByteOrderMark;
+    hdr.version         = Version;
+    hdr.headerBytes     = sizeof hdr;
+    hdr.width           = w;
+    hdr.height          = h;
+    hdr.sampleType      = SampleInt32;
+    hdr.samplesPerPixel = spp;
+    hdr.layout          = (spp==1) ? LayoutGray : LayoutInterleaved;
+    hdr.min             = min;
+    hdr.max             = max;
+    hdr.levelCount      = (unsigned int)levelData.size();
+
+    long long  pos = sizeof hdr;
+    if (stats!=NULL && !stats->tiles.empty() && !stats->hist.empty()) {
+        hdr.tileSize    = stats->tileSize;
+        hdr.tileCount   = (unsigned int)stats->tiles.size();
+        hdr.histFirst   = stats->histFirst;
+        hdr.histShift   = stats->histShift;
+        hdr.histBins    = (unsigned int)stats->hist.size();
+        hdr.statsOffset = pos;
+        pos += (long long)hdr.tileCount * sizeof(ImageStats::TileStats);
+        hdr.histOffset  = pos;
+        pos += (long long)hdr.histBins * sizeof(unsigned int);
+    }
+    long long  total = 0;
+    for (unsigned int i=0; i<hdr.levelCount; i++) {
+        Level&  lv = hdr.levels[i];
+        pos = (pos + Alignment - 1) / Alignment * Alignment;
+        lv.width  = levelW[i];
+        lv.height = levelH[i];
+        lv.stride = levelW[i] * spp * sizeof(int);
+        lv.offset = pos;
+        lv.bytes  = (long long)lv.stride * lv.height;
+        pos   += lv.bytes;
+        total += lv.bytes;
+    }
+
+    pos = 0;
+    bool  ok = out.write( &hdr, sizeof hdr );
+    pos += sizeof hdr;
+    if (ok && hdr.tileCount>0) {
+        ok = out.write( &stats->tiles[0],
+                        hdr.tileCount * sizeof(ImageStats::TileStats) )
+          && out.write( &stats->hist[0], hdr.histBins * sizeof(unsigned int) );
+        pos = hdr.histOffset + hdr.histBins * sizeof(unsigned int);
+    }
+    long long  done = 0;
+    for (unsigned int i=0; ok && i<hdr.levelCount; i++) {
+        const Level&  lv = hdr.levels[i];
+        ok = pad( out, &pos, lv.offset );
+        //a band of rows at a time (for progress reports)
+        const int  rows = 64;
+        for (unsigned int y=0; ok && y<lv.height; y+=rows) {
+            const unsigned int  n = (y+rows <= lv.height) ? rows : lv.height-y;
+            ok = out.write( (const char*)levelData[i] + (size_t)y * lv.stride,
+                            (size_t)n * lv.stride );
+            pos  += (long long)n * lv.stride;
+            done += (long long)n * lv.stride;
+            if (progress!=NULL)
+                progress->report( (int)(99.0 * done / total) );
+        }
+    }
+
+    for (size_t i=1; i<levelData.size(); i++)
+        BufferPool::instance().release( (void*)levelData[i] );
+    return ok;
+}
+//----------------------------------------------------------------------
+/** \brief Check the consistency of a header.
+ *  \param fileSize size of the file (or -1 if unknown)
+ */
+bool ImageContainer::checkHeader ( const Header& h, const long long fileSize ) {
+    if (memcmp( h.magic, Magic, sizeof h.magic )!=0)    return false;
+    if (h.byteOrder!=ByteOrderMark || h.version!=Version)    return false;
+    if (h.headerBytes!=sizeof(Header) || h.sampleType!=SampleInt32)
+        return false;
+    if (h.samplesPerPixel==1 && h.layout!=LayoutGray)    return false;
+    if (h.samplesPerPixel==3 && h.layout!=LayoutInterleaved)    return false;
+    if (h.samplesPerPixel!=1 && h.samplesPerPixel!=3)    return false;
+    if (h.width==0 || h.height==0 || h.width>INT_MAX/4 || h.height>INT_MAX/4)
+        return false;
+    if (h.levelCount<1 || h.levelCount>MaxLevels)    return false;
+    if (h.levels[0].width!=h.width || h.levels[0].height!=h.height)
+        return false;
+    const long long  limit = (fileSize<0) ? LLONG_MAX : fileSize;
+    for (unsigned int i=0; i<h.levelCount; i++) {
+        const Level&  lv = h.levels[i];
+        const long long  stride = (long long)lv.width * h.samplesPerPixel
+                                * sizeof(int);
+        if (lv.width==0 || lv.height==0 || lv.stride!=stride)    return false;
+        if (lv.bytes!=stride * lv.height || lv.offset % Alignment!=0)
+            return false;
+        if (lv.offset < (long long)sizeof(Header) || lv.offset > limit
+            || lv.bytes > limit - lv.offset)
+            return false;
+    }
+    if (h.tileCount>0) {
+        const long long  tb = (long long)h.tileCount
+                            * sizeof(ImageStats::TileStats);
+        const long long  hb = (long long)h.histBins * sizeof(unsigned int);
+        if (h.statsOffset < (long long)sizeof(Header) || h.statsOffset > limit
+            || tb > limit - h.statsOffset)
+            return false;
+        if (h.histOffset < h.statsOffset + tb || h.histOffset > limit
+            || hb > limit - h.histOffset || h.histBins==0)
+            return false;
+        if (h.histOffset + hb > h.levels[0].offset)    return false;
+    }
+    return true;
+}
+//----------------------------------------------------------------------
+/** \brief Check a (mapped) container file.
+ *  \param file     the entire file
+ *  \param fileSize size of the file
+ *  \returns its header (or NULL if it isn't a valid container).
+ */
+const ImageContainer::Header* ImageContainer::validate (
+    const unsigned char* const file, const size_t fileSize )
+{
+    if (file==NULL || fileSize < sizeof(Header))    return NULL;
+    const Header*  h = (const Header*)file;
+    if (!checkHeader( *h, (long long)fileSize ))    return NULL;
+    return h;
+}
+//----------------------------------------------------------------------
+/** \brief Copy the cached statistics (if any) out of a validated file.
+ */
+void ImageContainer::getStats ( const Header& header,
+                                const unsigned char* const file,
+                                ImageStats::Snapshot* stats )
+{
+    stats->tileSize  = header.tileSize;
+    stats->histFirst = header.histFirst;
+    stats->histShift = header.histShift;
+    stats->tiles.clear();
+    stats->hist.clear();
+    if (header.tileCount==0)    return;
+    const ImageStats::TileStats*  t =
+        (const ImageStats::TileStats*)(file + header.statsOffset);
+    stats->tiles.assign( t, t + header.tileCount );
+    const unsigned int*  b = (const unsigned int*)(file + header.histOffset);
+    stats->hist.assign( b, b + header.histBins );
+}
+//----------------------------------------------------------------------
+/** \brief Discard input until the input position reaches to.
+ */
+static bool skipTo ( ImageContainer::Source& in, long long* pos,
+                     const long long to )
+{
+    char  skip[ ImageContainer::Alignment ];
+    while (*pos < to) {
+        const size_t  n = (to - *pos < (long long)sizeof skip)
+                        ? (size_t)(to - *pos) : sizeof skip;
+        if (!in.read( skip, n ))    return false;
+        *pos += n;
+    }
+    return true;
+}
+//----------------------------------------------------------------------
+/** \brief Read a container sequentially (when it can't be mapped).  Only
+ *  the full resolution level is kept.
+ *  \param in     source (positioned at the start of the container)
+ *  \param header (output) the header
+ *  \param stats  (output) the cached statistics (may be NULL)
+ *  \returns the samples (release with BufferPool) or NULL on failure.
+ */
+int* ImageContainer::read ( Source& in, Header* header, ImageStats::Snapshot* stats ) {
+    assert( header!=NULL );
+    if (!in.read( header, sizeof *header ))    return NULL;
+    if (!checkHeader( *header, -1 ))    return NULL;
+    long long  pos = sizeof *header;
+    if (stats!=NULL) {
+        stats->tileSize  = header->tileSize;
+        stats->histFirst = header->histFirst;
+        stats->histShift = header->histShift;
+        stats->tiles.clear();
+        stats->hist.clear();
+    }
+    if (header->tileCount>0) {
+        //sections are in file order: stats, histogram, level 0
+        std::vector<ImageStats::TileStats>  tiles( header->tileCount );
+        std::vector<unsigned int>           hist( header->histBins );
+        if (!skipTo( in, &pos, header->statsOffset ))    return NULL;
+        if (!in.read( &tiles[0], tiles.size() * sizeof tiles[0] ))
+            return NULL;
+        pos += tiles.size() * sizeof tiles[0];
+        if (!skipTo( in, &pos, header->histOffset ))    return NULL;
+        if (!in.read( &hist[0], hist.size() * sizeof hist[0] ))    return NULL;
+        pos += hist.size() * sizeof hist[0];
+        if (stats!=NULL) {  stats->tiles.swap( tiles );  stats->hist.swap( hist );  }
+    }
+    const Level&  lv = header->levels[0];
+    if (!skipTo( in, &pos, lv.offset ))    return NULL;
+    int*  data = (int*)BufferPool::instance().allocate( (size_t)lv.bytes );
+    if (data==NULL)    return NULL;
+    if (!in.read( data, (size_t)lv.bytes )) {
+        BufferPool::instance().release( data );
+        return NULL;
+    }
+    return data;
+}
+//----------------------------------------------------------------------
@@ -0,0 +1,128 @@
+/**
+    \file ImageContainer.h
+    Definition of the ImageContainer class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef ImageContainer_h
+#define ImageContainer_h
+
+#include  <stddef.h>
+#include  <vector>
+#include  "ImageSaver.h"
+#include  "ImageStats.h"
+//----------------------------------------------------------------------
+/** \brief ImageViewer's native image file format (.ivc).
+ *
+ *  The file holds the samples exactly as ImageData keeps them in memory,
+ *  so it can be mapped and used in place (no parsing or conversion) when
+ *  it is reopened.  Layout:
+ *  <pre>
+ *  header              (fixed size, see Header)
+ *  per tile statistics (ImageStats::TileStats, optional)
+ *  histogram           (unsigned int bins, optional)
+ *  level 0 samples     (full resolution; page aligned)
+ *  level 1 samples     (1/2 size, 2x2 box filtered; page aligned, optional)
+ *  ...
+ *  </pre>
+ *  All values are stored in native (little endian) byte order.  Files
+ *  written with the other byte order are rejected.
+ */
+class ImageContainer {
+public:
+    enum {
+        Version   = 1,
+        Alignment = 4096,   ///< file offset alignment of the sample data
+        MaxLevels = 16      ///< max number of pyramid levels (incl. level 0)
+    };
+    enum {  SampleInt32 = 1  };                       ///< sample types
+    enum {  LayoutGray = 0, LayoutInterleaved = 1  }; ///< channel layouts
+
+    /// one resolution level.
+    struct Level {
+        unsigned int  width;    ///< in pixels
+        unsigned int  height;   ///< in pixels
+        unsigned int  stride;   ///< bytes per row
+        unsigned int  reserved;
+        long long     offset;   ///< file offset of the first sample
+        long long     bytes;    ///< size of the samples
+    };
+
+    /// fixed size file header (at offset 0).
+    struct Header {
+        char          magic[8];        ///< "IVCNTNR" (nul terminated)
+        unsigned int  byteOrder;       ///< 0x01020304 as written
+        unsigned int  version;         ///< Version
+        unsigned int  headerBytes;     ///< sizeof(Header)
+        unsigned int  width;           ///< image width (level 0)
+        unsigned int  height;          ///< image height (level 0)
+        unsigned int  sampleType;      ///< SampleInt32
+        unsigned int  samplesPerPixel; ///< 1 or 3
+        unsigned int  layout;          ///< LayoutGray or LayoutInterleaved
+        int           min, max;        ///< overall min and max sample
+        unsigned int  tileSize;        ///< stats tile size (0 if no stats)
+        unsigned int  tileCount;       ///< number of TileStats
+        int           histFirst;       ///< value of the first histogram bin
+        int           histShift;       ///< log2 of the histogram bin width
+        unsigned int  histBins;        ///< number of histogram bins
+        unsigned int  levelCount;      ///< number of levels (incl. level 0)
+        long long     statsOffset;     ///< file offset of the tile stats
+        long long     histOffset;      ///< file offset of the histogram
+        Level         levels[ MaxLevels ];
+    };
+
+    /// destination of a container being written.
+    class Sink {
+    public:
+        virtual ~Sink ( ) { }
+        virtual bool write ( const void* const buff, const size_t n ) = 0;
+    };
+    /// source of a container being read (sequentially).
+    class Source {
+    public:
+        virtual ~Source ( ) { }
+        virtual bool read ( void* const buff, const size_t n ) = 0;
+    };
+
+    static bool isContainerName ( const char* const fname );
+
+    static bool write ( Sink& out, const int* const data, const int w,
+                        const int h, const int samplesPerPixel,
+                        const int min, const int max, const ImageStats::Snapshot* stats,
+                        const bool pyramid, ImageSaver::Progress* progress );
+
+    static const Header* validate ( const unsigned char* const file,
+                                    const size_t fileSize );
+    static int* read ( Source& in, Header* header, ImageStats::Snapshot* stats );
+
+    static void getStats ( const Header& header,
+                           const unsigned char* const file, ImageStats::Snapshot* stats );
+
+protected:
+    static bool checkHeader ( const Header& h, const long long fileSize );
+    static bool pad ( Sink& out, long long* pos, const long long to );
+};
+
+#endif
+//----------------------------------------------------------------------
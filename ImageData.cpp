@@ -27,9 +27,22 @@
  */
 #include  "stdafx.h"
 #include  <assert.h>
+#include  <float.h>
+#include  <limits.h>
+#include  <sys/types.h>
+#include  <sys/stat.h>
 #include  "ImageViewer.h"
 #include  "ImageData.h"
+#include  "BufferPool.h"
+#include  "Convolution.h"
+#include  "DistanceTransform.h"
+#include  "Histogram.h"
+#include  "ImageSaver.h"
+#include  "MappedFile.h"
+#include  "Morphology.h"
 #include  "pnmHelper.h"
+#include  "RankFilter.h"
+#include  "TIFFWriter.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -43,8 +56,10 @@ IMPLEMENT_DYNCREATE(ImageData, CDocument)
 
 BEGIN_MESSAGE_MAP(ImageData, CDocument)
 	//{{AFX_MSG_MAP(ImageData)
-		// NOTE - the ClassWizard will add and remove mapping macros here.
-		//    DO NOT EDIT what you see in these blocks of generated code!
+	ON_COMMAND(ID_EDIT_UNDO, OnEditUndo)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_UNDO, OnUpdateEditUndo)
+	ON_COMMAND(ID_EDIT_REDO, OnEditRedo)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_REDO, OnUpdateEditRedo)
 	//}}AFX_MSG_MAP
 END_MESSAGE_MAP()
 /////////////////////////////////////////////////////////////////////////////
@@ -52,10 +67,28 @@ END_MESSAGE_MAP()
  *
  *  Init image specific members to indicate no image yet.
  */
-ImageData::ImageData ( ) {
+ImageData::ImageData ( ) : mJournal( TileSize ), mStats( TileSize ),
+                            mPageFile( "page" )
+{
     mW = mH = mMin = mMax = 0;
 	mIsColor = false;
+    mImageModified = false;
     mOriginalData = 0;  //no image yet
+    mSaveState = SaveIdle;
+    mSaveError[0] = 0;
+    mSaveFinished.set();  //no save running
+    mMapping = 0;
+    mContainer = 0;
+    mLevelsStale = false;
+    mTouchedY0 = mTouchedY1 = 0;
+    mResidency = Resident;
+    mPageOffset = 0;
+    mSourceExact = false;
+    mSourceSize = mSourceTime = 0;
+    mSaveExact = false;
+    //undo history beyond this (in MB) is spilled to a temp file
+    const int  undoMB = AfxGetApp()->GetProfileInt( "Settings", "UndoMemoryMB", 64 );
+    mJournal.setMemoryBudget( (size_t)undoMB * 1024 * 1024 );
 }
 //---------------------------------------------------------------------------
 /** \brief ImageData dtor.
@@ -64,10 +97,13 @@ ImageData::ImageData ( ) {
  *  have an image.
  */
 ImageData::~ImageData ( ) {
-    if (mOriginalData!=0)    free( mOriginalData );
+    waitForSave();
+    MemoryBudget::instance().remove( this );
+    mJournal.clear();
+    mStats.attach( 0, 0, 0, 1 );
+    releaseData();
     mW = mH = mMin = mMax = 0;
 	mIsColor = false;
-    mOriginalData = 0;  //no image yet
 }
 //---------------------------------------------------------------------------
 /** \brief Method to create a new document (blank image).
@@ -77,21 +113,72 @@ BOOL ImageData::OnNewDocument ( ) {
 
 	//reinitialization code
 	// (SDI documents will reuse this document)
-    if (mOriginalData!=0)    free( mOriginalData );
+    mJournal.clear();
+    mStats.attach( 0, 0, 0, 1 );
+    releaseData();
     mW = mH = mMin = mMax = 0;
 	mIsColor = false;
-    mOriginalData = 0;  //no image yet
+    accountData();
 
 	return TRUE;
 }
 /////////////////////////////////////////////////////////////////////////////
 // ImageData serialization
 
+/** \brief Writes a native container to an archive. */
+class ArchiveSink : public ImageContainer::Sink {
+public:
+    CArchive&  mAr;
+    ArchiveSink ( CArchive& ar ) : mAr( ar ) { }
+    virtual bool write ( const void* const buff, const size_t n ) {
+        mAr.Write( buff, (UINT)n );  //throws on failure
+        return true;
+    }
+};
+//---------------------------------------------------------------------------
+/** \brief Reads a native container from an archive. */
+class ArchiveSource : public ImageContainer::Source {
+public:
+    CArchive&  mAr;
+    ArchiveSource ( CArchive& ar ) : mAr( ar ) { }
+    virtual bool read ( void* const buff, const size_t n ) {
+        //in pieces since Read takes a UINT
+        const size_t  piece = 1 << 30;
+        for (size_t done=0; done<n; done+=piece) {
+            const UINT  want = (UINT)(n-done < piece ? n-done : piece);
+            if (mAr.Read( (char*)buff+done, want )!=want)    return false;
+        }
+        return true;
+    }
+};
+//---------------------------------------------------------------------------
+/** \brief Store (or load) the image as a native container (.ivc).
+ *
+ *  Native files are normally opened by mapping them (see OnOpenDocument);
+ *  loading through the archive is the fallback when that isn't possible.
+ *  Other file types are read in OnOpenDocument so nothing is loaded here.
+ */
 void ImageData::Serialize ( CArchive& ar ) {
 	if (ar.IsStoring()) {
-		// TODO: add storing code here
+        if (!makeResident())    return;
+        ImageStats::Snapshot  stats;
+        mStats.getSnapshot( &stats );
+        ArchiveSink  out( ar );
+        ImageContainer::write( out, mOriginalData, mW, mH, mIsColor ? 3 : 1,
+                               mMin, mMax, &stats, true, NULL );
     } else {
-		// TODO: add loading code here
+        CFile*  f = ar.GetFile();
+        if (f==NULL || !ImageContainer::isContainerName( f->GetFilePath() ))
+            return;
+        ImageContainer::Header  h;
+        ImageStats::Snapshot    stats;
+        ArchiveSource  in( ar );
+        int*  data = ImageContainer::read( in, &h, &stats );
+        if (data==0)
+            AfxThrowArchiveException( CArchiveException::badIndex );
+        releaseData();
+        adopt( data, h, stats );
+        mSourceExact = false;  //can't necessarily be mapped to restore it
 	}
 }
 /////////////////////////////////////////////////////////////////////////////
@@ -110,11 +197,17 @@ void ImageData::Dump ( CDumpContext& dc ) const {
 // ImageData commands
 /** \brief Method to open a document (read in an image).
  *
- *  Currently, only .pgm, .ppm, or .pnm formats are supported so the file name
- *  must end in one of these extensions.
+ *  Currently, only .pbm, .pgm, .ppm, .pnm, or (native) .ivc formats are supported
+ *  so the file name must end in one of these extensions.
  *  \return True if successfully read; false otherwise.
  */
 BOOL ImageData::OnOpenDocument ( LPCTSTR lpszPathName )  {
+    if (ImageContainer::isContainerName( lpszPathName )) {
+        //native files are used in place (no decoding)
+        if (openMapped( lpszPathName ))    return true;
+        //can't be mapped?  then read it (via Serialize).
+        return CDocument::OnOpenDocument( lpszPathName ) && mOriginalData!=0;
+    }
 	if (!CDocument::OnOpenDocument(lpszPathName))    return false;
 	
     //convert from dos path to "standard"
@@ -130,9 +223,9 @@ BOOL ImageData::OnOpenDocument ( LPCTSTR lpszPathName )  {
     int  where = strlen(buff)-4;
     if (where<0)    return false;
     if ( strcmp(&buff[where], ".pgm")==0 || strcmp(&buff[where], ".pnm")==0
-      || strcmp(&buff[where], ".ppm")==0
+      || strcmp(&buff[where], ".ppm")==0 || strcmp(&buff[where], ".pbm")==0
       || strcmp(&buff[where], ".PGM")==0 || strcmp(&buff[where], ".PNM")==0
-      || strcmp(&buff[where], ".PPM")==0 ) {
+      || strcmp(&buff[where], ".PPM")==0 || strcmp(&buff[where], ".PBM")==0 ) {
         //load it!
 	    int  imageSamplesPerPixel = 0;
         mOriginalData = pnmHelper::read_pnm_file( buff, &mW, &mH,
@@ -142,18 +235,142 @@ BOOL ImageData::OnOpenDocument ( LPCTSTR lpszPathName )  {
 		assert( imageSamplesPerPixel==1 || imageSamplesPerPixel==3 );
 		if (imageSamplesPerPixel==3)    mIsColor = true;
 		else                            mIsColor = false;
+        mImageModified = false;
+        mJournal.attach( mOriginalData, mW, mH, imageSamplesPerPixel );
+        mStats.attach( mOriginalData, mW, mH, imageSamplesPerPixel,
+                       mMin, mMax );
+        recordSource( buff );
+        mSourceExact = true;
+        packBinary();
+        accountData();
         return true;  //indicate that we opened a file
     }
 
     return false;  //indicate that we can't open this type of file
 }
 //---------------------------------------------------------------------------
+/** \brief Background save of a snapshot of the image.  Runs on a thread
+ *  of its own and reports progress to the main frame.
+ */
+class ImageData::SaveJob : public ThreadPool::Task, public ImageSaver::Progress {
+public:
+    ImageData*  mDoc;        ///< document being saved (waits for us)
+    int*        mSnapshot;   ///< copy of the pixels (owned)
+    int         mW, mH, mSpp, mMin, mMax;
+    char        mPath[1024]; ///< output file name
+    HWND        mNotify;     ///< window that receives progress messages
+    int         mLastPercent;
+    bool        mHaveStats;  ///< mStats is to be saved (native files)
+    ImageStats::Snapshot  mStats;
+
+    virtual void run ( void ) {
+        const bool  ok = ImageSaver::save( mSnapshot, mW, mH, mSpp, mMin,
+                             mMax, mPath, this, mDoc->mSaveError,
+                             sizeof mDoc->mSaveError,
+                             mHaveStats ? &mStats : NULL );
+        BufferPool::instance().release( mSnapshot );    mSnapshot = NULL;
+        mDoc->mSaveState = ok ? SaveSucceeded : SaveFailed;
+        mDoc->mSaveFinished.set();
+        //the doc may be gone by the time this is handled (see pollSave)
+        if (mNotify!=NULL)    ::PostMessage( mNotify, WM_SAVE_DONE, ok, 0 );
+    }
+
+    virtual void report ( const int percent ) {
+        if (percent==mLastPercent || mNotify==NULL)    return;
+        mLastPercent = percent;
+        ::PostMessage( mNotify, WM_SAVE_PROGRESS, percent, 0 );
+    }
+};
+//---------------------------------------------------------------------------
 /** \brief Method called in response to save document (image).
-	\todo  Not implemented.  Currently, the base class is called which probably
-    does nothing.
+ *
+ *  The format is determined by the file name extension (.pbm, .pgm, .ppm,
+ *  .pnm, .tif, .tiff, or .ivc).  A snapshot of the image is written by a background
+ *  thread (so the ui stays responsive and editing may continue) to a temp
+ *  file which then replaces the original.  If the save fails, the user is
+ *  told (see pollSave) and the document is marked as modified again.
+ *  \return True if the save was started; false otherwise.
+ */
+BOOL ImageData::OnSaveDocument ( LPCTSTR lpszPathName ) {
+    if (!makeResident())    return FALSE;
+    const ImageSaver::Format  format = ImageSaver::formatFromName( lpszPathName );
+    if (format==ImageSaver::FormatUnknown) {
+        AfxMessageBox( "Images may only be saved as .pbm, .pgm, .ppm, .pnm, .tif, .tiff, or .ivc files." );
+        return FALSE;
+    }
+    if (strlen(lpszPathName) >= sizeof(((SaveJob*)0)->mPath)) {
+        AfxMessageBox( "File name is too long." );
+        return FALSE;
+    }
+    waitForSave();  //one at a time
+    pollSave();
+    //stop using the mapped file (it may be the one being replaced)
+    if (!materialize()) {
+        AfxMessageBox( "Out of memory." );
+        return FALSE;
+    }
+
+    const int     spp = mIsColor ? 3 : 1;
+    const size_t  bytes = (size_t)mW * mH * spp * sizeof(int);
+    int*  snapshot = (int*)BufferPool::instance().allocate( bytes );
+    if (snapshot==NULL) {
+        AfxMessageBox( "Out of memory." );
+        return FALSE;
+    }
+    memcpy( snapshot, mOriginalData, bytes );
+
+    SaveJob*  job = new SaveJob();
+    job->mDoc = this;
+    job->mSnapshot = snapshot;
+    job->mW = mW;    job->mH = mH;    job->mSpp = spp;
+    job->mMin = mMin;    job->mMax = mMax;
+    strcpy( job->mPath, lpszPathName );
+    CWnd*  main = AfxGetMainWnd();
+    job->mNotify = (main!=NULL) ? main->GetSafeHwnd() : NULL;
+    job->mLastPercent = -1;
+    job->mHaveStats = (format==ImageSaver::FormatNative);
+    if (job->mHaveStats)    mStats.getSnapshot( &job->mStats );
+
+    //can the saved file be used to restore the image (see evict)?
+    mSaveExact = (format==ImageSaver::FormatNative)
+              || (format==ImageSaver::FormatPNM && mMin>=0 && mMax<=65535);
+    mSaveError[0] = 0;
+    mSaveState = SaveBusy;
+    mSaveFinished.reset();
+    //(on its own thread: a long save mustn't keep the workers from the
+    // views' tiles)
+    if (!ThreadPool::runOnThread( job ))    ThreadPool::instance().submit( job );
+
+    mImageModified = false;
+    SetModifiedFlag( FALSE );
+    return TRUE;
+}
+//---------------------------------------------------------------------------
+/** \brief Block until the background save (if any) finishes.
  */
-BOOL ImageData::OnSaveDocument ( LPCTSTR lpszPathName ) {	
-	return CDocument::OnSaveDocument(lpszPathName);
+void ImageData::waitForSave ( void ) {
+    mSaveFinished.wait();
+}
+//---------------------------------------------------------------------------
+/** \brief Called (on the ui thread) after a background save finishes.
+ *  Tells the user if it failed.
+ *  \returns true if a save had finished (and was reported).
+ */
+bool ImageData::pollSave ( void ) {
+    if (mSaveState!=SaveSucceeded && mSaveState!=SaveFailed)    return false;
+    const bool  failed = (mSaveState==SaveFailed);
+    mSaveState = SaveIdle;
+    if (failed) {
+        mImageModified = true;
+        SetModifiedFlag( TRUE );
+        CString  msg;
+        msg.Format( "Unable to save %s:\n%s", (LPCTSTR)GetTitle(), mSaveError );
+        AfxMessageBox( msg );
+    } else {
+        mSourceExact = mSaveExact;
+        if (mSourceExact)    recordSource( GetPathName() );
+    }
+    return true;
 }
 //---------------------------------------------------------------------------
 /** \brief Method called in response to close document (image).
@@ -163,7 +380,733 @@ BOOL ImageData::OnSaveDocument ( LPCTSTR lpszPathName ) {
     does nothing.
  */
 void ImageData::OnCloseDocument ( ) {
-	// TODO: Add your specialized code here and/or call the base class
+    waitForSave();
+    pollSave();
 	CDocument::OnCloseDocument();
 }
 /////////////////////////////////////////////////////////////////////////////
+// ImageData editing (undo/redo)
+/** \brief Begin an operation that modifies pixels.  Call touchRect for
+ *  each region before it is modified, then endEdit (or cancelEdit, if
+ *  touchRect fails).
+ *  \param name operation name (shown in the Undo/Redo menu items)
+ */
+void ImageData::beginEdit ( const char* const name ) {
+    makeResident();
+    assert( mOriginalData!=0 );
+    UpdateAllViews( NULL, HintStopRendering );
+    mJournal.beginEdit( name );
+    mTouchedY0 = mH;
+    mTouchedY1 = 0;
+}
+//---------------------------------------------------------------------------
+/** \brief Indicate that the given region is about to be modified (so that
+ *  the affected tiles are saved for undo).
+ *  \param x0 left column (inclusive)
+ *  \param y0 top row (inclusive)
+ *  \param x1 right column (exclusive)
+ *  \param y1 bottom row (exclusive)
+ *  \returns false if out of memory (the operation can't be undone, so it
+ *  should be abandoned with cancelEdit).
+ */
+bool ImageData::touchRect ( const int x0, const int y0, const int x1,
+                            const int y1 )
+{
+    mStats.invalidateRect( x0, y0, x1, y1 );
+    if (!mJournal.saveRect( x0, y0, x1, y1 ))    return false;
+    mLevelsStale = true;
+    mPyramid.clear();
+    mHistograms.clear();
+    //(these rows of mBits are repacked by endEdit)
+    if (y0<mTouchedY0)    mTouchedY0 = y0;
+    if (y1>mTouchedY1)    mTouchedY1 = y1;
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Abandon the current operation (e.g., when touchRect fails); any
+ *  pixels already modified are restored.
+ */
+void ImageData::cancelEdit ( void ) {
+    mJournal.cancelEdit();
+    UpdateAllViews( NULL );
+}
+//---------------------------------------------------------------------------
+/** \brief Finish the current operation and update the views.
+ */
+void ImageData::endEdit ( void ) {
+    mJournal.endEdit();
+    updateMinMax();
+    repackBinary( mTouchedY0, mTouchedY1 );
+    accountData();
+    mImageModified = true;
+    SetModifiedFlag();
+    UpdateAllViews( NULL );
+}
+//---------------------------------------------------------------------------
+/** \brief Replace a binary (or label) image by its exact Euclidean
+ *  distance transform: each nonzero pixel becomes its distance (rounded)
+ *  to the nearest 0 pixel.  May be undone.
+ *  \returns false if the image is color, has no 0 pixels, or there isn't
+ *  enough memory.
+ */
+bool ImageData::distanceTransform ( void ) {
+    if (!makeResident() || mIsColor)    return false;
+    const size_t  bytes = (size_t)mW * mH * sizeof(int);
+    int*  dist = (int*)BufferPool::instance().allocate( bytes );
+    if (dist==NULL)    return false;
+    //(no 0 pixels makes every distance infinite)
+    if (!DistanceTransform::distance( mOriginalData, mW, mH, dist )
+        || dist[0]==INT_MAX)
+    {
+        BufferPool::instance().release( dist );
+        return false;
+    }
+    beginEdit( "Distance Transform" );
+    if (!touchRect( 0, 0, mW, mH )) {
+        cancelEdit();
+        BufferPool::instance().release( dist );
+        return false;
+    }
+    memcpy( mOriginalData, dist, bytes );
+    BufferPool::instance().release( dist );
+    endEdit();
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Write the (unrounded) distance transform of a binary (or label)
+ *  image to a TIFF file (see TIFFWriter::write_tiff_float_grey) without
+ *  changing the image.
+ *  \param fname output file name
+ *  \returns false if the image is color, has no 0 pixels, there isn't
+ *  enough memory, or the file couldn't be written.
+ */
+bool ImageData::exportDistanceMap ( const char* const fname ) {
+    if (!makeResident() || mIsColor)    return false;
+    MemoryBudget::Pin  pin( this );
+    float*  dist = (float*)BufferPool::instance().allocate( (size_t)mW * mH * sizeof(float) );
+    if (dist==NULL)    return false;
+    const bool  ok = DistanceTransform::distance( mOriginalData, mW, mH, dist )
+                  && dist[0]!=FLT_MAX
+                  && TIFFWriter::write_tiff_float_grey( dist, mW, mH, fname );
+    BufferPool::instance().release( dist );
+    return ok;
+}
+//---------------------------------------------------------------------------
+/** \brief Erode, dilate, open, or close a gray image with a kw x kh
+ *  rectangle (binary images are processed packed).  May be undone.
+ *  \param op Morphology::Erode, Dilate, Open, or Close
+ *  \param kw rectangle width
+ *  \param kh rectangle height
+ *  \returns false if the image is color or there isn't enough memory.
+ */
+bool ImageData::morphology ( const int op, const int kw, const int kh ) {
+    static const char* const  names[] = { "Erosion", "Dilation", "Opening", "Closing" };
+    assert( op>=Morphology::Erode && op<=Morphology::Close );
+    if (!makeResident() || mIsColor)    return false;
+    const size_t  bytes = (size_t)mW * mH * sizeof(int);
+    int*  result = (int*)BufferPool::instance().allocate( bytes );
+    if (result==NULL)    return false;
+    if (!mBits.empty()) {
+        BitImage  bits;
+        if (!Morphology::rectangle( mBits, &bits, op, kw, kh )) {
+            BufferPool::instance().release( result );
+            return false;
+        }
+        bits.unpack( result );
+    } else {
+        Morphology::rectangle( mOriginalData, mW, mH, result, op, kw, kh );
+    }
+    beginEdit( names[op] );
+    if (!touchRect( 0, 0, mW, mH )) {
+        cancelEdit();
+        BufferPool::instance().release( result );
+        return false;
+    }
+    memcpy( mOriginalData, result, bytes );
+    BufferPool::instance().release( result );
+    endEdit();
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Smooth a gray or color image with a gaussian.  May be undone.
+ *  \param sigma standard deviation (in pixels)
+ *  \returns false if there isn't enough memory.
+ */
+bool ImageData::gaussianFilter ( const double sigma ) {
+    if (!makeResident())    return false;
+    const int     spp = mIsColor ? 3 : 1;
+    const size_t  bytes = (size_t)mW * mH * spp * sizeof(int);
+    int*  result = (int*)BufferPool::instance().allocate( bytes );
+    if (result==NULL)    return false;
+    if (!Convolution::gaussian( mOriginalData, mW, mH, spp, result, sigma )) {
+        BufferPool::instance().release( result );
+        return false;
+    }
+    beginEdit( "Gaussian" );
+    if (!touchRect( 0, 0, mW, mH )) {
+        cancelEdit();
+        BufferPool::instance().release( result );
+        return false;
+    }
+    memcpy( mOriginalData, result, bytes );
+    BufferPool::instance().release( result );
+    endEdit();
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Replace each pixel of a gray or color image by the mean of the
+ *  (2*radius+1) square centered on it.  May be undone.
+ *  \param radius half the size of the square
+ *  \returns false if there isn't enough memory.
+ */
+bool ImageData::boxFilter ( const int radius ) {
+    if (!makeResident())    return false;
+    const int     spp = mIsColor ? 3 : 1;
+    const size_t  bytes = (size_t)mW * mH * spp * sizeof(int);
+    int*  result = (int*)BufferPool::instance().allocate( bytes );
+    if (result==NULL)    return false;
+    Convolution::box( mOriginalData, mW, mH, spp, result, radius, radius );
+    beginEdit( "Mean" );
+    if (!touchRect( 0, 0, mW, mH )) {
+        cancelEdit();
+        BufferPool::instance().release( result );
+        return false;
+    }
+    memcpy( mOriginalData, result, bytes );
+    BufferPool::instance().release( result );
+    endEdit();
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Replace each pixel of a gray image by a percentile (e.g., the
+ *  median) of the (2*radius+1) square centered on it.  May be undone.
+ *  \param radius half the size of the square (at most
+ *  RankFilter::MaxRadius)
+ *  \param percentile 0 (min) .. 0.5 (median) .. 1 (max)
+ *  \returns false if the image is color, spans more than 16 bits of
+ *  values, or there isn't enough memory.
+ */
+bool ImageData::rankFilter ( const int radius, const double percentile ) {
+    if (!makeResident() || mIsColor)    return false;
+    const size_t  bytes = (size_t)mW * mH * sizeof(int);
+    int*  result = (int*)BufferPool::instance().allocate( bytes );
+    if (result==NULL)    return false;
+    if (!RankFilter::filter( mOriginalData, mW, mH, result, radius, percentile )) {
+        BufferPool::instance().release( result );
+        return false;
+    }
+    beginEdit( percentile==0.5 ? "Median" : "Rank Filter" );
+    if (!touchRect( 0, 0, mW, mH )) {
+        cancelEdit();
+        BufferPool::instance().release( result );
+        return false;
+    }
+    memcpy( mOriginalData, result, bytes );
+    BufferPool::instance().release( result );
+    endEdit();
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Replace a binary image by the labels of its connected
+ *  components (1, 2, ... in raster order; the background stays 0).  May be
+ *  undone.
+ *  \param eight 8 connectivity (otherwise, 4)
+ *  \param table if not NULL, receives the components (element l-1 is
+ *  label l)
+ *  \returns the number of components (or -1 if the image is color or
+ *  there isn't enough memory).
+ */
+int ImageData::labelComponents ( const bool eight,
+                                 std::vector<ConnectedComponents::Component>* table )
+{
+    if (!makeResident() || mIsColor)    return -1;
+    const size_t  bytes = (size_t)mW * mH * sizeof(int);
+    int*  labels = (int*)BufferPool::instance().allocate( bytes );
+    if (labels==NULL)    return -1;
+    const int  count = mBits.empty()
+        ? ConnectedComponents::label( mOriginalData, mW, mH, labels, eight, table )
+        : ConnectedComponents::label( mBits, labels, eight, table );
+    beginEdit( "Labeling" );
+    if (!touchRect( 0, 0, mW, mH )) {
+        cancelEdit();
+        BufferPool::instance().release( labels );
+        return -1;
+    }
+    memcpy( mOriginalData, labels, bytes );
+    BufferPool::instance().release( labels );
+    endEdit();
+    return count;
+}
+//---------------------------------------------------------------------------
+/** \brief Move an entry of a list to the back (most recently used),
+ *  swapping it past the others.
+ */
+template< class T >
+static void moveToBack ( std::vector<T>& v, size_t i ) {
+    for ( ; i+1<v.size(); i++)    v[i].swap( v[i+1] );
+}
+//---------------------------------------------------------------------------
+/** \brief Histogram of a rect of the image (all samples, for color),
+ *  with the bins ImageStats would use for the whole image.  The most
+ *  recently used histograms are cached (until the pixels change), so
+ *  asking again, even for an evicted image, costs nothing.
+ *  \param x0 left column (inclusive)
+ *  \param y0 top row (inclusive)
+ *  \param x1 right column (exclusive)
+ *  \param y1 bottom row (exclusive)
+ *  \param first receives the value of the first bin
+ *  \param shift receives log2 of the bin width
+ *  \returns the counts (valid until the next call or edit; empty if there
+ *  is no image).
+ */
+const std::vector<unsigned int>& ImageData::getHistogram ( int x0, int y0,
+                                                           int x1, int y1,
+                                                           int* first,
+                                                           int* shift )
+{
+    static const std::vector<unsigned int>  none;
+    if (x0<0)     x0 = 0;
+    if (y0<0)     y0 = 0;
+    if (x1>mW)    x1 = mW;
+    if (y1>mH)    y1 = mH;
+    for (size_t i=0; i<mHistograms.size(); i++) {
+        const CachedHistogram&  c = mHistograms[i];
+        if (c.x0==x0 && c.y0==y0 && c.x1==x1 && c.y1==y1) {
+            moveToBack( mHistograms, i );
+            const CachedHistogram&  b = mHistograms.back();
+            *first = b.first;
+            *shift = b.shift;
+            return b.hist;
+        }
+    }
+    if (!makeResident() || mOriginalData==0)    return none;
+    if (mHistograms.size() >= MaxHistograms)    //reuse the least recently used
+        moveToBack( mHistograms, 0 );
+    else
+        mHistograms.push_back( CachedHistogram() );
+    CachedHistogram&  c = mHistograms.back();
+    c.x0 = x0;    c.y0 = y0;    c.x1 = x1;    c.y1 = y1;
+    c.first = mMin;
+    const int  bins = Histogram::binning( mMin, mMax, &c.shift );
+    Histogram::count( mOriginalData, mW, mH, mIsColor ? 3 : 1, x0, y0, x1,
+                      y1, c.first, c.shift, bins, &c.hist );
+    *first = c.first;
+    *shift = c.shift;
+    return c.hist;
+}
+//---------------------------------------------------------------------------
+/** \brief Update the overall min and max pixel values (from the stats,
+ *  so only modified tiles are rescanned).
+ */
+void ImageData::updateMinMax ( void ) {
+    mMin = mStats.getMin();
+    mMax = mStats.getMax();
+}
+//---------------------------------------------------------------------------
+/** \brief Keep a copy of a binary (0/1 or 0/255) gray image packed 1 bit
+ *  per pixel: level 0 is displayed from it, and it is kept (instead of
+ *  spilling or rereading the pixels) when the image is evicted.
+ */
+void ImageData::packBinary ( void ) {
+    mBits.release();
+    if ( mIsColor || mOriginalData==0
+      || !BitImage::isBinaryRange( mMin, mMax ) )
+        return;
+    mBits.pack( mOriginalData, mW, mH, mMax );
+}
+//---------------------------------------------------------------------------
+/** \brief Update the packed copy after rows [y0,y1) were modified.  Only
+ *  those rows are packed again if the rest are still valid (the image
+ *  was, and still may be, binary with the same set value); otherwise,
+ *  the whole image is (see packBinary).
+ */
+void ImageData::repackBinary ( int y0, int y1 ) {
+    if (y0<0)     y0 = 0;
+    if (y1>mH)    y1 = mH;
+    if ( mIsColor || mOriginalData==0
+      || !BitImage::isBinaryRange( mMin, mMax ) )
+    {
+        mBits.release();
+        return;
+    }
+    if ( mBits.empty() || mBits.getW()!=mW || mBits.getH()!=mH
+      || mBits.getOne()!=mMax )
+    {
+        packBinary();
+        return;
+    }
+    if (y0<y1)    mBits.packRows( mOriginalData, y0, y1 );
+}
+//---------------------------------------------------------------------------
+/** \brief Update the packed copy after the given journal tiles changed
+ *  (e.g., by undo or redo).
+ */
+void ImageData::repackBinary ( const std::vector<int>& tiles ) {
+    const int  size = mJournal.getTileSize();
+    const int  across = mJournal.getTilesAcross();
+    int  y0 = mH, y1 = 0;
+    for (size_t i=0; i<tiles.size(); i++) {
+        const int  ty = tiles[i] / across;
+        if (ty*size < y0)        y0 = ty*size;
+        if ((ty+1)*size > y1)    y1 = (ty+1)*size;
+    }
+    repackBinary( y0, y1 );
+}
+//---------------------------------------------------------------------------
+/** \brief The image rects of the given journal tiles (e.g., to tell the
+ *  views which parts of the image undo or redo changed).
+ */
+void ImageData::tileRects ( const std::vector<int>& tiles,
+                            ChangedRects* changed ) const
+{
+    const int  size = mJournal.getTileSize();
+    const int  across = mJournal.getTilesAcross();
+    changed->mRects.clear();
+    for (size_t i=0; i<tiles.size(); i++) {
+        const int  x0 = (tiles[i] % across) * size;
+        const int  y0 = (tiles[i] / across) * size;
+        changed->mRects.push_back( CRect( x0, y0, std::min( x0+size, mW ),
+                                          std::min( y0+size, mH ) ) );
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Undo the most recent operation.
+ */
+void ImageData::OnEditUndo ( ) {
+    if (!mJournal.canUndo() || !makeResident())    return;
+    std::vector<int>  tiles;
+    mJournal.getUndoTiles( tiles );
+    mStats.invalidateTiles( tiles );
+    UpdateAllViews( NULL, HintStopRendering );
+    ChangedRects  changed;
+    if (!mJournal.undo()) {
+        //(nothing changed; the views just start rendering again)
+        UpdateAllViews( NULL, HintPixelsChanged, &changed );
+        AfxMessageBox( "Undo failed (out of memory, or the undo file couldn't be read).  The image is unchanged." );
+        return;
+    }
+    mLevelsStale = true;
+    mPyramid.clear();
+    mHistograms.clear();
+    updateMinMax();
+    repackBinary( tiles );
+    accountData();
+    mImageModified = true;
+    SetModifiedFlag();
+    //(the views only reconvert what's shown of the changed tiles)
+    tileRects( tiles, &changed );
+    UpdateAllViews( NULL, HintPixelsChanged, &changed );
+}
+//---------------------------------------------------------------------------
+void ImageData::OnUpdateEditUndo ( CCmdUI* pCmdUI ) {
+    char  buff[100];
+    sprintf( buff, "&Undo %s\tCtrl+Z", mJournal.getUndoName() );
+    pCmdUI->SetText( buff );
+    pCmdUI->Enable( mJournal.canUndo() );
+}
+//---------------------------------------------------------------------------
+/** \brief Redo the most recently undone operation.
+ */
+void ImageData::OnEditRedo ( ) {
+    if (!mJournal.canRedo() || !makeResident())    return;
+    std::vector<int>  tiles;
+    mJournal.getRedoTiles( tiles );
+    mStats.invalidateTiles( tiles );
+    UpdateAllViews( NULL, HintStopRendering );
+    ChangedRects  changed;
+    if (!mJournal.redo()) {
+        //(nothing changed; the views just start rendering again)
+        UpdateAllViews( NULL, HintPixelsChanged, &changed );
+        AfxMessageBox( "Redo failed (out of memory, or the undo file couldn't be read).  The image is unchanged." );
+        return;
+    }
+    mLevelsStale = true;
+    mPyramid.clear();
+    mHistograms.clear();
+    updateMinMax();
+    repackBinary( tiles );
+    accountData();
+    mImageModified = true;
+    SetModifiedFlag();
+    //(the views only reconvert what's shown of the changed tiles)
+    tileRects( tiles, &changed );
+    UpdateAllViews( NULL, HintPixelsChanged, &changed );
+}
+//---------------------------------------------------------------------------
+void ImageData::OnUpdateEditRedo ( CCmdUI* pCmdUI ) {
+    char  buff[100];
+    sprintf( buff, "&Redo %s\tCtrl+Y", mJournal.getRedoName() );
+    pCmdUI->SetText( buff );
+    pCmdUI->Enable( mJournal.canRedo() );
+}
+/////////////////////////////////////////////////////////////////////////////
+// ImageData native files (.ivc)
+/** \brief Free (or unmap) the pixels.
+ */
+void ImageData::dropPixels ( void ) {
+    if (mMapping!=0) {
+        delete mMapping;
+        mMapping = 0;
+    } else if (mOriginalData!=0) {
+        BufferPool::instance().release( mOriginalData );
+    }
+    mOriginalData = 0;
+    mContainer = 0;
+    mPyramid.clear();
+}
+//---------------------------------------------------------------------------
+/** \brief Discard the image data (including any evicted copy).
+ */
+void ImageData::releaseData ( void ) {
+    dropPixels();
+    mBits.release();
+    mHistograms.clear();
+    mLevelsStale = false;
+    mResidency = Resident;
+    mPageFile.close();
+}
+//---------------------------------------------------------------------------
+/** \brief Make a private copy of mapped image data (and close the file).
+ *  \returns false if out of memory.
+ */
+bool ImageData::materialize ( void ) {
+    if (mMapping==0)    return true;
+    const size_t  bytes = (size_t)mW * mH * (mIsColor ? 3 : 1) * sizeof(int);
+    int*  copy = (int*)BufferPool::instance().allocate( bytes );
+    if (copy==0)    return false;
+    memcpy( copy, mOriginalData, bytes );
+    mJournal.rebind( copy );
+    mStats.rebind( copy );
+    //views stop reading (and redisplay from) the mapped samples
+    mOriginalData = copy;
+    UpdateAllViews( NULL );
+    delete mMapping;
+    mMapping = 0;
+    mContainer = 0;
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Map a native file and use its samples (and cached statistics) in
+ *  place.  Pages are only read as they are touched.
+ *  \returns false if the file can't be mapped or isn't a valid container.
+ */
+bool ImageData::openMapped ( LPCTSTR lpszPathName ) {
+    MappedFile*  m = new MappedFile();
+    const ImageContainer::Header*  h = 0;
+    if (m->open( lpszPathName ))
+        h = ImageContainer::validate( m->data(), m->size() );
+    if (h==0) {
+        delete m;
+        return false;
+    }
+    DeleteContents();
+    releaseData();
+    recordSource( lpszPathName );
+    ImageStats::Snapshot  stats;
+    ImageContainer::getStats( *h, m->data(), &stats );
+    mMapping = m;
+    mContainer = h;
+    adopt( (int*)(m->data() + h->levels[0].offset), *h, stats );
+    SetModifiedFlag( FALSE );
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Use the given samples (described by a container header) as the
+ *  image.
+ */
+void ImageData::adopt ( int* data, const ImageContainer::Header& h,
+                        const ImageStats::Snapshot& stats )
+{
+    const int  spp = h.samplesPerPixel;
+    mOriginalData = data;
+    mW = h.width;
+    mH = h.height;
+    mMin = h.min;
+    mMax = h.max;
+    mIsColor = (spp==3);
+    mImageModified = false;
+    mLevelsStale = false;
+    mJournal.attach( mOriginalData, mW, mH, spp );
+    mStats.attach( mOriginalData, mW, mH, spp, mMin, mMax );
+    if (!stats.tiles.empty())    mStats.restore( stats );
+    mSourceExact = true;
+    packBinary();
+    accountData();
+}
+//---------------------------------------------------------------------------
+/** \brief Number of resolution levels (including the full resolution one)
+ *  stored in the native file the image was opened from.  0 if there are
+ *  none (or the image has been modified since).
+ */
+int ImageData::getStoredLevelCount ( void ) const {
+    if (mContainer==0 || mLevelsStale)    return 0;
+    return mContainer->levelCount;
+}
+//---------------------------------------------------------------------------
+/** \brief A stored reduced resolution copy of the image (level 1 is half
+ *  size, level 2 is a quarter size, etc.), ready to use.
+ *  \returns the samples (or NULL if not available).
+ */
+const int* ImageData::getStoredLevel ( const int level, int* w, int* h ) const {
+    if (level<0 || level>=getStoredLevelCount())    return 0;
+    const ImageContainer::Level&  lv = mContainer->levels[level];
+    *w = lv.width;
+    *h = lv.height;
+    return (const int*)(mMapping->data() + lv.offset);
+}
+//---------------------------------------------------------------------------
+/** \brief A reduced resolution copy of the image (level 0 is the image
+ *  itself, level 1 is half size, etc.) for display.  Stored levels are
+ *  used as is; others are built (from the smallest stored one) when first
+ *  asked for and kept until the image changes or is evicted.  The pixels
+ *  must be resident.
+ *  \returns the samples (or NULL if out of memory or no such level).
+ */
+const int* ImageData::getLevel ( const int level, int* w, int* h ) {
+    assert( mOriginalData!=0 && level>=0 );
+    if (level==0) {
+        *w = mW;
+        *h = mH;
+        return mOriginalData;
+    }
+    const int*  p = getStoredLevel( level, w, h );
+    if (p!=0)    return p;
+    //build it from the highest stored level (or the image itself)
+    int  base = getStoredLevelCount() - 1;
+    int  bw = mW, bh = mH;
+    const int*  b = mOriginalData;
+    if (base>0)    b = getStoredLevel( base, &bw, &bh );
+    else           base = 0;
+    p = mPyramid.get( level, b, base, bw, bh, mIsColor ? 3 : 1, mMin, mMax, w, h );
+    accountData();
+    return p;
+}
+/////////////////////////////////////////////////////////////////////////////
+// ImageData memory budget
+/** \brief Size of the pixel data (in bytes).
+ */
+size_t ImageData::pixelBytes ( void ) const {
+    return (size_t)mW * mH * (mIsColor ? 3 : 1) * sizeof(int);
+}
+//---------------------------------------------------------------------------
+/** \brief Report the memory we hold to the MemoryBudget (which may evict
+ *  other, less recently used documents).
+ */
+void ImageData::accountData ( void ) {
+    MemoryBudget::instance().setSize( this,
+        ((mOriginalData!=0) ? pixelBytes() : 0) + mPyramid.getBytes()
+        + mBits.getBytes() );
+}
+//---------------------------------------------------------------------------
+/** \brief Remember the size and time of the file the pixels came from (or
+ *  were saved to) so that we can tell if it changes.
+ */
+void ImageData::recordSource ( const char* const fname ) {
+    struct stat  st;
+    if (fname!=0 && stat( fname, &st )==0) {
+        mSourceSize = st.st_size;
+        mSourceTime = st.st_mtime;
+    } else {
+        mSourceSize = mSourceTime = -1;
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Is the file the pixels came from still the same?
+ */
+bool ImageData::sourceUnchanged ( void ) const {
+    struct stat  st;
+    if (!mSourceExact || mSourceSize<0)    return false;
+    if (stat( GetPathName(), &st )!=0)    return false;
+    return st.st_size==mSourceSize && st.st_mtime==mSourceTime;
+}
+//---------------------------------------------------------------------------
+/** \brief Release the pixels (called by the MemoryBudget when memory is
+ *  needed for something more recently used).
+ *
+ *  Binary images keep only their packed copy (1 bit per pixel).  Other
+ *  unmodified pixels are simply dropped and later read back from their
+ *  file.  Modified ones are written to a scratch file first.  Nothing is
+ *  evicted during an edit or while a save is pending.
+ *  \returns the number of bytes still held.
+ */
+size_t ImageData::evict ( void ) {
+    if (mResidency!=Resident || mOriginalData==0)    return mBits.getBytes();
+    const size_t  bytes = pixelBytes();
+    const size_t  held  = bytes + mPyramid.getBytes() + mBits.getBytes();
+    if (mSaveState!=SaveIdle || mJournal.inEdit())    return held;
+    //(a mapped native file is mapped again instead, to get its levels back)
+    if (!mBits.empty() && mMapping==0) {
+        dropPixels();
+        mResidency = EvictedPacked;
+        return mBits.getBytes();
+    }
+    if (!IsModified() && sourceUnchanged()) {
+        dropPixels();
+        //(a native file is mapped again, so its levels are too)
+        mResidency = EvictedClean;
+        return mBits.getBytes();
+    }
+    long long  offset = 0;
+    mPageFile.close();
+    if (!mPageFile.append( mOriginalData, bytes, &offset ))    return held;
+    dropPixels();
+    mPageOffset = offset;
+    mResidency = EvictedDirty;
+    return mBits.getBytes();
+}
+//---------------------------------------------------------------------------
+/** \brief Bring evicted pixels back into memory (if necessary).
+ *  \returns true if the pixels are available.
+ */
+bool ImageData::makeResident ( void ) {
+    if (mResidency==Resident)    return mOriginalData!=0;
+    const size_t  bytes = pixelBytes();
+    int*  data = 0;
+    if (mResidency==EvictedPacked) {
+        data = (int*)BufferPool::instance().allocate( bytes );
+        if (data!=0)    mBits.unpack( data );
+    } else if (mResidency==EvictedDirty) {
+        data = (int*)BufferPool::instance().allocate( bytes );
+        if (data!=0 && !mPageFile.read( mPageOffset, data, bytes )) {
+            BufferPool::instance().release( data );
+            data = 0;
+        }
+        if (data!=0)    mPageFile.close();
+    } else if (sourceUnchanged()) {
+        const char*  fname = GetPathName();
+        if (ImageContainer::isContainerName( fname )) {
+            MappedFile*  m = new MappedFile();
+            const ImageContainer::Header*  h = 0;
+            if (m->open( fname ))    h = ImageContainer::validate( m->data(), m->size() );
+            if ( h!=0 && (int)h->width==mW && (int)h->height==mH
+              && (int)h->samplesPerPixel==(mIsColor ? 3 : 1) )
+            {
+                mMapping = m;
+                mContainer = h;
+                data = (int*)(m->data() + h->levels[0].offset);
+            } else {
+                delete m;
+            }
+        } else {
+            int  w, h, spp, mn, mx;
+            data = pnmHelper::read_pnm_file( fname, &w, &h, &spp, &mn, &mx );
+            if ( data!=0 && (w!=mW || h!=mH || spp!=(mIsColor ? 3 : 1)) ) {
+                BufferPool::instance().release( data );
+                data = 0;
+            }
+        }
+    }
+    if (data==0) {
+        CString  msg;
+        msg.Format( "Unable to restore %s.", (LPCTSTR)GetTitle() );
+        AfxMessageBox( msg );
+        return false;
+    }
+    mOriginalData = data;
+    mResidency = Resident;
+    mJournal.rebind( mOriginalData );
+    mStats.rebind( mOriginalData );
+    accountData();
+    return true;
+}
+/////////////////////////////////////////////////////////////////////////////
@@ -32,14 +32,41 @@
 #pragma once
 #endif // _MSC_VER > 1000
 
+#include  <algorithm>
+#include  "BitImage.h"
+#include  "ConnectedComponents.h"
+#include  "ImageContainer.h"
+#include  "ImagePyramid.h"
+#include  "ImageStats.h"
+#include  "MemoryBudget.h"
+#include  "ThreadPool.h"
+#include  "UndoJournal.h"
+
+class MappedFile;
+
+/// posted to the main frame as a background save progresses (wParam=percent).
+#define  WM_SAVE_PROGRESS  (WM_APP + 1)
+/// posted to the main frame when a background save finishes.
+#define  WM_SAVE_DONE      (WM_APP + 2)
+
 /** \brief ImageData class.  Modified for ImageViewer.
  */
-class ImageData : public CDocument {
+class ImageData : public CDocument, public MemoryBudget::Client {
 protected: // create from serialization only
     ImageData ( );
     DECLARE_DYNCREATE( ImageData )
 
 // Attributes
+public:
+    enum { TileSize = 256 };  ///< tile width and height (for undo and stats)
+    /// UpdateAllViews hints: stop reading the pixels (they're about to
+    /// change); only the pixels in the given rects (a ChangedRects) changed.
+    enum { HintStopRendering = 1, HintPixelsChanged = 2 };
+    /// (with HintPixelsChanged) the parts of the image that changed.
+    class ChangedRects : public CObject {
+    public:
+        std::vector<CRect>  mRects;  ///< image coordinates (may be empty)
+    };
 protected:
     bool  mIsColor;        ///< true if color (rgb); false if gray
     bool  mImageModified;  ///< true if image has been modified
@@ -52,6 +79,55 @@ protected:
      *  Otherwise, rgb triples are stored as 3 consecutive values.
      */
     int*  mOriginalData;
+    UndoJournal  mJournal;  ///< tile granular undo/redo history
+    ImageStats   mStats;    ///< lazily computed statistics (per tile)
+
+    /// state of the background save (if any).
+    enum { SaveIdle, SaveBusy, SaveSucceeded, SaveFailed };
+    class SaveJob;
+    friend class SaveJob;
+    volatile long  mSaveState;      ///< one of the above
+    Event          mSaveFinished;   ///< set when no save is running
+    char           mSaveError[256]; ///< why the last save failed
+
+    /** \brief The native (.ivc) file that mOriginalData points into (or
+     *  NULL if mOriginalData was allocated).  Mapped copy on write, so
+     *  edits never reach the file.
+     */
+    MappedFile*    mMapping;
+    const ImageContainer::Header*  mContainer;  ///< header in mMapping
+    bool           mLevelsStale;    ///< edited since the levels were saved
+    ImagePyramid   mPyramid;        ///< levels built for display (not stored)
+    BitImage       mBits;           ///< packed copy of a binary image (else empty)
+    int            mTouchedY0, mTouchedY1;  ///< rows touched by the current edit
+
+    /// a histogram of a rect (see getHistogram).
+    struct CachedHistogram {
+        int  x0, y0, x1, y1;    ///< the rect
+        int  first, shift;      ///< the bins
+        std::vector<unsigned int>  hist;
+        /// exchange with another (the counts are swapped, not copied).
+        void swap ( CachedHistogram& o ) {
+            std::swap( x0, o.x0 );    std::swap( y0, o.y0 );
+            std::swap( x1, o.x1 );    std::swap( y1, o.y1 );
+            std::swap( first, o.first );
+            std::swap( shift, o.shift );
+            hist.swap( o.hist );
+        }
+    };
+    enum { MaxHistograms = 8 };  ///< histograms cached
+    std::vector<CachedHistogram>  mHistograms;  ///< least recently used first
+
+    /// where the pixels are (see evict and makeResident).
+    enum { Resident, EvictedClean, EvictedDirty, EvictedPacked };
+    int            mResidency;      ///< one of the above
+    TempFile       mPageFile;       ///< holds evicted modified pixels
+    long long      mPageOffset;     ///< where in mPageFile
+    /// the pixels are exactly those in the file at GetPathName().
+    bool           mSourceExact;
+    long long      mSourceSize;     ///< size of that file when read/written
+    long long      mSourceTime;     ///< modification time of that file
+    bool           mSaveExact;      ///< the save in progress is exact
 
 // Operations
 public:
@@ -62,6 +138,14 @@ public:
     inline int  getMin ( void ) const { return mMin; }
     inline int  getMax ( void ) const { return mMax; }
     inline int  getData ( const int i ) const { return mOriginalData[i]; }
+    /// \returns all of the samples (for bulk processing).
+    inline const int* getPixels ( void ) const { return mOriginalData; }
+    /// \returns true if the image is binary (0 and 1, or 0 and 255).
+    inline bool isBinary ( void ) const { return !mBits.empty(); }
+    /// \returns the image packed 1 bit per pixel (or NULL if not binary).
+    inline const BitImage* getBits ( void ) const {
+        return mBits.empty() ? 0 : &mBits;
+    }
     //--------------------------------------------------------------------
     /** \brief Given a pixel's row and column location, this function
      *  returns the gray pixel value at that location.
@@ -111,7 +195,44 @@ public:
         return mOriginalData[ offset+2 ];
     }
     //--------------------------------------------------------------------
-    bool dataAvailable ( void ) const { return mOriginalData!=0; }
+    bool dataAvailable ( void ) const {
+        return mOriginalData!=0 || mResidency!=Resident;
+    }
+    bool isResident ( void ) const { return mResidency==Resident; }
+    bool makeResident ( void );
+    virtual size_t evict ( void );
+    bool isMapped ( void ) const { return mMapping!=0; }
+    int  getStoredLevelCount ( void ) const;
+    const int* getStoredLevel ( const int level, int* w, int* h ) const;
+    const int* getLevel ( const int level, int* w, int* h );
+    /** \brief Statistics (histogram, mean, percentiles, etc.) of the
+     *  image.  Computed on first use; after an edit, only the modified
+     *  tiles are rescanned.
+     */
+    inline ImageStats& getStats ( void ) {
+        makeResident();
+        return mStats;
+    }
+    const std::vector<unsigned int>& getHistogram ( int x0, int y0, int x1,
+                                                    int y1, int* first,
+                                                    int* shift );
+    //--------------------------------------------------------------------
+    void beginEdit ( const char* const name );
+    bool touchRect ( const int x0, const int y0, const int x1, const int y1 );
+    void endEdit ( void );
+    void cancelEdit ( void );
+    bool distanceTransform ( void );
+    bool exportDistanceMap ( const char* const fname );
+    bool morphology ( const int op, const int kw, const int kh );
+    bool gaussianFilter ( const double sigma );
+    bool boxFilter ( const int radius );
+    bool rankFilter ( const int radius, const double percentile );
+    int  labelComponents ( const bool eight,
+                           std::vector<ConnectedComponents::Component>* table=NULL );
+    //--------------------------------------------------------------------
+    bool isSaving ( void ) const { return mSaveState==SaveBusy; }
+    void waitForSave ( void );
+    bool pollSave ( void );
 
 // Overrides
     // ClassWizard generated virtual function overrides
@@ -133,12 +254,29 @@ public:
 #endif
 
 protected:
+    void updateMinMax ( void );
+    void packBinary ( void );
+    void repackBinary ( int y0, int y1 );
+    void repackBinary ( const std::vector<int>& tiles );
+    void tileRects ( const std::vector<int>& tiles, ChangedRects* changed ) const;
+    void releaseData ( void );
+    void dropPixels ( void );
+    bool materialize ( void );
+    bool openMapped ( LPCTSTR lpszPathName );
+    void adopt ( int* data, const ImageContainer::Header& h,
+                 const ImageStats::Snapshot& stats );
+    size_t pixelBytes ( void ) const;
+    void accountData ( void );
+    void recordSource ( const char* const fname );
+    bool sourceUnchanged ( void ) const;
 
 // Generated message map functions
 protected:
     //{{AFX_MSG(ImageData)
-        // NOTE - the ClassWizard will add and remove member functions here.
-        //    DO NOT EDIT what you see in these blocks of generated code !
+    afx_msg void OnEditUndo ( );
+    afx_msg void OnUpdateEditUndo ( CCmdUI* pCmdUI );
+    afx_msg void OnEditRedo ( );
+    afx_msg void OnUpdateEditRedo ( CCmdUI* pCmdUI );
     //}}AFX_MSG
     DECLARE_MESSAGE_MAP()
 };
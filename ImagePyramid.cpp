@@ -0,0 +1,240 @@
+/**
+    \file ImagePyramid.cpp
+    Implementation of the ImagePyramid class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <vector>
+#include  "BufferPool.h"
+#include  "ImagePyramid.h"
+#include  "Simd.h"
+#include  "ThreadPool.h"
+
+/// sums of 4 samples within +/- this can't overflow an int.
+static const int  NarrowLimit = 1 << 29;
+//---------------------------------------------------------------------------
+/// halves rows [begin,end) of the result.
+class HalveTask : public ThreadPool::RangeTask {
+public:
+    const int*  mSrc;
+    int*        mDst;
+    int         mW, mH, mSpp, mNW;
+    bool        mNarrow;   ///< 32 bit sums are safe
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        std::vector<int>  sums;  //vertical sums of a row pair (rgb)
+        for (int y=begin; y<end; y++) {
+            const int*  r0 = mSrc + (size_t)(2*y) * mW * mSpp;
+            const int*  r1 = (2*y+1 < mH) ? r0 + (size_t)mW * mSpp : r0;
+            int*        d  = mDst + (size_t)y * mNW * mSpp;
+            if (!mNarrow)          wideRow( r0, r1, d );
+            else if (mSpp==1)      grayRow( r0, r1, d );
+            else                   rgbRow( r0, r1, d, sums );
+        }
+    }
+
+    /// 64 bit sums (any sample values).
+    void wideRow ( const int* r0, const int* r1, int* d ) {
+        for (int x=0; x<mNW; x++) {
+            const int  x0 = 2*x;
+            const int  x1 = (x0+1 < mW) ? x0+1 : x0;
+            for (int c=0; c<mSpp; c++) {
+                const long long  sum = (long long)r0[x0*mSpp+c]
+                    + r0[x1*mSpp+c] + r1[x0*mSpp+c] + r1[x1*mSpp+c];
+                //round to nearest (halves away from -inf)
+                d[x*mSpp+c] = (int)((sum + 2) >> 2);
+            }
+        }
+    }
+
+    /// gray, 4 results at a time.
+    void grayRow ( const int* r0, const int* r1, int* d ) {
+        int  x = 0;
+    #ifdef USE_SSE2
+        const __m128i  two = _mm_set1_epi32( 2 );
+        for ( ; 2*x+8 <= mW; x+=4) {
+            const __m128i  s0 = _mm_add_epi32( _mm_loadu_si128( (const __m128i*)(r0+2*x) ),
+                                               _mm_loadu_si128( (const __m128i*)(r1+2*x) ) );
+            const __m128i  s1 = _mm_add_epi32( _mm_loadu_si128( (const __m128i*)(r0+2*x+4) ),
+                                               _mm_loadu_si128( (const __m128i*)(r1+2*x+4) ) );
+            //even and odd columns
+            const __m128  f0 = _mm_castsi128_ps( s0 ), f1 = _mm_castsi128_ps( s1 );
+            const __m128i  even = _mm_castps_si128( _mm_shuffle_ps( f0, f1, _MM_SHUFFLE(2,0,2,0) ) );
+            const __m128i  odd  = _mm_castps_si128( _mm_shuffle_ps( f0, f1, _MM_SHUFFLE(3,1,3,1) ) );
+            const __m128i  sum  = _mm_add_epi32( _mm_add_epi32( even, odd ), two );
+            _mm_storeu_si128( (__m128i*)(d+x), _mm_srai_epi32( sum, 2 ) );
+        }
+    #endif
+        for ( ; x<mNW; x++) {
+            const int  x0 = 2*x;
+            const int  x1 = (x0+1 < mW) ? x0+1 : x0;
+            d[x] = (r0[x0] + r0[x1] + r1[x0] + r1[x1] + 2) >> 2;
+        }
+    }
+
+    /// rgb: vertical sums (4 samples at a time), then horizontal pairs.
+    void rgbRow ( const int* r0, const int* r1, int* d, std::vector<int>& sums ) {
+        const int  n = mW * mSpp;
+        sums.resize( n );
+        int*  s = &sums[0];
+        int   i = 0;
+    #ifdef USE_SSE2
+        for ( ; i+4 <= n; i+=4) {
+            _mm_storeu_si128( (__m128i*)(s+i),
+                _mm_add_epi32( _mm_loadu_si128( (const __m128i*)(r0+i) ),
+                               _mm_loadu_si128( (const __m128i*)(r1+i) ) ) );
+        }
+    #endif
+        for ( ; i<n; i++)    s[i] = r0[i] + r1[i];
+        for (int x=0; x<mNW; x++) {
+            const int*  p0 = s + 2*x*mSpp;
+            const int*  p1 = (2*x+1 < mW) ? p0 + mSpp : p0;
+            for (int c=0; c<mSpp; c++)
+                d[x*mSpp+c] = (p0[c] + p1[c] + 2) >> 2;
+        }
+    }
+};
+//===========================================================================
+ImagePyramid::ImagePyramid ( ) {
+    for (int i=0; i<MaxLevels; i++) {
+        mLevels[i] = NULL;
+        mW[i] = mH[i] = 0;
+    }
+    mBytes = 0;
+}
+//---------------------------------------------------------------------------
+ImagePyramid::~ImagePyramid ( ) {
+    clear();
+}
+//---------------------------------------------------------------------------
+/** \brief Number of levels (incl. level 0) down to the first one that is
+ *  at most 1 pixel wide or high.
+ */
+int ImagePyramid::levelCount ( int w, int h ) {
+    int  n = 1;
+    while (n<MaxLevels && w>1 && h>1) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        ++n;
+    }
+    return n;
+}
+//---------------------------------------------------------------------------
+/** \brief Size of a level (without building it).
+ *  \param level the level
+ *  \param w width of level 0
+ *  \param h height of level 0
+ *  \param lw receives the level's width
+ *  \param lh receives the level's height
+ */
+void ImagePyramid::levelSize ( const int level, int w, int h, int* lw, int* lh ) {
+    for (int i=0; i<level; i++) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+    *lw = w;
+    *lh = h;
+}
+//---------------------------------------------------------------------------
+/** \brief Get a level (building it, and those between it and base, if
+ *  necessary).  Not thread safe; the result remains valid until clear.
+ *  \param level desired level (> baseLevel)
+ *  \param base samples of an existing level
+ *  \param baseLevel its level (levels up to it aren't built here)
+ *  \param baseW its width
+ *  \param baseH its height
+ *  \param spp samples per pixel (1 or 3)
+ *  \param min overall min sample value
+ *  \param max overall max sample value
+ *  \param w receives the level's width
+ *  \param h receives the level's height
+ *  \returns the samples (or NULL if out of memory or no such level).
+ */
+const int* ImagePyramid::get ( const int level, const int* const base,
+                               const int baseLevel, const int baseW,
+                               const int baseH, const int spp,
+                               const int min, const int max, int* w, int* h )
+{
+    assert( base!=NULL && level>baseLevel && baseLevel>=0 );
+    if (level>=MaxLevels)    return NULL;
+    const int*  src = base;
+    int  sw = baseW, sh = baseH;
+    for (int i=baseLevel+1; i<=level; i++) {
+        if (mLevels[i]==NULL) {
+            if (sw<=1 || sh<=1)    return NULL;
+            mLevels[i] = halve( src, sw, sh, spp, min, max, &mW[i], &mH[i] );
+            if (mLevels[i]==NULL)    return NULL;
+            mBytes += (size_t)mW[i] * mH[i] * spp * sizeof(int);
+        }
+        src = mLevels[i];
+        sw = mW[i];
+        sh = mH[i];
+    }
+    *w = sw;
+    *h = sh;
+    return src;
+}
+//---------------------------------------------------------------------------
+/** \brief Discard all levels (e.g., because the image changed).  No one
+ *  may be using them.
+ */
+void ImagePyramid::clear ( void ) {
+    for (int i=0; i<MaxLevels; i++) {
+        if (mLevels[i]!=NULL)    BufferPool::instance().release( mLevels[i] );
+        mLevels[i] = NULL;
+        mW[i] = mH[i] = 0;
+    }
+    mBytes = 0;
+}
+//---------------------------------------------------------------------------
+/** \brief Make a half size (2x2 box filtered, rounded) copy of an image,
+ *  on the worker pool (and with SSE2 where available).
+ *  \param src image samples (gray, or interleaved rgb)
+ *  \param w image width
+ *  \param h image height
+ *  \param spp samples per pixel
+ *  \param min overall min sample value
+ *  \param max overall max sample value
+ *  \param nw receives the width of the copy
+ *  \param nh receives the height of the copy
+ *  \returns the copy (release with BufferPool) or NULL if out of memory.
+ */
+int* ImagePyramid::halve ( const int* const src, const int w, const int h,
+                           const int spp, const int min, const int max,
+                           int* nw, int* nh )
+{
+    *nw = (w + 1) / 2;
+    *nh = (h + 1) / 2;
+    int*  dst = (int*)BufferPool::instance().allocate(
+                          (size_t)*nw * *nh * spp * sizeof(int) );
+    if (dst==NULL)    return NULL;
+    HalveTask  t;
+    t.mSrc = src;    t.mDst = dst;
+    t.mW = w;    t.mH = h;    t.mSpp = spp;    t.mNW = *nw;
+    t.mNarrow = (min > -NarrowLimit && max < NarrowLimit);
+    ThreadPool::instance().parallelFor( *nh, t, 16 );
+    return dst;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,73 @@
+/**
+    \file ImagePyramid.h
+    Definition of the ImagePyramid class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef ImagePyramid_h
+#define ImagePyramid_h
+
+#include  <stddef.h>
+//----------------------------------------------------------------------
+/** \brief Reduced resolution copies of an image (level 1 is half size,
+ *  level 2 a quarter size, etc.), each 2x2 box filtered from the one
+ *  before it.  Levels are built when first asked for.
+ *
+ *  Used to display an image zoomed out (so that the work depends on the
+ *  window size rather than the image size).
+ */
+class ImagePyramid {
+public:
+    enum { MaxLevels = 16 };  ///< max number of levels (incl. level 0)
+
+    ImagePyramid  ( );
+    ~ImagePyramid ( );
+
+    const int* get ( const int level, const int* const base,
+                     const int baseLevel, const int baseW, const int baseH,
+                     const int spp, const int min, const int max,
+                     int* w, int* h );
+    void   clear ( void );
+    /// \returns the memory held by the levels (in bytes).
+    inline size_t getBytes ( void ) const {  return mBytes;  }
+
+    static int  levelCount ( const int w, const int h );
+    static void levelSize ( const int level, int w, int h, int* lw, int* lh );
+    static int* halve ( const int* const src, const int w, const int h,
+                        const int spp, const int min, const int max,
+                        int* nw, int* nh );
+
+protected:
+    int*    mLevels[ MaxLevels ];  ///< built levels (or NULL)
+    int     mW[ MaxLevels ];       ///< their widths
+    int     mH[ MaxLevels ];       ///< their heights
+    size_t  mBytes;                ///< memory held
+
+private:
+    ImagePyramid ( const ImagePyramid& );
+    ImagePyramid& operator= ( const ImagePyramid& );
+};
+
+#endif
+//----------------------------------------------------------------------
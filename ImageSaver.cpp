@@ -0,0 +1,367 @@
+/**
+    \file ImageSaver.cpp
+    Implementation of the ImageSaver class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <ctype.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  "BitImage.h"
+#include  "BufferPool.h"
+#include  "DisplayLUT.h"
+#include  "ImageContainer.h"
+#include  "ImageSaver.h"
+#include  "ThreadPool.h"
+#include  "TIFFWriter.h"
+
+#ifdef WIN32
+#  include <windows.h>
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+/// rows converted (and written) between progress reports.
+static const int  RowsPerChunk = 64;
+/// TIFFWriter uses file scope scratch storage so only one at a time.
+static Mutex  tiffMutex;
+//----------------------------------------------------------------------
+/** \brief Determine the output format from the file name extension
+ *  (case insensitive).
+ */
+ImageSaver::Format ImageSaver::formatFromName ( const char* const fname ) {
+    assert( fname!=NULL );
+    const char*  dot = strrchr( fname, '.' );
+    if (dot==NULL)    return FormatUnknown;
+    char  ext[8];
+    int   i;
+    for (i=0; i<(int)sizeof(ext)-1 && dot[i+1]!=0; i++)
+        ext[i] = (char)tolower( (unsigned char)dot[i+1] );
+    ext[i] = 0;
+    if ( strcmp(ext,"pgm")==0 || strcmp(ext,"ppm")==0
+      || strcmp(ext,"pnm")==0 )
+        return FormatPNM;
+    if (strcmp(ext,"tif")==0 || strcmp(ext,"tiff")==0)    return FormatTIFF;
+    if (strcmp(ext,"ivc")==0)    return FormatNative;
+    if (strcmp(ext,"pbm")==0)    return FormatPBM;
+    return FormatUnknown;
+}
+//----------------------------------------------------------------------
+/** \brief Map a sample to 0..outMax.  Samples already in range are
+ *  written as is; otherwise, the image range is linearly scaled.
+ */
+static inline int outputValue ( const int v, const int min, const int max,
+                                const int outMax )
+{
+    if (min>=0 && max<=outMax)    return v;
+    if (max<=min)                 return 0;
+    return (int)( ((double)v - min) * outMax / ((double)max - min) + 0.5 );
+}
+//----------------------------------------------------------------------
+/** \returns true if every sample is either min (0) or max (1 or 255),
+ *  i.e., the image may be written as a pbm file without losing anything.
+ */
+static bool isBinary ( const int* const data, const size_t n, const int min,
+                       const int max )
+{
+    if (!BitImage::isBinaryRange( min, max ))    return false;
+    for (size_t i=0; i<n; i++)
+        if (data[i]!=min && data[i]!=max)    return false;
+    return true;
+}
+//----------------------------------------------------------------------
+/** \brief Save an image.  The data is written to fname.tmp which (when
+ *  completely written and flushed to disk) replaces fname.
+ *  \param data image samples (gray, or interleaved rgb)
+ *  \param w image width
+ *  \param h image height
+ *  \param samplesPerPixel 1 (gray) or 3 (rgb)
+ *  \param min overall min sample value
+ *  \param max overall max sample value
+ *  \param fname output file name (its extension selects the format)
+ *  \param progress receives progress reports (may be NULL)
+ *  \param errMsg receives a description of the failure (may be NULL)
+ *  \param errMsgSize size of errMsg
+ *  \param stats statistics to be cached in a native file (may be NULL)
+ *  \param display if not NULL, write 8 bit rgb exactly as shown through
+ *         this lut (window, curve, and colormap); .pnm/.ppm or .tif only
+ *  \returns true if successful; false otherwise (fname is unchanged).
+ */
+bool ImageSaver::save ( const int* const data, const int w, const int h,
+                        const int samplesPerPixel, const int min,
+                        const int max, const char* const fname,
+                        Progress* progress, char* errMsg,
+                        const int errMsgSize,
+                        const ImageStats::Snapshot* stats,
+                        const DisplayLUT* display )
+{
+    assert( data!=NULL && w>0 && h>0 && fname!=NULL );
+    assert( samplesPerPixel==1 || samplesPerPixel==3 );
+    char  msg[512];
+    msg[0] = 0;
+
+    const Format  format = formatFromName( fname );
+    bool  ok = false;
+    char  tmpName[1024];
+    if (format==FormatUnknown) {
+        sprintf( msg, "unsupported file type (use .pbm, .pgm, .ppm, .pnm, .tif, .tiff, or .ivc)" );
+    } else if (display!=NULL && (format==FormatNative || format==FormatPBM)) {
+        sprintf( msg, "the displayed image may only be saved as .ppm, .pnm, .tif, or .tiff" );
+    } else if (format==FormatPBM && samplesPerPixel!=1) {
+        sprintf( msg, "only gray images may be saved as .pbm" );
+    } else if (format==FormatPBM && !isBinary( data, (size_t)w * h, min, max )) {
+        sprintf( msg, "only binary (0/1 or 0/255) images may be saved as .pbm (use .pgm or .ivc)" );
+    } else if (strlen(fname)+5 > sizeof tmpName) {
+        sprintf( msg, "file name is too long" );
+    } else {
+        //the temp file is in the same directory so that rename is atomic
+        sprintf( tmpName, "%s.tmp", fname );
+        FILE*  fp = fopen( tmpName, "wb" );
+        if (fp==NULL) {
+            sprintf( msg, "can't create %.400s", tmpName );
+        } else {
+            if (display!=NULL)
+                ok = writeDisplayed( fp, format, data, w, h, samplesPerPixel,
+                                     *display, progress );
+            else if (format==FormatPNM)
+                ok = writePNM( fp, data, w, h, samplesPerPixel, min, max,
+                               progress );
+            else if (format==FormatPBM)
+                ok = writePBM( fp, data, w, h, progress );
+            else if (format==FormatNative)
+                ok = writeNative( fp, data, w, h, samplesPerPixel, min, max,
+                                  stats, progress );
+            else
+                ok = writeTIFF( fp, data, w, h, samplesPerPixel, min, max,
+                                progress );
+            if (ok)    ok = commit( fp, tmpName, fname );
+            else       fclose( fp );
+            if (!ok) {
+                remove( tmpName );
+                sprintf( msg, "error writing %.400s", fname );
+            }
+        }
+    }
+
+    if (!ok && errMsg!=NULL && errMsgSize>0) {
+        strncpy( errMsg, msg, errMsgSize-1 );
+        errMsg[errMsgSize-1] = 0;
+    }
+    if (ok && progress!=NULL)    progress->report( 100 );
+    return ok;
+}
+//----------------------------------------------------------------------
+/** \brief Flush the temp file to disk, close it, and (atomically) rename
+ *  it to its final name.
+ */
+bool ImageSaver::commit ( FILE* fp, const char* const tmpName,
+                          const char* const fname )
+{
+    bool  ok = (fflush( fp )==0 && !ferror( fp ));
+    #ifdef WIN32
+        if (ok)    ok = (_commit( _fileno(fp) )==0);
+    #else
+        if (ok)    ok = (fsync( fileno(fp) )==0);
+    #endif
+    if (fclose( fp )!=0)    ok = false;
+    if (!ok)    return false;
+    #ifdef WIN32
+        return MoveFileExA( tmpName, fname,
+                   MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH )!=0;
+    #else
+        return rename( tmpName, fname )==0;
+    #endif
+}
+//----------------------------------------------------------------------
+/** \brief Write a binary pgm (P5) or ppm (P6) file.  Samples are 8 bit
+ *  if the image range is within 0..255; otherwise, 16 bit (msb first).
+ *  Samples are written as is if the range is within 0..65535; otherwise,
+ *  the range is linearly scaled to 0..65535 (as writeTIFF does).
+ */
+bool ImageSaver::writePNM ( FILE* fp, const int* const data, const int w,
+                            const int h, const int spp, const int min,
+                            const int max, Progress* progress )
+{
+    const bool  wide   = (min < 0 || max > 255);
+    const bool  asIs   = (min >= 0 && max <= 65535);
+    const int   maxval = wide ? (asIs ? max : 65535) : 255;
+    fprintf( fp, "%s\n%d %d\n%d\n", spp==1 ? "P5" : "P6", w, h, maxval );
+
+    const int       bytesPerSample = wide ? 2 : 1;
+    const size_t    rowSamples = (size_t)w * spp;
+    unsigned char*  row = (unsigned char*)malloc( rowSamples * bytesPerSample );
+    if (row==NULL)    return false;
+    bool  ok = true;
+    for (int y=0; y<h && ok; y++) {
+        const int*  src = data + y*rowSamples;
+        if (wide) {
+            for (size_t i=0; i<rowSamples; i++) {
+                const int  v = outputValue( src[i], min, max, maxval );
+                row[2*i]   = (unsigned char)(v >> 8);
+                row[2*i+1] = (unsigned char)(v & 0xff);
+            }
+        } else {
+            for (size_t i=0; i<rowSamples; i++)
+                row[i] = (unsigned char)src[i];
+        }
+        ok = (fwrite( row, bytesPerSample, rowSamples, fp )==rowSamples);
+        if (progress!=NULL && (y+1)%RowsPerChunk==0)
+            progress->report( (int)(99.0 * (y+1) / h) );
+    }
+    free( row );    row = NULL;
+    return ok;
+}
+//----------------------------------------------------------------------
+/** \brief Write a binary pbm (P4) file: 8 pixels per byte (msb first).
+ *  0 samples are black (1 bits) and 1 (or 255) samples are white (0 bits);
+ *  save checks that there are no others.
+ */
+bool ImageSaver::writePBM ( FILE* fp, const int* const data, const int w,
+                            const int h, Progress* progress )
+{
+    fprintf( fp, "P4\n%d %d\n", w, h );
+    const size_t    rowBytes = ((size_t)w + 7) / 8;
+    unsigned char*  row = (unsigned char*)malloc( rowBytes );
+    if (row==NULL)    return false;
+    bool  ok = true;
+    for (int y=0; y<h && ok; y++) {
+        const int*  src = data + (size_t)y * w;
+        memset( row, 0, rowBytes );
+        for (int x=0; x<w; x++)
+            if (src[x]==0)    row[x/8] |= (unsigned char)(0x80 >> (x%8));
+        ok = (fwrite( row, 1, rowBytes, fp )==rowBytes);
+        if (progress!=NULL && (y+1)%RowsPerChunk==0)
+            progress->report( (int)(99.0 * (y+1) / h) );
+    }
+    free( row );    row = NULL;
+    return ok;
+}
+//----------------------------------------------------------------------
+/** \brief Write an uncompressed tiff file: 8 bit gray, 16 bit gray, or
+ *  8 bit rgb (scaled if the image range doesn't fit).
+ */
+bool ImageSaver::writeTIFF ( FILE* fp, const int* const data, const int w,
+                             const int h, const int spp, const int min,
+                             const int max, Progress* progress )
+{
+    const size_t  n = (size_t)w * h * spp;
+    const bool    wide = (spp==1 && (min<0 || max>255));
+    const int     outMax = wide ? 65535 : 255;
+    void*  buff = BufferPool::instance().allocate( n * (wide ? 2 : 1) );
+    if (buff==NULL)    return false;
+
+    //convert (90% of the work), then write
+    const size_t  chunk = (size_t)RowsPerChunk * w * spp;
+    for (size_t i=0; i<n; i++) {
+        const int  v = outputValue( data[i], min, max, outMax );
+        if (wide)    ((uint16*)buff)[i] = (uint16)v;
+        else         ((uint8*)buff)[i]  = (uint8)v;
+        if (progress!=NULL && (i+1)%chunk==0)
+            progress->report( (int)(90.0 * (i+1) / n) );
+    }
+    {
+        Lock  l( tiffMutex );
+        if (wide)
+            TIFFWriter::write_tiff_data16( (uint16*)buff, w, h, fp );
+        else if (spp==1)
+            TIFFWriter::write_tiff_data8_grey( (uint8*)buff, w, h, fp );
+        else
+            TIFFWriter::write_tiff_data8_rgb( (uint8*)buff, w, h, fp,
+                                              false, 3 );
+    }
+    BufferPool::instance().release( buff );    buff = NULL;
+    return !ferror( fp );
+}
+//----------------------------------------------------------------------
+/** \brief Write 8 bit rgb (binary ppm or uncompressed tiff) converted
+ *  through the display lut's packed BGRX table, i.e., the same pixels
+ *  that are shown.
+ */
+bool ImageSaver::writeDisplayed ( FILE* fp, const Format format,
+                                  const int* const data, const int w,
+                                  const int h, const int spp,
+                                  const DisplayLUT& lut, Progress* progress )
+{
+    uint8*  rgb = (uint8*)BufferPool::instance().allocate( (size_t)w * h * 3 );
+    unsigned int*  row = (unsigned int*)malloc( (size_t)w * sizeof(unsigned int) );
+    if (rgb==NULL || row==NULL) {
+        if (rgb!=NULL)    BufferPool::instance().release( rgb );
+        free( row );
+        return false;
+    }
+    for (int y=0; y<h; y++) {
+        const int*  src = data + (size_t)y * w * spp;
+        if (spp==1)    lut.mapGray( src, row, w );
+        else           lut.mapRGB( src, row, w );
+        uint8*  d = rgb + (size_t)y * w * 3;
+        for (int x=0; x<w; x++, d+=3) {
+            d[0] = (uint8)(row[x] >> 16);
+            d[1] = (uint8)(row[x] >> 8);
+            d[2] = (uint8)row[x];
+        }
+        if (progress!=NULL && (y+1)%RowsPerChunk==0)
+            progress->report( (int)(90.0 * (y+1) / h) );
+    }
+    free( row );    row = NULL;
+    bool  ok;
+    if (format==FormatPNM) {
+        fprintf( fp, "P6\n%d %d\n255\n", w, h );
+        ok = (fwrite( rgb, (size_t)w * 3, h, fp )==(size_t)h);
+    } else {
+        Lock  l( tiffMutex );
+        TIFFWriter::write_tiff_data8_rgb( rgb, w, h, fp, false, 3 );
+        ok = !ferror( fp );
+    }
+    BufferPool::instance().release( rgb );    rgb = NULL;
+    return ok;
+}
+//----------------------------------------------------------------------
+/** \brief Writes a native container to a file.
+ */
+class FileSink : public ImageContainer::Sink {
+public:
+    FILE*  mFP;
+    FileSink ( FILE* fp ) : mFP( fp ) { }
+    virtual bool write ( const void* const buff, const size_t n ) {
+        return n==0 || fwrite( buff, n, 1, mFP )==1;
+    }
+};
+//----------------------------------------------------------------------
+/** \brief Write a native container (samples, cached statistics, and a
+ *  reduced resolution pyramid).
+ */
+bool ImageSaver::writeNative ( FILE* fp, const int* const data, const int w,
+                               const int h, const int spp, const int min,
+                               const int max,
+                               const ImageStats::Snapshot* stats,
+                               Progress* progress )
+{
+    FileSink  out( fp );
+    return ImageContainer::write( out, data, w, h, spp, min, max, stats,
+                                  true, progress );
+}
+//----------------------------------------------------------------------
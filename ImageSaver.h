@@ -0,0 +1,95 @@
+/**
+    \file ImageSaver.h
+    Definition of the ImageSaver class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef ImageSaver_h
+#define ImageSaver_h
+
+#include  <stdio.h>
+#include  "ImageStats.h"
+
+class DisplayLUT;
+//----------------------------------------------------------------------
+/** \brief This class contains methods that save an image (int samples,
+ *  gray or rgb) in the format implied by the file name extension.
+ *
+ *  The image is written to a temporary file in the destination directory
+ *  which is then renamed over the destination, so a failed or interrupted
+ *  save never leaves a half written file behind.  Saving doesn't touch any
+ *  UI state and may be run on a worker thread.
+ */
+class ImageSaver {
+public:
+    /// output formats (chosen by file name extension).
+    enum Format {
+        FormatUnknown = 0,
+        FormatPNM,        ///< .pgm, .ppm, .pnm (binary, 8 or 16 bit)
+        FormatTIFF,       ///< .tif, .tiff (uncompressed, 8 or 16 bit)
+        FormatNative,     ///< .ivc (see ImageContainer)
+        FormatPBM         ///< .pbm (binary, 1 bit: 0 is black)
+    };
+
+    /// receives progress reports (from the saving thread).
+    class Progress {
+    public:
+        virtual ~Progress ( ) { }
+        /// \param percent 0..100
+        virtual void report ( const int percent ) = 0;
+    };
+
+    static Format formatFromName ( const char* const fname );
+
+    static bool save ( const int* const data, const int w, const int h,
+                       const int samplesPerPixel, const int min,
+                       const int max, const char* const fname,
+                       Progress* progress, char* errMsg,
+                       const int errMsgSize,
+                       const ImageStats::Snapshot* stats=NULL,
+                       const DisplayLUT* display=NULL );
+
+protected:
+    static bool writePNM  ( FILE* fp, const int* const data, const int w,
+                            const int h, const int spp, const int min,
+                            const int max, Progress* progress );
+    static bool writePBM  ( FILE* fp, const int* const data, const int w,
+                            const int h, Progress* progress );
+    static bool writeTIFF ( FILE* fp, const int* const data, const int w,
+                            const int h, const int spp, const int min,
+                            const int max, Progress* progress );
+    static bool writeDisplayed ( FILE* fp, const Format format,
+                                 const int* const data, const int w,
+                                 const int h, const int spp,
+                                 const DisplayLUT& lut, Progress* progress );
+    static bool writeNative ( FILE* fp, const int* const data, const int w,
+                              const int h, const int spp, const int min,
+                              const int max, const ImageStats::Snapshot* stats,
+                              Progress* progress );
+    static bool commit    ( FILE* fp, const char* const tmpName,
+                            const char* const fname );
+};
+
+#endif
+//----------------------------------------------------------------------
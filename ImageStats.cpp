@@ -0,0 +1,357 @@
+/**
+    \file ImageStats.cpp
+    Implementation of the ImageStats class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <limits.h>
+#include  <math.h>
+#include  "ImageStats.h"
+#include  "ThreadPool.h"
+//---------------------------------------------------------------------------
+/** \brief Parallel scan of a list of tiles.  Each worker accumulates into
+ *  its own sub-histogram (merged afterwards) and writes only the summaries
+ *  of the tiles it scans.
+ */
+class ImageStats::ScanTask : public ThreadPool::RangeTask {
+public:
+    ImageStats*              mStats;
+    const std::vector<int>&  mList;     ///< tiles to scan
+    const bool               mDoStats;  ///< compute tile summaries
+    const bool               mDoHist;   ///< accumulate histogram
+    std::vector< std::vector<unsigned int> >  mSub;  ///< per worker
+    volatile long            mOutOfRange;
+
+    ScanTask ( ImageStats* s, const std::vector<int>& list,
+               const bool doStats, const bool doHist )
+        : mStats( s ), mList( list ), mDoStats( doStats ), mDoHist( doHist )
+    {
+        mSub.resize( ThreadPool::instance().getThreadCount() );
+        mOutOfRange = 0;
+    }
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        ImageStats&  s = *mStats;
+        unsigned int*  hist = NULL;
+        const unsigned int  bins = (unsigned int)s.mHist.size();
+        if (mDoHist) {
+            if (mSub[worker].empty())    mSub[worker].assign( bins, 0 );
+            hist = &mSub[worker][0];
+        }
+        for (int i=begin; i<end; i++) {
+            const int  tile = mList[i];
+            int  x0, y0, tw, th;
+            s.tileRect( tile, &x0, &y0, &tw, &th );
+            const int  rowSamples = tw * s.mSpp;
+            int  myMin=INT_MAX, myMax=INT_MIN;
+            double  sum=0, sumSq=0;
+            bool  outOfRange = false;
+            for (int y=0; y<th; y++) {
+                const int*  p = &s.mData[ ((size_t)(y0+y) * s.mW + x0) * s.mSpp ];
+                if (mDoStats) {
+                    //exact integer sums per row keep rounding error down
+                    long long  rowSum=0;
+                    double     rowSq=0;
+                    for (int x=0; x<rowSamples; x++) {
+                        const int  v = p[x];
+                        if (v<myMin)    myMin = v;
+                        if (v>myMax)    myMax = v;
+                        rowSum += v;
+                        rowSq  += (double)v * v;
+                    }
+                    sum   += (double)rowSum;
+                    sumSq += rowSq;
+                }
+                if (hist!=NULL && !outOfRange) {
+                    const int  first = s.mHistFirst, shift = s.mHistShift;
+                    for (int x=0; x<rowSamples; x++) {
+                        const unsigned int  b =
+                            (unsigned int)((long long)p[x] - first) >> shift;
+                        if (b>=bins) {  outOfRange = true;  break;  }
+                        ++hist[b];
+                    }
+                }
+            }
+            if (mDoStats) {
+                TileStats&  t = s.mTiles[tile];
+                t.min = myMin;  t.max = myMax;  t.sum = sum;  t.sumSq = sumSq;
+            }
+            if (outOfRange)    atomicAdd( &mOutOfRange, 1 );
+        }
+    }
+
+    /// add the per worker sub-histograms into h.
+    void merge ( std::vector<unsigned int>& h ) {
+        for (size_t w=0; w<mSub.size(); w++) {
+            if (mSub[w].empty())    continue;
+            const unsigned int*  src = &mSub[w][0];
+            for (size_t i=0; i<h.size(); i++)    h[i] += src[i];
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/** \brief ImageStats ctor.  Initially, no image is attached.
+ */
+ImageStats::ImageStats ( const int tileSize ) {
+    assert( tileSize>0 );
+    mData = 0;
+    mW = mH = mSpp = 0;
+    mTileSize = tileSize;
+    mTilesAcross = mTilesDown = 0;
+    mCount = 0;
+    mDirtyCount = 0;
+    mHistFirst = mHistShift = 0;
+    mHistValid = false;
+    mMinHint = 0;  mMaxHint = -1;
+    mMin = mMax = 0;
+    mSum = mSumSq = 0;
+}
+//---------------------------------------------------------------------------
+/** \brief Start keeping statistics for a (new) image.  Nothing is computed
+ *  until the first query.
+ *  \param data            image pixels (not owned)
+ *  \param w               image width
+ *  \param h               image height
+ *  \param samplesPerPixel 1 for gray, 3 for rgb
+ *  \param minHint         known min value (e.g., from the reader)
+ *  \param maxHint         known max value (ignored if less than minHint)
+ */
+void ImageStats::attach ( const int* data, const int w, const int h,
+                          const int samplesPerPixel, const int minHint,
+                          const int maxHint )
+{
+    mData = data;
+    mW = w;  mH = h;  mSpp = samplesPerPixel;
+    mTilesAcross = (w + mTileSize - 1) / mTileSize;
+    mTilesDown   = (h + mTileSize - 1) / mTileSize;
+    mCount = (long long)w * h * samplesPerPixel;
+    mMinHint = minHint;  mMaxHint = maxHint;
+    mTiles.resize( mTilesAcross * mTilesDown );
+    mHist.clear();
+    invalidateAll();
+}
+//---------------------------------------------------------------------------
+/** \brief Invalidate everything (e.g., after the whole image changed).
+ */
+void ImageStats::invalidateAll ( void ) {
+    mDirty.assign( mTilesAcross * mTilesDown, 1 );
+    mDirtyCount = (int)mDirty.size();
+    mHistValid = false;
+}
+//---------------------------------------------------------------------------
+/** \brief Invalidate the tiles that intersect a region.  Must be called
+ *  before the pixels in the region are modified.
+ *  \param x0 left column (inclusive)
+ *  \param y0 top row (inclusive)
+ *  \param x1 right column (exclusive)
+ *  \param y1 bottom row (exclusive)
+ */
+void ImageStats::invalidateRect ( int x0, int y0, int x1, int y1 ) {
+    if (x0<0)     x0 = 0;
+    if (y0<0)     y0 = 0;
+    if (x1>mW)    x1 = mW;
+    if (y1>mH)    y1 = mH;
+    if (x0>=x1 || y0>=y1)    return;
+    for (int ty=y0/mTileSize; ty<=(y1-1)/mTileSize; ty++)
+        for (int tx=x0/mTileSize; tx<=(x1-1)/mTileSize; tx++)
+            removeTile( ty*mTilesAcross + tx );
+}
+//---------------------------------------------------------------------------
+/** \brief Invalidate the given tiles.  Must be called before the pixels in
+ *  the tiles are modified.
+ */
+void ImageStats::invalidateTiles ( const std::vector<int>& tiles ) {
+    for (size_t i=0; i<tiles.size(); i++)    removeTile( tiles[i] );
+}
+//---------------------------------------------------------------------------
+/** \brief Mark a tile dirty and remove its (current) pixels from the
+ *  histogram.
+ */
+void ImageStats::removeTile ( const int tile ) {
+    if (tile<0 || tile>=(int)mDirty.size() || mDirty[tile])    return;
+    mDirty[tile] = 1;
+    ++mDirtyCount;
+    if (!mHistValid)    return;
+    int  x0, y0, tw, th;
+    tileRect( tile, &x0, &y0, &tw, &th );
+    const unsigned int  bins = (unsigned int)mHist.size();
+    for (int y=0; y<th; y++) {
+        const int*  p = &mData[ ((size_t)(y0+y) * mW + x0) * mSpp ];
+        for (int x=0; x<tw*mSpp; x++) {
+            const unsigned int  b =
+                (unsigned int)((long long)p[x] - mHistFirst) >> mHistShift;
+            if (b<bins && mHist[b]>0)    --mHist[b];
+        }
+    }
+}
+//---------------------------------------------------------------------------
+void ImageStats::tileRect ( const int tile, int* x0, int* y0,
+                            int* tw, int* th ) const
+{
+    *x0 = (tile % mTilesAcross) * mTileSize;
+    *y0 = (tile / mTilesAcross) * mTileSize;
+    *tw = (*x0 + mTileSize <= mW) ? mTileSize : mW - *x0;
+    *th = (*y0 + mTileSize <= mH) ? mTileSize : mH - *y0;
+}
+//---------------------------------------------------------------------------
+/** \brief Choose histogram bins covering [lo,hi]: one bin per value when
+ *  there are at most 65536 distinct values, else power of 2 wide bins.
+ */
+void ImageStats::setBinning ( const int lo, const int hi ) {
+    const long long  range = (long long)hi - lo;
+    int  shift = 0;
+    while ((range >> shift) >= 65536)    ++shift;
+    mHistFirst = lo;
+    mHistShift = shift;
+    mHist.assign( (size_t)(range >> shift) + 1, 0 );
+}
+//---------------------------------------------------------------------------
+/** \brief Combine the per tile summaries.
+ */
+void ImageStats::combine ( void ) {
+    mMin = INT_MAX;  mMax = INT_MIN;
+    mSum = mSumSq = 0;
+    for (size_t i=0; i<mTiles.size(); i++) {
+        if (mTiles[i].min<mMin)    mMin = mTiles[i].min;
+        if (mTiles[i].max>mMax)    mMax = mTiles[i].max;
+        mSum   += mTiles[i].sum;
+        mSumSq += mTiles[i].sumSq;
+    }
+    if (mTiles.empty())    mMin = mMax = 0;
+}
+//---------------------------------------------------------------------------
+/** \brief Rescan dirty tiles (and rebuild the histogram if necessary).
+ */
+void ImageStats::update ( void ) {
+    if (mData==0 || (mDirtyCount==0 && mHistValid))    return;
+    std::vector<int>  list;
+    for (size_t i=0; i<mDirty.size(); i++)
+        if (mDirty[i])    list.push_back( (int)i );
+    //first time with a known range?  then do it all in one pass.
+    if (!mHistValid && (int)list.size()==(int)mTiles.size()
+        && mMinHint<=mMaxHint)
+    {
+        setBinning( mMinHint, mMaxHint );
+        mHistValid = true;
+    }
+    if (!list.empty()) {
+        ScanTask  t( this, list, true, mHistValid );
+        ThreadPool::instance().parallelFor( (int)list.size(), t );
+        if (t.mOutOfRange)    mHistValid = false;
+        else if (mHistValid)  t.merge( mHist );
+        mDirty.assign( mDirty.size(), 0 );
+        mDirtyCount = 0;
+    }
+    combine();
+    if (!mHistValid) {
+        //the range changed so the histogram has to be rebuilt
+        list.resize( mTiles.size() );
+        for (size_t i=0; i<list.size(); i++)    list[i] = (int)i;
+        setBinning( mMin, mMax );
+        ScanTask  t( this, list, false, true );
+        ThreadPool::instance().parallelFor( (int)list.size(), t );
+        t.merge( mHist );
+        mHistValid = true;
+    }
+}
+//---------------------------------------------------------------------------
+int ImageStats::getMin ( void ) {  update();  return mMin;  }
+//---------------------------------------------------------------------------
+int ImageStats::getMax ( void ) {  update();  return mMax;  }
+//---------------------------------------------------------------------------
+double ImageStats::getMean ( void ) {
+    update();
+    return mCount>0 ? mSum / mCount : 0;
+}
+//---------------------------------------------------------------------------
+double ImageStats::getStdDev ( void ) {
+    update();
+    if (mCount<=0)    return 0;
+    const double  mean = mSum / mCount;
+    const double  var  = mSumSq / mCount - mean * mean;
+    return var>0 ? sqrt( var ) : 0;
+}
+//---------------------------------------------------------------------------
+/** \brief Determine the value below which p percent of the samples fall.
+ *  \param p percentile in [0,100]
+ *  \returns the (lower edge of the) histogram bin containing the percentile.
+ */
+int ImageStats::getPercentile ( const double p ) {
+    update();
+    if (mCount<=0 || mHist.empty())    return 0;
+    double  target = p / 100.0 * (double)(mCount-1);
+    if (target<0)    target = 0;
+    long long  cum = 0;
+    for (size_t i=0; i<mHist.size(); i++) {
+        cum += mHist[i];
+        if ((double)cum > target)
+            return (int)(mHistFirst + ((long long)i << mHistShift));
+    }
+    return mMax;
+}
+//---------------------------------------------------------------------------
+const std::vector<unsigned int>& ImageStats::getHistogram ( int* first,
+                                                            int* shift )
+{
+    update();
+    if (first!=0)    *first = mHistFirst;
+    if (shift!=0)    *shift = mHistShift;
+    return mHist;
+}
+//---------------------------------------------------------------------------
+/** \brief Get up to date statistics (e.g., to be saved with the image).
+ */
+void ImageStats::getSnapshot ( Snapshot* s ) {
+    update();
+    s->tileSize  = mTileSize;
+    s->tiles     = mTiles;
+    s->hist      = mHist;
+    s->histFirst = mHistFirst;
+    s->histShift = mHistShift;
+}
+//---------------------------------------------------------------------------
+/** \brief Use previously saved statistics (see getSnapshot) for the
+ *  attached image instead of scanning it.
+ *  \returns false (and leaves everything to be computed on demand) if
+ *  the saved statistics don't match the attached image.
+ */
+bool ImageStats::restore ( const Snapshot& s ) {
+    if ( mData==0 || s.tileSize!=mTileSize || s.tiles.size()!=mTiles.size()
+      || s.hist.empty() || s.histShift<0 || s.histShift>31 )
+        return false;
+    long long  n = 0;
+    for (size_t i=0; i<s.hist.size(); i++)    n += s.hist[i];
+    if (n!=mCount)    return false;
+    mTiles = s.tiles;
+    mDirty.assign( mTiles.size(), 0 );
+    mDirtyCount = 0;
+    mHist = s.hist;
+    mHistFirst = s.histFirst;
+    mHistShift = s.histShift;
+    mHistValid = true;
+    combine();
+    return true;
+}
+//---------------------------------------------------------------------------
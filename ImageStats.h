@@ -0,0 +1,123 @@
+/**
+    \file ImageStats.h
+    Definition of the ImageStats class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef ImageStats_h
+#define ImageStats_h
+
+#include  <vector>
+//----------------------------------------------------------------------
+/** \brief Lazily computed, incrementally maintained image statistics
+ *  (min, max, mean, standard deviation, histogram, and percentiles).
+ *
+ *  Statistics are kept per tile and combined on request.  Nothing is
+ *  computed until the first query; then all tiles are scanned in parallel.
+ *  When pixels change, only the affected tiles are invalidated (call
+ *  invalidateRect <em>before</em> the pixels are modified so that their
+ *  old contribution can be removed from the histogram), and only those
+ *  tiles are rescanned by the next query.
+ *
+ *  For color images, all samples (r, g, and b) are combined (as for the
+ *  overall min and max reported by the readers).
+ */
+class ImageStats {
+public:
+    /// per tile summary.
+    struct TileStats {
+        int     min, max;
+        double  sum, sumSq;
+    };
+    /// everything needed to restore the statistics without a rescan.
+    struct Snapshot {
+        int  tileSize;
+        std::vector<TileStats>     tiles;
+        std::vector<unsigned int>  hist;
+        int  histFirst, histShift;
+    };
+
+    ImageStats ( const int tileSize=256 );
+
+    void attach ( const int* data, const int w, const int h,
+                  const int samplesPerPixel, const int minHint=0,
+                  const int maxHint=-1 );
+    void invalidateRect ( int x0, int y0, int x1, int y1 );
+    void invalidateTiles ( const std::vector<int>& tiles );
+    void invalidateAll ( void );
+    /// the pixels moved (same contents, e.g., copied out of a mapped file).
+    inline void rebind ( const int* data ) {  mData = data;  }
+
+    int    getMin    ( void );
+    int    getMax    ( void );
+    double getMean   ( void );
+    double getStdDev ( void );
+    int    getPercentile ( const double p );
+    long long getCount ( void ) const {  return mCount;  }
+
+    /** \brief histogram access.  bin i counts values in
+     *  [first + (i<<shift), first + ((i+1)<<shift)).
+     */
+    const std::vector<unsigned int>& getHistogram ( int* first, int* shift );
+    /// \returns true if nothing needs to be (re)computed.
+    inline bool isCurrent ( void ) const {
+        return mDirtyCount==0 && mHistValid;
+    }
+    inline int getTileSize ( void ) const {  return mTileSize;  }
+
+    void getSnapshot ( Snapshot* s );
+    bool restore ( const Snapshot& s );
+
+protected:
+    const int*  mData;          ///< image (not owned)
+    int         mW, mH, mSpp;   ///< width, height, samples per pixel
+    int         mTileSize;      ///< tile width and height
+    int         mTilesAcross, mTilesDown;
+    long long   mCount;         ///< number of samples
+
+    std::vector<TileStats>      mTiles;   ///< per tile summaries
+    std::vector<unsigned char>  mDirty;   ///< tile needs to be rescanned
+    int                         mDirtyCount;
+
+    std::vector<unsigned int>   mHist;    ///< histogram of all samples
+    int   mHistFirst;           ///< value of the first bin
+    int   mHistShift;           ///< log2 of bin width
+    bool  mHistValid;           ///< mHist is usable (possibly minus dirty tiles)
+    int   mMinHint, mMaxHint;   ///< known range (if mMinHint<=mMaxHint)
+
+    int   mMin, mMax;           ///< combined results
+    double  mSum, mSumSq;
+
+    void  update ( void );
+    void  combine ( void );
+    void  setBinning ( const int lo, const int hi );
+    void  tileRect ( const int tile, int* x0, int* y0, int* tw, int* th ) const;
+    void  removeTile ( const int tile );
+
+    class ScanTask;
+    friend class ScanTask;
+};
+
+#endif
+//----------------------------------------------------------------------
@@ -32,6 +32,9 @@
 #include  <assert.h>
 #include  "ImageData.h"
 #include  "View.h"
+#include  "BufferPool.h"
+#include  "MemoryBudget.h"
+#include  "pnmHelper.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -83,6 +86,18 @@ BOOL ImageViewer::InitInstance ( ) {
 
 	LoadStdProfileSettings();  // Load standard INI file options (including MRU)
 
+	// Recycle large pixel and display buffers (rather than malloc/free them)
+	//  as images are opened and closed.
+	const int  poolMB = GetProfileInt( "Settings", "BufferPoolMB", 512 );
+	BufferPool::instance().setMaxRetained( (size_t)poolMB * 1024 * 1024 );
+	BufferPool::instance().setHugePages( GetProfileInt("Settings", "HugePages", 1)!=0 );
+	pnmHelper::setAllocator( BufferPool::poolAllocate );
+
+	// Limit the memory used by all open images (and their views); the least
+	//  recently viewed ones are evicted (and restored when viewed again).
+	const int  budgetMB = GetProfileInt( "Settings", "MemoryBudgetMB", 2048 );
+	MemoryBudget::instance().setBudget( (size_t)budgetMB * 1024 * 1024 );
+
 	// Register the application's document templates.  Document templates
 	//  serve as the connection between documents, frame windows and views.
 
@@ -0,0 +1,202 @@
+/**
+    \file LZCodec.h
+    Header file for (definition and implementation of) a small, fast LZ77
+    style block compressor.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef LZCodec_h
+#define LZCodec_h
+
+#include  <assert.h>
+#include  <string.h>
+//----------------------------------------------------------------------
+/** \brief This class contains methods that compress and decompress
+ *  blocks of memory (e.g., image tiles saved for undo).
+ *
+ *  The block format is a sequence of
+ *  <pre>
+ *  token (4 bits literal length, 4 bits match length-4)
+ *  [extra literal length bytes]  literals
+ *  offset (2 bytes, little endian)  [extra match length bytes]
+ *  </pre>
+ *  where a length nibble of 15 is continued by bytes of 255 terminated by
+ *  a byte less than 255.  The final sequence contains literals only.
+ *  Speed is favored over ratio (one probe per position, no lazy matching).
+ */
+class LZCodec {
+private:
+    enum { MinMatch = 4, HashBits = 12, MaxOffset = 65535 };
+
+    static inline unsigned int read32 ( const unsigned char* const p ) {
+        unsigned int  v;
+        memcpy( &v, p, sizeof v );
+        return v;
+    }
+
+    static inline int hash ( const unsigned int v ) {
+        return (int)((v * 2654435761U) >> (32-HashBits));
+    }
+    //------------------------------------------------------------------
+    /** \brief Write a length continuation (bytes of 255 ended by a
+     *  remainder byte).  \returns false if dst would overflow.
+     */
+    static inline bool putLength ( unsigned char* const dst, const int cap,
+                                   int* op, int len )
+    {
+        while (len >= 255) {
+            if (*op >= cap)    return false;
+            dst[(*op)++] = 255;
+            len -= 255;
+        }
+        if (*op >= cap)    return false;
+        dst[(*op)++] = (unsigned char)len;
+        return true;
+    }
+    //------------------------------------------------------------------
+    /** \brief Emit one sequence (literals followed by an optional match).
+     *  \returns false if dst would overflow.
+     */
+    static bool emit ( unsigned char* const dst, const int cap, int* op,
+                       const unsigned char* const lit, const int litLen,
+                       const int offset, const int matchLen )
+    {
+        if (*op >= cap)    return false;
+        const int  tokenPos = (*op)++;
+        const int  ml = (matchLen>0) ? matchLen-MinMatch : 0;
+        dst[tokenPos] = (unsigned char)( ((litLen<15 ? litLen : 15) << 4)
+                                        | (ml<15 ? ml : 15) );
+        if (litLen >= 15 && !putLength(dst, cap, op, litLen-15))
+            return false;
+        if (*op + litLen > cap)    return false;
+        memcpy( &dst[*op], lit, litLen );
+        *op += litLen;
+        if (matchLen==0)    return true;  //last sequence
+        if (*op + 2 > cap)    return false;
+        dst[(*op)++] = (unsigned char)(offset & 0xff);
+        dst[(*op)++] = (unsigned char)(offset >> 8);
+        if (ml >= 15 && !putLength(dst, cap, op, ml-15))    return false;
+        return true;
+    }
+
+public:
+    //------------------------------------------------------------------
+    /** \brief Worst case size of compressed output for n input bytes.
+     */
+    static inline int maxCompressedSize ( const int n ) {
+        return n + n/255 + 16;
+    }
+    //------------------------------------------------------------------
+    /** \brief Compress n bytes from src into dst.
+     *  \param src input bytes
+     *  \param n   number of input bytes
+     *  \param dst output buffer
+     *  \param cap capacity of dst in bytes
+     *  \returns the compressed size, or 0 if the result would not fit in
+     *  cap bytes (in which case the caller should store src as is).
+     */
+    static int compress ( const unsigned char* const src, const int n,
+                          unsigned char* const dst, const int cap )
+    {
+        assert( src!=NULL && dst!=NULL && n>=0 );
+        int  table[1 << HashBits];
+        for (int i=0; i<(1<<HashBits); i++)    table[i] = -1;
+
+        int  ip=0, anchor=0, op=0;
+        const int  limit = n - MinMatch;
+        while (ip <= limit) {
+            const unsigned int  seq = read32( &src[ip] );
+            const int  h   = hash( seq );
+            const int  ref = table[h];
+            table[h] = ip;
+            if (ref<0 || ip-ref>MaxOffset || read32(&src[ref])!=seq) {
+                //skip faster through incompressible data
+                ip += 1 + ((ip-anchor) >> 6);
+                continue;
+            }
+            int  len = MinMatch;
+            while (ip+len<n && src[ref+len]==src[ip+len])    ++len;
+            if (!emit(dst, cap, &op, &src[anchor], ip-anchor, ip-ref, len))
+                return 0;
+            ip += len;
+            anchor = ip;
+        }
+        if (!emit(dst, cap, &op, &src[anchor], n-anchor, 0, 0))    return 0;
+        return op;
+    }
+    //------------------------------------------------------------------
+    /** \brief Decompress a block produced by compress.
+     *  \param src    compressed bytes
+     *  \param srcLen number of compressed bytes
+     *  \param dst    output buffer
+     *  \param dstLen expected number of decompressed bytes
+     *  \returns true if the block decoded to exactly dstLen bytes.
+     */
+    static bool decompress ( const unsigned char* const src, const int srcLen,
+                             unsigned char* const dst, const int dstLen )
+    {
+        assert( src!=NULL && dst!=NULL );
+        int  ip=0, op=0;
+        while (ip < srcLen) {
+            const int  token = src[ip++];
+            int  litLen = token >> 4;
+            if (litLen==15) {
+                int  b;
+                do {
+                    if (ip>=srcLen)    return false;
+                    b = src[ip++];
+                    litLen += b;
+                } while (b==255);
+            }
+            if (ip+litLen>srcLen || op+litLen>dstLen)    return false;
+            memcpy( &dst[op], &src[ip], litLen );
+            ip += litLen;
+            op += litLen;
+            if (ip==srcLen)    break;  //last sequence has no match
+
+            if (ip+2>srcLen)    return false;
+            const int  offset = src[ip] | (src[ip+1] << 8);
+            ip += 2;
+            int  matchLen = (token & 0x0f);
+            if (matchLen==15) {
+                int  b;
+                do {
+                    if (ip>=srcLen)    return false;
+                    b = src[ip++];
+                    matchLen += b;
+                } while (b==255);
+            }
+            matchLen += MinMatch;
+            if (offset==0 || offset>op || op+matchLen>dstLen)    return false;
+            //byte at a time since the match may overlap its own output
+            const unsigned char*  m = &dst[op-offset];
+            for (int i=0; i<matchLen; i++)    dst[op+i] = m[i];
+            op += matchLen;
+        }
+        return op==dstLen;
+    }
+};
+
+#endif
+//----------------------------------------------------------------------
@@ -28,6 +28,7 @@
 #include "stdafx.h"
 #include "ImageViewer.h"
 #include "MainFrame.h"
+#include "ImageData.h"
 
 #ifdef _DEBUG
   #define new DEBUG_NEW
@@ -46,6 +47,8 @@ BEGIN_MESSAGE_MAP( MainFrame, CMDIFrameWnd )
 		//    DO NOT EDIT what you see in these blocks of generated code !
 	ON_WM_CREATE()
 	//}}AFX_MSG_MAP
+	ON_MESSAGE( WM_SAVE_PROGRESS, OnSaveProgress )
+	ON_MESSAGE( WM_SAVE_DONE, OnSaveDone )
 END_MESSAGE_MAP()
 
 static UINT indicators[] =
@@ -121,3 +124,30 @@ void MainFrame::Dump ( CDumpContext& dc ) const {
 
 /////////////////////////////////////////////////////////////////////////////
 // MainFrame message handlers
+/** \brief Show the progress of a background save in the status bar.
+ *  \param wParam percent complete
+ */
+LRESULT MainFrame::OnSaveProgress ( WPARAM wParam, LPARAM lParam ) {
+	CString  msg;
+	msg.Format( "Saving... %d%%", (int)wParam );
+	SetMessageText( msg );
+	return 0;
+}
+//---------------------------------------------------------------------------
+/** \brief A background save finished.  Let each document report its
+ *  outcome (the document that started the save may already be closed).
+ */
+LRESULT MainFrame::OnSaveDone ( WPARAM wParam, LPARAM lParam ) {
+	SetMessageText( wParam ? "Saved." : "Save failed." );
+	CWinApp*  app = AfxGetApp();
+	POSITION  tp = app->GetFirstDocTemplatePosition();
+	while (tp!=NULL) {
+		CDocTemplate*  t = app->GetNextDocTemplate( tp );
+		POSITION  dp = t->GetFirstDocPosition();
+		while (dp!=NULL) {
+			ImageData*  doc = DYNAMIC_DOWNCAST( ImageData, t->GetNextDoc( dp ) );
+			if (doc!=NULL)    doc->pollSave();
+		}
+	}
+	return 0;
+}
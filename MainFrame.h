@@ -69,6 +69,8 @@ protected:
 		// NOTE - the ClassWizard will add and remove member functions here.
 		//    DO NOT EDIT what you see in these blocks of generated code!
 	//}}AFX_MSG
+	afx_msg LRESULT OnSaveProgress ( WPARAM wParam, LPARAM lParam );
+	afx_msg LRESULT OnSaveDone ( WPARAM wParam, LPARAM lParam );
 	DECLARE_MESSAGE_MAP()
 };
 
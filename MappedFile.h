@@ -0,0 +1,128 @@
+/**
+    \file MappedFile.h
+    Header file for (definition and implementation of) MappedFile class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef MappedFile_h
+#define MappedFile_h
+//----------------------------------------------------------------------
+#include <stddef.h>
+
+#ifdef WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+//----------------------------------------------------------------------
+/** \brief A whole file mapped (copy on write) into memory.
+ *
+ *  Pages are read from the file on first access and may be modified in
+ *  memory; modifications are private (never written back to the file).
+ */
+class MappedFile {
+  private:
+    #ifdef WIN32
+        HANDLE   mFile;     ///< open file (or INVALID_HANDLE_VALUE)
+        HANDLE   mMap;      ///< file mapping object (or NULL)
+    #endif
+    unsigned char*  mData;  ///< mapped view (or NULL)
+    size_t          mSize;  ///< file size (in bytes)
+
+    MappedFile ( const MappedFile& );             //not copyable
+    MappedFile& operator= ( const MappedFile& );
+
+  public:
+    MappedFile ( ) {
+        #ifdef WIN32
+            mFile = INVALID_HANDLE_VALUE;
+            mMap  = NULL;
+        #endif
+        mData = NULL;
+        mSize = 0;
+    }
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    ~MappedFile ( ) {  close();  }
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    /** \brief map an entire (non empty) file.
+     *  \returns true if successful.
+     */
+    bool open ( const char* const fname ) {
+        close();
+        #ifdef WIN32
+            mFile = CreateFileA( fname, GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL );
+            if (mFile==INVALID_HANDLE_VALUE)    return false;
+            LARGE_INTEGER  size;
+            if (!GetFileSizeEx( mFile, &size ) || size.QuadPart==0
+                || (unsigned long long)size.QuadPart > (size_t)-1)
+            {
+                close();
+                return false;
+            }
+            mSize = (size_t)size.QuadPart;
+            mMap = CreateFileMapping( mFile, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+            if (mMap==NULL) {  close();  return false;  }
+            mData = (unsigned char*)MapViewOfFile( mMap, FILE_MAP_COPY, 0, 0, 0 );
+            if (mData==NULL) {  close();  return false;  }
+        #else
+            const int  fd = ::open( fname, O_RDONLY );
+            if (fd<0)    return false;
+            struct stat  st;
+            if (fstat( fd, &st )!=0 || st.st_size==0) {  ::close( fd );  return false;  }
+            mSize = (size_t)st.st_size;
+            void*  p = mmap( NULL, mSize, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                             fd, 0 );
+            ::close( fd );  //the mapping keeps the file
+            if (p==MAP_FAILED) {  mSize = 0;  return false;  }
+            mData = (unsigned char*)p;
+        #endif
+        return true;
+    }
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    /** \brief unmap (discarding any modifications) and close the file.
+     */
+    void close ( void ) {
+        #ifdef WIN32
+            if (mData!=NULL)    UnmapViewOfFile( mData );
+            if (mMap!=NULL)     CloseHandle( mMap );
+            if (mFile!=INVALID_HANDLE_VALUE)    CloseHandle( mFile );
+            mMap  = NULL;
+            mFile = INVALID_HANDLE_VALUE;
+        #else
+            if (mData!=NULL)    munmap( mData, mSize );
+        #endif
+        mData = NULL;
+        mSize = 0;
+    }
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    inline unsigned char* data ( void ) const {  return mData;  }
+    inline size_t         size ( void ) const {  return mSize;  }
+};
+
+#endif
+//----------------------------------------------------------------------
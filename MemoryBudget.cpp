@@ -0,0 +1,210 @@
+/**
+    \file MemoryBudget.cpp
+    Implementation of the MemoryBudget class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <vector>
+#include  "BufferPool.h"
+#include  "MemoryBudget.h"
+
+#ifndef WIN32
+#  include <unistd.h>
+#endif
+//---------------------------------------------------------------------------
+/** \brief The one and only memory budget (created on first use).
+ */
+MemoryBudget& MemoryBudget::instance ( void ) {
+    static MemoryBudget  budget;
+    return budget;
+}
+//---------------------------------------------------------------------------
+MemoryBudget::MemoryBudget ( ) {
+    mBudget = 0;  //unlimited
+    mUsed = 0;
+    mEvictions = 0;
+}
+//---------------------------------------------------------------------------
+/** \brief Find a client's entry (optionally adding one).  Caller must
+ *  hold mMutex.
+ */
+std::list<MemoryBudget::Entry>::iterator MemoryBudget::find ( Client* c,
+                                                             const bool create )
+{
+    for (std::list<Entry>::iterator it=mEntries.begin(); it!=mEntries.end(); ++it)
+        if (it->client==c)    return it;
+    if (!create)    return mEntries.end();
+    Entry  e;
+    e.client = c;
+    e.bytes  = 0;
+    e.pins   = 0;
+    e.evicting = false;
+    return mEntries.insert( mEntries.end(), e );
+}
+//---------------------------------------------------------------------------
+/** \brief Find a client's entry (as find), first waiting for the client
+ *  to be evicted if that is in progress.  Caller must hold mMutex (which
+ *  is released while waiting).
+ */
+std::list<MemoryBudget::Entry>::iterator MemoryBudget::findIdle ( Client* c,
+                                                                 const bool create )
+{
+    std::list<Entry>::iterator  it = find( c, create );
+    while (it!=mEntries.end() && it->evicting) {
+        mMutex.unlock();
+        #ifdef WIN32
+            Sleep( 1 );
+        #else
+            usleep( 1000 );
+        #endif
+        mMutex.lock();
+        it = find( c, create );
+    }
+    return it;
+}
+//---------------------------------------------------------------------------
+/** \brief Report the memory held by a client (registering it if
+ *  necessary).  This counts as a use of the client.  If the budget is now
+ *  exceeded, other (least recently used) clients are evicted.
+ */
+void MemoryBudget::setSize ( Client* c, const size_t bytes ) {
+    assert( c!=NULL );
+    {
+        Lock  l( mMutex );
+        std::list<Entry>::iterator  it = findIdle( c, true );
+        mUsed = mUsed - it->bytes + bytes;
+        it->bytes = bytes;
+        mEntries.splice( mEntries.end(), mEntries, it );  //most recently used
+    }
+    enforce( c );
+}
+//---------------------------------------------------------------------------
+/** \brief Unregister a client (e.g., when it's destroyed).
+ */
+void MemoryBudget::remove ( Client* c ) {
+    Lock  l( mMutex );
+    std::list<Entry>::iterator  it = findIdle( c, false );
+    if (it==mEntries.end())    return;
+    mUsed -= it->bytes;
+    mEntries.erase( it );
+}
+//---------------------------------------------------------------------------
+/** \brief Indicate that a client was just used (viewed).
+ */
+void MemoryBudget::touch ( Client* c ) {
+    Lock  l( mMutex );
+    std::list<Entry>::iterator  it = find( c, false );
+    if (it!=mEntries.end())    mEntries.splice( mEntries.end(), mEntries, it );
+}
+//---------------------------------------------------------------------------
+/** \brief Pin (delta 1) or unpin (delta -1) a client.  Use Pin rather than
+ *  calling this directly.
+ */
+void MemoryBudget::pin ( Client* c, const int delta ) {
+    bool  unpinned;
+    {
+        Lock  l( mMutex );
+        std::list<Entry>::iterator  it = findIdle( c, true );
+        it->pins += delta;
+        assert( it->pins>=0 );
+        unpinned = (it->pins==0);
+    }
+    //(the client was just used, so it isn't the one to evict)
+    if (unpinned)    enforce( c );
+}
+//---------------------------------------------------------------------------
+/** \brief Set the limit (in bytes; 0 for none) and enforce it.
+ */
+void MemoryBudget::setBudget ( const size_t bytes ) {
+    {
+        Lock  l( mMutex );
+        mBudget = bytes;
+    }
+    enforce( NULL );
+}
+//---------------------------------------------------------------------------
+/** \brief Evict least recently used clients (other than keep and pinned
+ *  ones) until the budget is met (or nothing else may be evicted).  Free
+ *  buffers that the BufferPool keeps for reuse count against the budget
+ *  too, so they're given back to the OS as clients are evicted.
+ *
+ *  The victims are chosen (and marked) with mMutex held, and evicted after
+ *  it is released.  Caller must not hold mMutex.
+ */
+void MemoryBudget::enforce ( Client* keep ) {
+    std::vector<Client*>  tried;
+    for ( ; ; ) {
+        size_t  budget, used;
+        {
+            Lock  l( mMutex );
+            if (mBudget==0)    return;
+            budget = mBudget;
+            used = mUsed;
+        }
+        //free buffers kept by the pool (e.g., the pixels of clients evicted
+        // below) are still process memory: only what's left of the budget
+        // is kept
+        BufferPool::instance().trim( used<budget ? budget-used : 0 );
+
+        //choose (enough to meet the budget if they release everything)
+        std::vector<Client*>  victims;
+        {
+            Lock  l( mMutex );
+            if (mBudget==0)    return;
+            used = mUsed;
+            for (std::list<Entry>::iterator it=mEntries.begin();
+                 it!=mEntries.end() && used>mBudget; ++it)
+            {
+                if ( it->client==keep || it->pins>0 || it->bytes==0
+                  || it->evicting )
+                    continue;
+                bool  seen = false;
+                for (size_t i=0; i<tried.size() && !seen; i++)
+                    seen = (tried[i]==it->client);
+                if (seen)    continue;
+                it->evicting = true;
+                victims.push_back( it->client );
+                tried.push_back( it->client );
+                used -= it->bytes;
+            }
+        }
+        if (victims.empty())    return;
+
+        //evict, then account for what was actually released
+        for (size_t i=0; i<victims.size(); i++) {
+            const size_t  left = victims[i]->evict();
+            Lock  l( mMutex );
+            std::list<Entry>::iterator  it = find( victims[i], false );
+            assert( it!=mEntries.end() && it->evicting );
+            it->evicting = false;
+            if (left<it->bytes) {
+                mUsed = mUsed - it->bytes + left;
+                it->bytes = left;
+                ++mEvictions;
+            }
+        }
+    }
+}
+//---------------------------------------------------------------------------
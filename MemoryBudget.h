@@ -0,0 +1,110 @@
+/**
+    \file MemoryBudget.h
+    Definition of the MemoryBudget class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef MemoryBudget_h
+#define MemoryBudget_h
+
+#include  <stddef.h>
+#include  <list>
+#include  "ThreadPool.h"
+//----------------------------------------------------------------------
+/** \brief Process wide limit on the memory used by open documents and
+ *  their views.
+ *
+ *  Owners of large buffers (image pixels, display buffers, pyramids)
+ *  register as clients and report how much they hold.  When the total
+ *  exceeds the budget, the least recently used clients are asked to
+ *  release their memory (see Client::evict) until it fits again.
+ *  Clients restore their data themselves when it is needed again (and
+ *  then report their new size, which may evict others).
+ *
+ *  Clients that are in use (e.g., being drawn) are pinned so that they
+ *  aren't evicted out from under their user.  Evicting may take a while
+ *  (e.g., writing modified pixels to a scratch file), so it's done
+ *  without holding the lock; only those pinning, resizing, or removing
+ *  a client that is being evicted wait for it.
+ */
+class MemoryBudget {
+public:
+    /// something that holds (evictable) memory.
+    class Client {
+    public:
+        virtual ~Client ( ) { }
+        /** \brief release as much memory as possible.  Must not call
+         *  back into the MemoryBudget.
+         *  \returns the number of bytes still held.
+         */
+        virtual size_t evict ( void ) = 0;
+    };
+
+    /// keeps a client from being evicted while in scope.
+    class Pin {
+    private:
+        Client*  mClient;
+        Pin ( const Pin& );
+        Pin& operator= ( const Pin& );
+    public:
+        Pin  ( Client* c ) : mClient( c ) {  instance().pin( mClient, 1 );  }
+        ~Pin ( ) {  instance().pin( mClient, -1 );  }
+    };
+
+    static MemoryBudget& instance ( void );
+
+    void   setSize ( Client* c, const size_t bytes );
+    void   remove  ( Client* c );
+    void   touch   ( Client* c );
+    void   pin     ( Client* c, const int delta );
+
+    void   setBudget ( const size_t bytes );
+    inline size_t getBudget ( void ) const {  return mBudget;  }
+    inline size_t getUsed   ( void ) const {  return mUsed;  }
+    inline long   getEvictions ( void ) const {  return mEvictions;  }
+
+protected:
+    MemoryBudget ( );
+
+    /// one registered client.
+    struct Entry {
+        Client*  client;
+        size_t   bytes;   ///< memory currently held
+        int      pins;    ///< evictable only if 0
+        bool     evicting;  ///< being evicted (without mMutex held)
+    };
+
+    Mutex              mMutex;
+    std::list<Entry>   mEntries;   ///< least recently used first
+    size_t             mBudget;    ///< limit (in bytes; 0 for none)
+    size_t             mUsed;      ///< sum of all entries' bytes
+    long               mEvictions; ///< number of evict calls that freed memory
+
+    std::list<Entry>::iterator find ( Client* c, const bool create );
+    std::list<Entry>::iterator findIdle ( Client* c, const bool create );
+    void   enforce ( Client* keep );
+};
+
+#endif
+//----------------------------------------------------------------------
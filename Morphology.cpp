@@ -0,0 +1,482 @@
+/**
+    \file Morphology.cpp
+    Implementation of the Morphology class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <limits.h>
+#include  <string.h>
+#include  <vector>
+#include  "BitImage.h"
+#include  "Morphology.h"
+#include  "Simd.h"
+#include  "ThreadPool.h"
+
+/// columns per strip of the column pass.
+static const int  StripWidth = 64;
+/// words per strip of the binary column pass.
+static const int  StripWords = 8;
+//---------------------------------------------------------------------------
+/// erosion.
+struct MinOp {
+    static inline int identity ( void ) {  return INT_MAX;  }
+    static inline int apply ( const int a, const int b ) {  return (a<b) ? a : b;  }
+#ifdef USE_SSE2
+    static inline __m128i apply ( const __m128i a, const __m128i b ) {
+        const __m128i  lt = _mm_cmplt_epi32( a, b );
+        return _mm_or_si128( _mm_and_si128( lt, a ), _mm_andnot_si128( lt, b ) );
+    }
+#endif
+};
+//---------------------------------------------------------------------------
+/// dilation.
+struct MaxOp {
+    static inline int identity ( void ) {  return INT_MIN;  }
+    static inline int apply ( const int a, const int b ) {  return (a>b) ? a : b;  }
+#ifdef USE_SSE2
+    static inline __m128i apply ( const __m128i a, const __m128i b ) {
+        const __m128i  gt = _mm_cmpgt_epi32( a, b );
+        return _mm_or_si128( _mm_and_si128( gt, a ), _mm_andnot_si128( gt, b ) );
+    }
+#endif
+};
+//---------------------------------------------------------------------------
+/// d[i] = a[i] op b[i] for n values.
+template <class Op>
+static inline void combineRow ( const int* a, const int* b, int* d,
+                                const int n )
+{
+    int  i = 0;
+#ifdef USE_SSE2
+    for ( ; i+4<=n; i+=4) {
+        const __m128i  va = _mm_loadu_si128( (const __m128i*)(a+i) );
+        const __m128i  vb = _mm_loadu_si128( (const __m128i*)(b+i) );
+        _mm_storeu_si128( (__m128i*)(d+i), Op::apply( va, vb ) );
+    }
+#endif
+    for ( ; i<n; i++)    d[i] = Op::apply( a[i], b[i] );
+}
+//---------------------------------------------------------------------------
+/** \brief 1D van Herk/Gil-Werman: out[x] = op of f[x-before..x-before+k-1]
+ *  (ignoring positions outside 0..n-1).
+ *  \param f n values (may be out)
+ *  \param pad scratch (n+k-1 values)
+ *  \param g scratch (n+k-1 values)
+ *  \param h scratch (n+k-1 values)
+ */
+template <class Op>
+static void vhgw ( const int* f, const int n, const int k, const int before,
+                   int* out, int* pad, int* g, int* h )
+{
+    const int  m = n + k - 1;
+    const int  id = Op::identity();
+    //pad[i] is f[i-before] (identity outside)
+    for (int i=0; i<before; i++)       pad[i] = id;
+    memcpy( pad + before, f, n * sizeof(int) );
+    for (int i=before+n; i<m; i++)     pad[i] = id;
+    for (int b=0; b<m; b+=k) {
+        const int  e = (b + k < m) ? b + k : m;
+        int  acc = pad[b];
+        g[b] = acc;
+        for (int i=b+1; i<e; i++)      g[i] = acc = Op::apply( acc, pad[i] );
+        acc = pad[e-1];
+        h[e-1] = acc;
+        for (int i=e-2; i>=b; i--)     h[i] = acc = Op::apply( acc, pad[i] );
+    }
+    for (int x=0; x<n; x++)    out[x] = Op::apply( h[x], g[x+k-1] );
+}
+//---------------------------------------------------------------------------
+/// window along each of rows [begin,end).
+template <class Op>
+class RowPass : public ThreadPool::RangeTask {
+public:
+    const int*  mSrc;
+    int*        mDst;
+    int         mW, mK, mBefore;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const size_t  m = (size_t)mW + mK - 1;
+        std::vector<int>  pad( m ), g( m ), h( m );
+        for (int y=begin; y<end; y++)
+            vhgw<Op>( mSrc + (size_t)y * mW, mW, mK, mBefore,
+                      mDst + (size_t)y * mW, &pad[0], &g[0], &h[0] );
+    }
+};
+//---------------------------------------------------------------------------
+/// window along the columns of strips [begin,end) (a row of a strip at a time).
+template <class Op>
+class ColumnPass : public ThreadPool::RangeTask {
+public:
+    const int*  mSrc;
+    int*        mDst;
+    int         mW, mH, mK, mBefore;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const int  m = mH + mK - 1;
+        const int  S = StripWidth;
+        std::vector<int>  g( (size_t)m * S ), h( (size_t)m * S );
+        std::vector<int>  id( S, Op::identity() );
+        for (int s=begin; s<end; s++) {
+            const int  c0 = s * S;
+            const int  n  = (mW - c0 < S) ? mW - c0 : S;
+            for (int b=0; b<m; b+=mK) {
+                const int  e = (b + mK < m) ? b + mK : m;
+                memcpy( &g[(size_t)b*S], row( b, c0, &id[0] ), n * sizeof(int) );
+                for (int i=b+1; i<e; i++)
+                    combineRow<Op>( &g[(size_t)(i-1)*S], row( i, c0, &id[0] ),
+                                    &g[(size_t)i*S], n );
+                memcpy( &h[(size_t)(e-1)*S], row( e-1, c0, &id[0] ),
+                        n * sizeof(int) );
+                for (int i=e-2; i>=b; i--)
+                    combineRow<Op>( &h[(size_t)(i+1)*S], row( i, c0, &id[0] ),
+                                    &h[(size_t)i*S], n );
+            }
+            //(all of the strip has been read, so dst may be src)
+            for (int y=0; y<mH; y++)
+                combineRow<Op>( &h[(size_t)y*S], &g[(size_t)(y+mK-1)*S],
+                                mDst + (size_t)y * mW + c0, n );
+        }
+    }
+
+    /// row i of the padded strip.
+    inline const int* row ( const int i, const int c0, const int* id ) const {
+        const int  y = i - mBefore;
+        return (y<0 || y>=mH) ? id : mSrc + (size_t)y * mW + c0;
+    }
+};
+//---------------------------------------------------------------------------
+/// window along diagonals [begin,end).
+template <class Op>
+class DiagonalPass : public ThreadPool::RangeTask {
+public:
+    const int*  mSrc;
+    int*        mDst;
+    int         mW, mH, mK, mBefore;
+    bool        mAnti;   ///< up and to the right (otherwise, down)
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const int  longest = (mW < mH) ? mW : mH;
+        const size_t  m = (size_t)longest + mK - 1;
+        std::vector<int>  line( longest ), pad( m ), g( m ), h( m );
+        for (int d=begin; d<end; d++) {
+            //diagonals start on the left column, then the top (or bottom) row
+            int  x = 0, y = d;
+            if (d >= mH) {
+                x = d - mH + 1;
+                y = mAnti ? mH - 1 : 0;
+            } else if (!mAnti) {
+                y = mH - 1 - d;
+            }
+            const int  dy = mAnti ? -1 : 1;
+            int  n = 0;
+            for (int xi=x, yi=y; xi<mW && yi>=0 && yi<mH; xi++, yi+=dy)
+                line[n++] = mSrc[ (size_t)yi * mW + xi ];
+            vhgw<Op>( &line[0], n, mK, mBefore, &line[0], &pad[0], &g[0], &h[0] );
+            for (int i=0; i<n; i++)
+                mDst[ (size_t)(y + i*dy) * mW + x + i ] = line[i];
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// erode (or dilate) with a kw x kh rectangle.
+template <class Op>
+static void rect ( const int* const src, const int w, const int h,
+                   int* const dst, const int kw, const int kh, const bool dilate )
+{
+    ThreadPool&  pool = ThreadPool::instance();
+    const int*  from = src;
+    if (kw > 1) {
+        RowPass<Op>  r;
+        r.mSrc = src;    r.mDst = dst;    r.mW = w;    r.mK = kw;
+        r.mBefore = dilate ? kw - 1 - kw/2 : kw/2;
+        pool.parallelFor( h, r, 4 );
+        from = dst;
+    }
+    if (kh > 1) {
+        ColumnPass<Op>  c;
+        c.mSrc = from;    c.mDst = dst;    c.mW = w;    c.mH = h;    c.mK = kh;
+        c.mBefore = dilate ? kh - 1 - kh/2 : kh/2;
+        pool.parallelFor( (w + StripWidth - 1) / StripWidth, c, 1 );
+        from = dst;
+    }
+    if (from!=dst)    memcpy( dst, src, (size_t)w * h * sizeof(int) );
+}
+//---------------------------------------------------------------------------
+/// erode (or dilate) with a diagonal line.
+template <class Op>
+static void diag ( const int* const src, const int w, const int h,
+                   int* const dst, const int k, const bool anti,
+                   const bool dilate )
+{
+    DiagonalPass<Op>  d;
+    d.mSrc = src;    d.mDst = dst;    d.mW = w;    d.mH = h;    d.mK = k;
+    d.mBefore = dilate ? k - 1 - k/2 : k/2;
+    d.mAnti = anti;
+    ThreadPool::instance().parallelFor( w + h - 1, d, 16 );
+}
+//===========================================================================
+/** \brief Erode, dilate, open, or close with a kw x kh rectangle (kh=1 is
+ *  a horizontal line and kw=1 a vertical one).
+ *  \param src w*h pixels
+ *  \param w image width
+ *  \param h image height
+ *  \param dst receives w*h pixels (may be src)
+ *  \param op Erode, Dilate, Open, or Close
+ *  \param kw rectangle width (at least 1)
+ *  \param kh rectangle height (at least 1)
+ */
+void Morphology::rectangle ( const int* const src, const int w, const int h,
+                             int* const dst, const int op, const int kw,
+                             const int kh )
+{
+    assert( src!=NULL && dst!=NULL && w>0 && h>0 && kw>0 && kh>0 );
+    switch (op) {
+        case Erode :
+            rect<MinOp>( src, w, h, dst, kw, kh, false );
+            break;
+        case Dilate :
+            rect<MaxOp>( src, w, h, dst, kw, kh, true );
+            break;
+        case Open :
+            rect<MinOp>( src, w, h, dst, kw, kh, false );
+            rect<MaxOp>( dst, w, h, dst, kw, kh, true );
+            break;
+        case Close :
+            rect<MaxOp>( src, w, h, dst, kw, kh, true );
+            rect<MinOp>( dst, w, h, dst, kw, kh, false );
+            break;
+        default :
+            assert( 0 );
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Erode, dilate, open, or close with a diagonal line.
+ *  \param src w*h pixels
+ *  \param w image width
+ *  \param h image height
+ *  \param dst receives w*h pixels (may be src)
+ *  \param op Erode, Dilate, Open, or Close
+ *  \param length number of pixels in the line (at least 1)
+ *  \param anti line from lower left to upper right (otherwise, upper left
+ *  to lower right)
+ */
+void Morphology::diagonal ( const int* const src, const int w, const int h,
+                            int* const dst, const int op, const int length,
+                            const bool anti )
+{
+    assert( src!=NULL && dst!=NULL && w>0 && h>0 && length>0 );
+    switch (op) {
+        case Erode :
+            diag<MinOp>( src, w, h, dst, length, anti, false );
+            break;
+        case Dilate :
+            diag<MaxOp>( src, w, h, dst, length, anti, true );
+            break;
+        case Open :
+            diag<MinOp>( src, w, h, dst, length, anti, false );
+            diag<MaxOp>( dst, w, h, dst, length, anti, true );
+            break;
+        case Close :
+            diag<MaxOp>( src, w, h, dst, length, anti, true );
+            diag<MinOp>( dst, w, h, dst, length, anti, false );
+            break;
+        default :
+            assert( 0 );
+    }
+}
+//===========================================================================
+typedef BitImage::Word  Word;
+//---------------------------------------------------------------------------
+/** \brief dst bit i = src bit i+s, for words words (fill outside them).
+ */
+static void shiftBits ( const Word* src, Word* dst, const int words,
+                        const int s, const Word fill )
+{
+    const int  ws = (s >= 0) ? s / BitImage::WordBits
+                             : -((-s + BitImage::WordBits - 1) / BitImage::WordBits);
+    const int  bs = s - ws * BitImage::WordBits;  //0..63
+    for (int i=0; i<words; i++) {
+        const int   j  = i + ws;
+        const Word  lo = (j>=0 && j<words) ? src[j] : fill;
+        if (bs==0) {
+            dst[i] = lo;
+            continue;
+        }
+        const Word  hi = (j+1>=0 && j+1<words) ? src[j+1] : fill;
+        dst[i] = (lo >> bs) | (hi << (BitImage::WordBits - bs));
+    }
+}
+//---------------------------------------------------------------------------
+/// binary window along each of rows [begin,end), by doubling.
+class BitRowPass : public ThreadPool::RangeTask {
+public:
+    const BitImage*  mSrc;
+    BitImage*        mDst;
+    int              mK, mBefore;
+    bool             mOr;      ///< dilate (otherwise, erode)
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const int   w = mSrc->getW();
+        //long enough for the pixels before and after the row
+        const int   words = (w + mK + BitImage::WordBits - 1) / BitImage::WordBits;
+        const int   rowWords = mSrc->getWordsPerRow();
+        const Word  fill = mOr ? 0 : ~(Word)0;
+        const int   used = w % BitImage::WordBits;
+        const Word  last = (used==0) ? ~(Word)0 : (((Word)1 << used) - 1);
+        std::vector<Word>  a( words ), p( words ), r( words ), t( words );
+        for (int y=begin; y<end; y++) {
+            //a(i) is pixel i-before (identity outside the row)
+            for (int i=0; i<words; i++)    t[i] = (i<rowWords) ? mSrc->row( y )[i] : fill;
+            t[rowWords-1] = mOr ? (t[rowWords-1] & last) : (t[rowWords-1] | ~last);
+            shiftBits( &t[0], &a[0], words, -mBefore, fill );
+            //r(i) = op of a(i..i+k-1): p covers len pixels; add them as
+            //the bits of k say
+            for (int i=0; i<words; i++) {  p[i] = a[i];  r[i] = fill;  }
+            int  offset = 0;
+            for (int len=1; len<=mK; len*=2) {
+                if (mK & len) {
+                    shiftBits( &p[0], &t[0], words, offset, fill );
+                    if (mOr)    for (int i=0; i<words; i++)    r[i] |= t[i];
+                    else        for (int i=0; i<words; i++)    r[i] &= t[i];
+                    offset += len;
+                }
+                if (len*2 > mK)    break;
+                shiftBits( &p[0], &t[0], words, len, fill );
+                if (mOr)    for (int i=0; i<words; i++)    p[i] |= t[i];
+                else        for (int i=0; i<words; i++)    p[i] &= t[i];
+            }
+            Word*  d = mDst->row( y );
+            for (int i=0; i<rowWords; i++)    d[i] = r[i];
+            d[rowWords-1] &= last;
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/// binary van Herk/Gil-Werman along the columns of strips [begin,end) of words.
+class BitColumnPass : public ThreadPool::RangeTask {
+public:
+    BitImage*  mImage;   ///< in place
+    int        mK, mBefore;
+    bool       mOr;      ///< dilate (otherwise, erode)
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const int   h = mImage->getH();
+        const int   rowWords = mImage->getWordsPerRow();
+        const int   m = h + mK - 1;
+        const int   S = StripWords;
+        const Word  fill = mOr ? 0 : ~(Word)0;
+        std::vector<Word>  g( (size_t)m * S ), hh( (size_t)m * S ), id( S, fill );
+        for (int s=begin; s<end; s++) {
+            const int  c0 = s * S;
+            const int  n  = (rowWords - c0 < S) ? rowWords - c0 : S;
+            for (int b=0; b<m; b+=mK) {
+                const int  e = (b + mK < m) ? b + mK : m;
+                combine( &id[0], row( b, c0, &id[0] ), &g[(size_t)b*S], n );
+                for (int i=b+1; i<e; i++)
+                    combine( &g[(size_t)(i-1)*S], row( i, c0, &id[0] ),
+                             &g[(size_t)i*S], n );
+                combine( &id[0], row( e-1, c0, &id[0] ), &hh[(size_t)(e-1)*S], n );
+                for (int i=e-2; i>=b; i--)
+                    combine( &hh[(size_t)(i+1)*S], row( i, c0, &id[0] ),
+                             &hh[(size_t)i*S], n );
+            }
+            for (int y=0; y<h; y++)
+                combine( &hh[(size_t)y*S], &g[(size_t)(y+mK-1)*S],
+                         mImage->row( y ) + c0, n );
+        }
+    }
+
+    inline void combine ( const Word* a, const Word* b, Word* d,
+                          const int n ) const
+    {
+        if (mOr)    for (int i=0; i<n; i++)    d[i] = a[i] | b[i];
+        else        for (int i=0; i<n; i++)    d[i] = a[i] & b[i];
+    }
+
+    /// row i of the padded strip.
+    inline const Word* row ( const int i, const int c0, const Word* id ) const {
+        const int  y = i - mBefore;
+        return (y<0 || y>=mImage->getH()) ? id : mImage->row( y ) + c0;
+    }
+};
+//---------------------------------------------------------------------------
+/// binary erode (or dilate) with a kw x kh rectangle (dst is allocated).
+static void bitRect ( const BitImage& src, BitImage* const dst, const int kw,
+                      const int kh, const bool dilate )
+{
+    ThreadPool&  pool = ThreadPool::instance();
+    if (kw > 1) {
+        BitRowPass  r;
+        r.mSrc = &src;    r.mDst = dst;    r.mK = kw;    r.mOr = dilate;
+        r.mBefore = dilate ? kw - 1 - kw/2 : kw/2;
+        pool.parallelFor( src.getH(), r, 4 );
+    } else if (dst!=&src) {
+        memcpy( dst->row( 0 ), src.row( 0 ), src.getBytes() );
+    }
+    if (kh > 1) {
+        BitColumnPass  c;
+        c.mImage = dst;    c.mK = kh;    c.mOr = dilate;
+        c.mBefore = dilate ? kh - 1 - kh/2 : kh/2;
+        pool.parallelFor( (dst->getWordsPerRow() + StripWords - 1) / StripWords,
+                          c, 1 );
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Erode, dilate, open, or close a packed binary image with a
+ *  kw x kh rectangle (word-parallel).
+ *  \param src the image
+ *  \param dst receives the result (may be &src)
+ *  \param op Erode, Dilate, Open, or Close
+ *  \param kw rectangle width (at least 1)
+ *  \param kh rectangle height (at least 1)
+ *  \returns false if out of memory.
+ */
+bool Morphology::rectangle ( const BitImage& src, BitImage* const dst,
+                             const int op, const int kw, const int kh )
+{
+    assert( !src.empty() && dst!=NULL && kw>0 && kh>0 );
+    if (dst!=&src && !dst->create( src.getW(), src.getH(), src.getOne() ))
+        return false;
+    switch (op) {
+        case Erode :
+            bitRect( src, dst, kw, kh, false );
+            break;
+        case Dilate :
+            bitRect( src, dst, kw, kh, true );
+            break;
+        case Open :
+            bitRect( src, dst, kw, kh, false );
+            bitRect( *dst, dst, kw, kh, true );
+            break;
+        case Close :
+            bitRect( src, dst, kw, kh, true );
+            bitRect( *dst, dst, kw, kh, false );
+            break;
+        default :
+            assert( 0 );
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,69 @@
+/**
+    \file Morphology.h
+    Definition of the Morphology class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef Morphology_h
+#define Morphology_h
+
+class BitImage;
+//----------------------------------------------------------------------
+/** \brief Gray and binary morphology (erosion, dilation, opening, and
+ *  closing) with rectangles (including horizontal and vertical lines)
+ *  and diagonal lines as structuring elements.
+ *
+ *  Each 1D pass uses the van Herk/Gil-Werman algorithm: the line is cut
+ *  into blocks the size of the element, and running min/max's from both
+ *  ends of each block give every window's result with 3 comparisons per
+ *  pixel, whatever the size of the element.  Rectangles are separable
+ *  (rows, then columns).  Rows are processed in parallel; columns are
+ *  processed in parallel strips, a whole row of the strip at a time
+ *  (with SSE2).
+ *
+ *  Packed binary images use word-parallel passes instead: rows by
+ *  shifting and combining whole words (log of the element width passes)
+ *  and columns by van Herk/Gil-Werman on words (64 pixels at a time).
+ *
+ *  Elements are centered on the pixel (for even sizes, the extra pixel
+ *  is before it for erosion and after it for dilation, so that opening
+ *  and closing are exact).  Pixels outside the image are ignored.  The
+ *  result may replace the source (dst==src).
+ */
+class Morphology {
+public:
+    /// operations.
+    enum Op { Erode, Dilate, Open, Close };
+
+    static void rectangle ( const int* const src, const int w, const int h,
+                            int* const dst, const int op, const int kw,
+                            const int kh );
+    static void diagonal  ( const int* const src, const int w, const int h,
+                            int* const dst, const int op, const int length,
+                            const bool anti );
+    static bool rectangle ( const BitImage& src, BitImage* const dst,
+                            const int op, const int kw, const int kh );
+};
+
+#endif
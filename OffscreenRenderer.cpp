@@ -0,0 +1,292 @@
+/**
+    \file OffscreenRenderer.cpp
+    Implementation of the OffscreenRenderer class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <limits.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  "BufferPool.h"
+#include  "FrameRenderer.h"
+#include  "ImageContainer.h"
+#include  "ImagePyramid.h"
+#include  "ImageSaver.h"
+#include  "ImageStats.h"
+#include  "OffscreenRenderer.h"
+#include  "ThreadPool.h"
+#include  "TileRenderer.h"
+#include  "pnmHelper.h"
+//---------------------------------------------------------------------------
+/** \brief \returns the zoom that fits an image into maxSize x maxSize (but
+ *  doesn't enlarge it), limited as in a view (to the last pyramid level).
+ */
+double OffscreenRenderer::previewZoom ( const int w, const int h,
+                                        const int maxSize )
+{
+    assert( w>0 && h>0 && maxSize>0 );
+    const int  longest = (w>h) ? w : h;
+    double  zoom = (longest>maxSize) ? (double)maxSize / longest : 1;
+    const int  levels = ImagePyramid::levelCount( w, h );
+    const double  minZoom = 1.0 / (1 << (levels-1));
+    if (zoom<minZoom)    zoom = minZoom;
+    return zoom;
+}
+//---------------------------------------------------------------------------
+/// converts bands of rows of a level (see TileRenderer::convert).
+class ConvertTask : public ThreadPool::RangeTask {
+public:
+    enum { BandRows = 64 };
+    const int*  mSrc;
+    int         mW, mH, mSpp;
+    const DisplayLUT*  mLUT;
+    unsigned int*  mPixels;  ///< upper left pixel (inside the apron)
+    int         mStride;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        for (int b=begin; b<end; b++) {
+            const int  y0 = b * BandRows;
+            const int  rows = (mH - y0 < BandRows) ? mH - y0 : BandRows;
+            //(neighboring bands write the same apron rows with the same values)
+            TileRenderer::convert( mSrc, mW, mH, mSpp, *mLUT, 0, y0, mW, rows,
+                                   mPixels + (size_t)y0 * mStride, mStride );
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/** \brief Render an image as a view would show it (at the given zoom,
+ *  scrolled to its upper left, in a window of exactly its size).
+ *  \param data image samples (gray, or interleaved rgb)
+ *  \param w image width
+ *  \param h image height
+ *  \param spp samples per pixel (1 or 3)
+ *  \param min overall min sample value
+ *  \param max overall max sample value
+ *  \param settings display settings (the lut's range is set to min..max)
+ *  \param zoom displayed pixels per image pixel (see previewZoom)
+ *  \param out receives the displayed pixels (BGRX)
+ *  \returns false if out of memory.
+ */
+bool OffscreenRenderer::render ( const int* const data, const int w,
+                                 const int h, const int spp, const int min,
+                                 const int max, const Settings& settings,
+                                 double zoom, DisplaySurface* out )
+{
+    assert( data!=NULL && w>0 && h>0 && (spp==1 || spp==3) && out!=NULL );
+    //the lut: mode, colormap, and window as set, range (and histogram) of
+    // this image (as View::buildLUT)
+    DisplayLUT  lut = settings.lut;
+    if (lut.getMode()==DisplayLUT::Equalize) {
+        ImageStats  stats;
+        stats.attach( data, w, h, spp, min, max );
+        int  first, shift;
+        const std::vector<unsigned int>&  hist = stats.getHistogram( &first, &shift );
+        lut.setHistogram( hist, first, shift );
+    }
+    lut.build( min, max );
+
+    const int  levels = ImagePyramid::levelCount( w, h );
+    const double  minZoom = 1.0 / (1 << (levels-1));
+    if (zoom<minZoom)    zoom = minZoom;
+    double  f;
+    const int  level = FrameRenderer::displayLevel( zoom, w, h, &f );
+    ImagePyramid  pyramid;
+    int  lw = w, lh = h;
+    const int*  src = data;
+    if (level>0)    src = pyramid.get( level, data, 0, w, h, spp, min, max, &lw, &lh );
+    if (src==NULL)    return false;
+
+    //the whole level as one tile (with its apron)
+    const int  stride = lw + 2;
+    unsigned int*  buffer = (unsigned int*)BufferPool::instance().allocate(
+                                (size_t)stride * (lh + 2) * sizeof(unsigned int) );
+    if (buffer==NULL)    return false;
+    ConvertTask  task;
+    task.mSrc = src;    task.mW = lw;    task.mH = lh;    task.mSpp = spp;
+    task.mLUT = &lut;
+    task.mPixels = buffer + stride + 1;
+    task.mStride = stride;
+    ThreadPool::instance().parallelFor( (lh + ConvertTask::BandRows - 1) / ConvertTask::BandRows, task );
+
+    int  a, ow, oh;
+    DisplaySurface::span( 0, lw, f, &a, &ow );
+    DisplaySurface::span( 0, lh, f, &a, &oh );
+    bool  ok = out->resize( ow, oh );
+    if (ok)
+        out->drawScaled( buffer + stride + 1, stride, lw, lh, 0, 0, f,
+                         settings.bilinear, 0, 0, ow, oh );
+    BufferPool::instance().release( buffer );
+    return ok;
+}
+//---------------------------------------------------------------------------
+/// reads a native container from a file.
+class FileSource : public ImageContainer::Source {
+public:
+    FILE*  mFP;
+    FileSource ( FILE* fp ) : mFP( fp ) { }
+    virtual bool read ( void* const buff, const size_t n ) {
+        return n==0 || fread( buff, n, 1, mFP )==1;
+    }
+};
+//---------------------------------------------------------------------------
+/** \brief Read an image (.pbm, .pgm, .ppm, .pnm, or .ivc).  Free the samples
+ *  with BufferPool::instance().release.
+ *
+ *  pnm files are checked (a proper header and all of the samples; see
+ *  pnmHelper::check_pnm_file) before they're given to pnmHelper's
+ *  readers, which exit on errors.
+ *  \returns the samples (or NULL, with errMsg set).
+ */
+int* OffscreenRenderer::load ( const char* const fname, int* w, int* h,
+                               int* spp, int* min, int* max, char* errMsg,
+                               const int errMsgSize )
+{
+    assert( fname!=NULL && w!=NULL && h!=NULL && spp!=NULL && min!=NULL
+         && max!=NULL );
+    char  msg[512];
+    int*  data = NULL;
+    FILE*  fp = fopen( fname, "rb" );
+    if (fp==NULL) {
+        sprintf( msg, "can't open %.400s", fname );
+    } else if (ImageContainer::isContainerName( fname )) {
+        FileSource  in( fp );
+        ImageContainer::Header  header;
+        ImageStats::Snapshot    stats;
+        data = ImageContainer::read( in, &header, &stats );
+        fclose( fp );
+        if (data!=NULL) {
+            *w = header.width;    *h = header.height;
+            *spp = header.samplesPerPixel;
+            *min = header.min;    *max = header.max;
+        } else {
+            sprintf( msg, "%.400s isn't a valid .ivc file", fname );
+        }
+    } else if (ImageSaver::formatFromName( fname )==ImageSaver::FormatPNM
+            || ImageSaver::formatFromName( fname )==ImageSaver::FormatPBM) {
+        fclose( fp );
+        if (pnmHelper::check_pnm_file( fname, msg, sizeof msg )) {
+            data = pnmHelper::read_pnm_file( fname, w, h, spp, min, max );
+            if (data==NULL)    sprintf( msg, "can't read %.400s", fname );
+        }
+    } else {
+        fclose( fp );
+        sprintf( msg, "unsupported file type %.400s (use .pbm, .pgm, .ppm, .pnm, or .ivc)", fname );
+    }
+    if (data==NULL && errMsg!=NULL && errMsgSize>0) {
+        strncpy( errMsg, msg, errMsgSize-1 );
+        errMsg[errMsgSize-1] = 0;
+    }
+    return data;
+}
+//---------------------------------------------------------------------------
+/** \brief Read an image, render a preview (see previewZoom), and save it
+ *  (8 bit rgb; see ImageSaver for the formats).
+ *  \returns true if successful; false otherwise (with errMsg set).
+ */
+bool OffscreenRenderer::renderFile ( const char* const inName,
+                                     const char* const outName,
+                                     const Settings& settings, char* errMsg,
+                                     const int errMsgSize )
+{
+    int  w, h, spp, min, max;
+    int*  data = load( inName, &w, &h, &spp, &min, &max, errMsg, errMsgSize );
+    if (data==NULL)    return false;
+    DisplaySurface  preview;
+    bool  ok = render( data, w, h, spp, min, max, settings,
+                       previewZoom( w, h, settings.maxSize ), &preview );
+    BufferPool::instance().release( data );    data = NULL;
+    if (!ok) {
+        if (errMsg!=NULL && errMsgSize>0)
+            sprintf( errMsg, "%.*s", errMsgSize-1, "out of memory" );
+        return false;
+    }
+    //as rgb samples (0..255, so they're written as is)
+    const int  pw = preview.getWidth(), ph = preview.getHeight();
+    const size_t  n = (size_t)pw * ph;
+    int*  rgb = (int*)BufferPool::instance().allocate( n * 3 * sizeof(int) );
+    if (rgb==NULL)    return false;
+    const unsigned int*  p = preview.getPixels();
+    for (size_t i=0; i<n; i++) {
+        rgb[3*i]   = (int)((p[i] >> 16) & 0xff);
+        rgb[3*i+1] = (int)((p[i] >> 8) & 0xff);
+        rgb[3*i+2] = (int)(p[i] & 0xff);
+    }
+    ok = ImageSaver::save( rgb, pw, ph, 3, 0, 255, outName, NULL, errMsg,
+                           errMsgSize );
+    BufferPool::instance().release( rgb );
+    return ok;
+}
+//---------------------------------------------------------------------------
+/// renders some of a batch of files.
+class BatchTask : public ThreadPool::RangeTask {
+public:
+    const std::vector<std::string>*  mIn;
+    const std::vector<std::string>*  mOut;
+    const OffscreenRenderer::Settings*  mSettings;
+    std::vector<std::string>*  mErrors;
+    volatile long  mSucceeded;
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        for (int i=begin; i<end; i++) {
+            char  msg[512];
+            msg[0] = 0;
+            if (OffscreenRenderer::renderFile( (*mIn)[i].c_str(), (*mOut)[i].c_str(),
+                                               *mSettings, msg, sizeof msg ))
+                atomicAdd( &mSucceeded, 1 );
+            else if (mErrors!=NULL)
+                (*mErrors)[i] = msg;
+        }
+    }
+};
+//---------------------------------------------------------------------------
+/** \brief Render previews of a batch of files in parallel (see renderFile).
+ *  \param inNames input files
+ *  \param outNames output files (one per input)
+ *  \param settings display settings (for all of them)
+ *  \param errors if not NULL, receives a message per file (empty if it
+ *         succeeded)
+ *  \returns the number of previews written.
+ */
+int OffscreenRenderer::renderFiles ( const std::vector<std::string>& inNames,
+                                     const std::vector<std::string>& outNames,
+                                     const Settings& settings,
+                                     std::vector<std::string>* errors )
+{
+    assert( inNames.size()==outNames.size() );
+    if (errors!=NULL) {
+        errors->clear();
+        errors->resize( inNames.size() );
+    }
+    BatchTask  task;
+    task.mIn = &inNames;    task.mOut = &outNames;
+    task.mSettings = &settings;
+    task.mErrors = errors;
+    task.mSucceeded = 0;
+    //one file per worker at a time (each one's loops run in parallel too)
+    ThreadPool::instance().parallelFor( (int)inNames.size(), task, 1 );
+    return (int)task.mSucceeded;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,75 @@
+/**
+    \file OffscreenRenderer.h
+    Definition of the OffscreenRenderer class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef OffscreenRenderer_h
+#define OffscreenRenderer_h
+
+#include  <string>
+#include  <vector>
+#include  "DisplayLUT.h"
+#include  "DisplaySurface.h"
+//----------------------------------------------------------------------
+/** \brief Renders images (e.g., previews or thumbnails) without a window.
+ *
+ *  The display path of a view is used as is: the same pyramid level for
+ *  the zoom (see FrameRenderer::displayLevel), the same conversion (see
+ *  TileRenderer::convert; the lut's range is each image's, as in a view),
+ *  and the same scaling (DisplaySurface::drawScaled), so a preview is
+ *  pixel for pixel what a view shows at that zoom (fit to its window).
+ *
+ *  Batches of files are rendered in parallel (one file per worker).
+ */
+class OffscreenRenderer {
+public:
+    /// how images are shown (as set interactively in a view).
+    struct Settings {
+        DisplayLUT  lut;       ///< mode, gamma, colormap, and window
+        bool        bilinear;  ///< filter (otherwise, nearest)
+        int         maxSize;   ///< longest side of a preview (in pixels)
+        Settings ( ) : bilinear( true ), maxSize( 256 ) { }
+    };
+
+    static double previewZoom ( const int w, const int h, const int maxSize );
+    static bool   render ( const int* const data, const int w, const int h,
+                           const int spp, const int min, const int max,
+                           const Settings& settings, double zoom,
+                           DisplaySurface* out );
+    static int*   load ( const char* const fname, int* w, int* h, int* spp,
+                         int* min, int* max, char* errMsg,
+                         const int errMsgSize );
+    static bool   renderFile ( const char* const inName,
+                               const char* const outName,
+                               const Settings& settings, char* errMsg,
+                               const int errMsgSize );
+    static int    renderFiles ( const std::vector<std::string>& inNames,
+                                const std::vector<std::string>& outNames,
+                                const Settings& settings,
+                                std::vector<std::string>* errors );
+};
+
+#endif
+//----------------------------------------------------------------------
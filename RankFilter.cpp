@@ -0,0 +1,209 @@
+/**
+    \file RankFilter.cpp
+    Implementation of the RankFilter class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <limits.h>
+#include  <string.h>
+#include  <vector>
+#include  "RankFilter.h"
+#include  "Simd.h"
+#include  "ThreadPool.h"
+
+typedef unsigned short  Count;
+
+/// column histograms per stripe are kept to about this many bytes.
+static const size_t  StripeBytes = 4 << 20;
+//---------------------------------------------------------------------------
+/// \returns i clamped to 0..n-1.
+static inline int clamp ( const int i, const int n ) {
+    return (i<0) ? 0 : (i>=n ? n-1 : i);
+}
+//---------------------------------------------------------------------------
+/// d[i] += a[i] - s[i] for n counts (wrapping, as the results are counts).
+static inline void slide ( Count* d, const Count* a, const Count* s,
+                           const int n )
+{
+    int  i = 0;
+#ifdef USE_SSE2
+    for ( ; i+8<=n; i+=8) {
+        __m128i  v = _mm_loadu_si128( (const __m128i*)(d+i) );
+        v = _mm_add_epi16( v, _mm_loadu_si128( (const __m128i*)(a+i) ) );
+        v = _mm_sub_epi16( v, _mm_loadu_si128( (const __m128i*)(s+i) ) );
+        _mm_storeu_si128( (__m128i*)(d+i), v );
+    }
+#endif
+    for ( ; i<n; i++)    d[i] = (Count)(d[i] + a[i] - s[i]);
+}
+//---------------------------------------------------------------------------
+/// d[i] += a[i] for n counts.
+static inline void accumulate ( Count* d, const Count* a, const int n ) {
+    int  i = 0;
+#ifdef USE_SSE2
+    for ( ; i+8<=n; i+=8)
+        _mm_storeu_si128( (__m128i*)(d+i),
+                          _mm_add_epi16( _mm_loadu_si128( (const __m128i*)(d+i) ),
+                                         _mm_loadu_si128( (const __m128i*)(a+i) ) ) );
+#endif
+    for ( ; i<n; i++)    d[i] = (Count)(d[i] + a[i]);
+}
+//===========================================================================
+/// filter stripes [begin,end).
+class StripePass : public ThreadPool::RangeTask {
+public:
+    const int*  mSrc;
+    int*        mDst;
+    int         mW, mH, mR, mRank;
+    int         mMin;           ///< value of bin 0
+    int         mShift;         ///< fine bins per coarse bin is 1<<mShift
+    int         mCoarse;        ///< coarse bins
+    int         mStripe;        ///< columns per stripe
+
+    virtual void run ( const int begin, const int end, const int worker ) {
+        const int  F = 1 << mShift;
+        const int  L = mCoarse * F;  //fine bins
+        const int  cols = mStripe + 2*mR;
+        std::vector<Count>  colFine( (size_t)cols * L ), colCoarse( (size_t)cols * mCoarse );
+        std::vector<Count>  fine( L ), coarse( mCoarse );
+        std::vector<int>    last( mCoarse );  //x where a coarse bin's fine bins are current
+        for (int s=begin; s<end; s++) {
+            const int  x0 = s * mStripe;
+            const int  x1 = (x0 + mStripe < mW) ? x0 + mStripe : mW;
+            const int  cl = (x0 - mR > 0) ? x0 - mR : 0;
+            const int  cr = (x1 - 1 + mR < mW) ? x1 - 1 + mR : mW - 1;
+            //column histograms of rows -r..r
+            memset( &colFine[0], 0, colFine.size() * sizeof(Count) );
+            memset( &colCoarse[0], 0, colCoarse.size() * sizeof(Count) );
+            for (int j=-mR; j<=mR; j++) {
+                const int*  row = mSrc + (size_t)clamp( j, mH ) * mW;
+                for (int c=cl; c<=cr; c++)    add( &colFine[0], &colCoarse[0], c - cl, row[c], 1, L );
+            }
+            for (int y=0; y<mH; y++) {
+                const int  out = clamp( y - mR - 1, mH ), in = clamp( y + mR, mH );
+                if (y>0 && out!=in) {
+                    const int*  ro = mSrc + (size_t)out * mW;
+                    const int*  ri = mSrc + (size_t)in * mW;
+                    for (int c=cl; c<=cr; c++) {
+                        add( &colFine[0], &colCoarse[0], c - cl, ro[c], -1, L );
+                        add( &colFine[0], &colCoarse[0], c - cl, ri[c], 1, L );
+                    }
+                }
+                //the window's coarse histogram at x0 (fine bins on demand)
+                memset( &coarse[0], 0, mCoarse * sizeof(Count) );
+                for (int c=x0-mR; c<=x0+mR; c++)
+                    accumulate( &coarse[0], &colCoarse[ (size_t)column( c, cl ) * mCoarse ], mCoarse );
+                for (int b=0; b<mCoarse; b++)    last[b] = INT_MIN;
+                int*  d = mDst + (size_t)y * mW;
+                for (int x=x0; x<x1; x++) {
+                    if (x>x0)
+                        slide( &coarse[0],
+                               &colCoarse[ (size_t)column( x+mR, cl ) * mCoarse ],
+                               &colCoarse[ (size_t)column( x-mR-1, cl ) * mCoarse ],
+                               mCoarse );
+                    //find the coarse bin holding the rank, ...
+                    int  b = 0, below = 0;
+                    while (below + coarse[b] <= mRank)    below += coarse[b++];
+                    //... bring its fine bins up to date, ...
+                    Count*  f = &fine[ (size_t)b * F ];
+                    const size_t  off = (size_t)b * F;
+                    if (last[b]!=INT_MIN && 2*(x - last[b]) < 2*mR + 1) {
+                        for (int t=last[b]+1; t<=x; t++)
+                            slide( f, &colFine[ (size_t)column( t+mR, cl ) * L + off ],
+                                   &colFine[ (size_t)column( t-mR-1, cl ) * L + off ], F );
+                    } else {
+                        memset( f, 0, F * sizeof(Count) );
+                        for (int c=x-mR; c<=x+mR; c++)
+                            accumulate( f, &colFine[ (size_t)column( c, cl ) * L + off ], F );
+                    }
+                    last[b] = x;
+                    //... and find the fine bin
+                    int  i = 0;
+                    while (below + f[i] <= mRank)    below += f[i++];
+                    d[x] = mMin + (int)off + i;
+                }
+            }
+        }
+    }
+
+    /// histogram index of (clamped) image column c.
+    inline int column ( const int c, const int cl ) const {
+        return clamp( c, mW ) - cl;
+    }
+
+    /// count value v in (or remove it from) column histogram c.
+    inline void add ( Count* colFine, Count* colCoarse, const int c,
+                      const int v, const int n, const int L ) const
+    {
+        const int  bin = v - mMin;
+        colFine[ (size_t)c * L + bin ] += (Count)n;
+        colCoarse[ (size_t)c * mCoarse + (bin >> mShift) ] += (Count)n;
+    }
+};
+//===========================================================================
+/** \brief Replace each pixel by a percentile (e.g., the median) of the
+ *  (2*radius+1) x (2*radius+1) square centered on it.
+ *  \param src w*h gray pixels
+ *  \param w image width
+ *  \param h image height
+ *  \param dst receives w*h pixels
+ *  \param radius half the size of the square (at most MaxRadius)
+ *  \param percentile 0 (min) .. 0.5 (median) .. 1 (max)
+ *  \returns false if src spans more than 65536 values.
+ */
+bool RankFilter::filter ( const int* const src, const int w, const int h,
+                          int* const dst, const int radius,
+                          const double percentile )
+{
+    assert( src!=NULL && dst!=NULL && src!=dst && w>0 && h>0 );
+    assert( radius>=0 && radius<=MaxRadius );
+    assert( percentile>=0 && percentile<=1 );
+    int  lo = src[0], hi = src[0];
+    const size_t  n = (size_t)w * h;
+    for (size_t i=1; i<n; i++) {
+        if (src[i]<lo)    lo = src[i];
+        if (src[i]>hi)    hi = src[i];
+    }
+    if ((long long)hi - lo >= 65536)    return false;
+    int  bits = 0;
+    while ((1 << bits) <= hi - lo)    bits++;
+
+    StripePass  p;
+    p.mSrc = src;    p.mDst = dst;    p.mW = w;    p.mH = h;    p.mR = radius;
+    const int  count = (2*radius + 1) * (2*radius + 1);
+    p.mRank = (int)(percentile * (count - 1) + 0.5);
+    p.mMin = lo;
+    p.mShift = (bits + 1) / 2;
+    p.mCoarse = 1 << (bits - p.mShift);
+    //stripes as wide as the memory for their column histograms allows
+    const size_t  perColumn = ((size_t)p.mCoarse << p.mShift) * sizeof(Count);
+    int  stripe = (int)(StripeBytes / perColumn) - 2*radius;
+    if (stripe < 2*radius + 1)    stripe = 2*radius + 1;
+    if (stripe > w)               stripe = w;
+    p.mStripe = stripe;
+    ThreadPool::instance().parallelFor( (w + stripe - 1) / stripe, p, 1 );
+    return true;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,58 @@
+/**
+    \file RankFilter.h
+    Definition of the RankFilter class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef RankFilter_h
+#define RankFilter_h
+
+//----------------------------------------------------------------------
+/** \brief Median (and other percentile) filters of gray images with
+ *  square windows, at a cost per pixel that doesn't depend on the size
+ *  of the window (Perreault and Hebert).
+ *
+ *  A histogram is kept for each column of the window's height and the
+ *  window's histogram slides along a row by adding the column entering
+ *  it and removing the one leaving it; moving down a row updates each
+ *  column's histogram by a pixel.  Histograms are two tiered: a coarse
+ *  one (the high bits of the value) is kept up to date, and the fine bins
+ *  under a coarse bin are only brought up to date when the rank falls in
+ *  that bin.  With n bits of range, both tiers have about 2^(n/2) bins,
+ *  so 12 and 16 bit images need only 64 or 256 bins of work per pixel.
+ *
+ *  Vertical stripes of the image are filtered in parallel.  Pixels
+ *  outside the image repeat the edge of the image.  dst may not be src.
+ */
+class RankFilter {
+public:
+    /// largest window radius (window counts fit in 16 bits).
+    enum { MaxRadius = 127 };
+
+    static bool filter ( const int* const src, const int w, const int h,
+                         int* const dst, const int radius,
+                         const double percentile );
+};
+
+#endif
@@ -0,0 +1,115 @@
+/**
+    \file RenderPreviews.cpp
+    Command line program that renders previews of images (without a
+    window, so it also builds and runs without MFC; see Makefile).
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <limits.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <string>
+#include  <vector>
+#include  "BufferPool.h"
+#include  "DistanceTransform.h"
+#include  "OffscreenRenderer.h"
+#include  "pnmHelper.h"
+//----------------------------------------------------------------------
+static void usage ( void ) {
+    fprintf( stderr,
+        "usage: RenderPreviews [options] input output [input output ...]\n"
+        "       RenderPreviews -benchmark w h\n"
+        "  renders a preview of each input image (.pbm, .pgm, .ppm, .pnm,\n"
+        "  or .ivc) as a view shows it, and saves it to output (.ppm, .pnm,\n"
+        "  .tif, or .tiff).  -benchmark instead times the distance transform\n"
+        "  of a w x h image with 1, 2, ... threads.\n"
+        "options:\n"
+        "  -size n          longest side of a preview (default 256)\n"
+        "  -nearest         nearest neighbor (instead of bilinear) scaling\n"
+        "  -mode m          linear, gamma, log, or equalized\n"
+        "  -gamma g         exponent for -mode gamma\n"
+        "  -window c w      window center and width (default: image range)\n" );
+    exit( 1 );
+}
+//----------------------------------------------------------------------
+int main ( int argc, char* argv[] ) {
+    //samples read are released to the pool (see OffscreenRenderer::load)
+    pnmHelper::setAllocator( BufferPool::poolAllocate );
+
+    OffscreenRenderer::Settings  settings;
+    std::vector<std::string>  inNames, outNames;
+    if (argc==4 && strcmp(argv[1], "-benchmark")==0) {
+        const int  w = atoi( argv[2] ), h = atoi( argv[3] );
+        if (w<=0 || h<=0)    usage();
+        if (DistanceTransform::benchmark( w, h, 3, stdout, NULL ))    return 0;
+        fprintf( stderr, "out of memory\n" );
+        return 1;
+    }
+
+    int  i;
+    for (i=1; i<argc && argv[i][0]=='-'; i++) {
+        const bool  more = (i+1 < argc);
+        if (strcmp(argv[i], "-size")==0 && more) {
+            settings.maxSize = atoi( argv[++i] );
+            if (settings.maxSize<=0)    usage();
+        } else if (strcmp(argv[i], "-nearest")==0) {
+            settings.bilinear = false;
+        } else if (strcmp(argv[i], "-mode")==0 && more) {
+            ++i;
+            int  m;
+            for (m=0; m<DisplayLUT::ModeCount; m++)
+                if (strcmp(argv[i], DisplayLUT::getModeName( m ))==0)    break;
+            if (m==DisplayLUT::ModeCount)    usage();
+            settings.lut.setMode( m );
+        } else if (strcmp(argv[i], "-gamma")==0 && more) {
+            const double  g = atof( argv[++i] );
+            if (g<=0)    usage();
+            settings.lut.setGamma( g );
+        } else if (strcmp(argv[i], "-window")==0 && i+2 < argc) {
+            const double  c = atof( argv[i+1] );
+            const double  w = atof( argv[i+2] );
+            i += 2;
+            if (w<=0)    usage();
+            settings.lut.setWindow( c, w );
+        } else {
+            usage();
+        }
+    }
+    if (i>=argc || (argc-i)%2!=0)    usage();
+    for ( ; i<argc; i+=2) {
+        inNames.push_back( argv[i] );
+        outNames.push_back( argv[i+1] );
+    }
+
+    std::vector<std::string>  errors;
+    const int  n = OffscreenRenderer::renderFiles( inNames, outNames,
+                                                   settings, &errors );
+    for (size_t f=0; f<errors.size(); f++)
+        if (!errors[f].empty())
+            fprintf( stderr, "%s: %s\n", inNames[f].c_str(), errors[f].c_str() );
+    printf( "%d of %d previews written\n", n, (int)inNames.size() );
+    return (n==(int)inNames.size()) ? 0 : 1;
+}
+//----------------------------------------------------------------------
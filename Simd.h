@@ -0,0 +1,43 @@
+/**
+    \file Simd.h
+    Selection of the vector instruction set.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef Simd_h
+#define Simd_h
+
+/** \def USE_SSE2
+ *  Defined (and the SSE2 intrinsics are included) if the compiler may
+ *  generate SSE2 instructions: always for x64, and for 32 bit x86 with
+ *  /arch:SSE2 (which ImageViewer.vcproj sets) or gcc's -msse2.  Code
+ *  under #ifdef USE_SSE2 also has a scalar version for other targets.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#  define  USE_SSE2
+#  include <emmintrin.h>
+#endif
+
+#endif
+//----------------------------------------------------------------------
@@ -26,10 +26,10 @@
     their proprietary programs.)
 */
 //----------------------------------------------------------------------
-#include "stdafx.h"
 #undef   NDEBUG
 #include <assert.h>
 #include <float.h>
+#include <new>
 #include <stdio.h>
 
 #include "TIFFWriter.h"
@@ -319,19 +319,21 @@ void TIFFWriter::write_tiff_data8_rgb ( const uint8* const buff,
     }
 }
 //----------------------------------------------------------------------
-void TIFFWriter::write_tiff_float_grey ( const float* const buff,
+bool TIFFWriter::write_tiff_float_grey ( const float* const buff,
     const int width, const int height, const char* const fname )
 {
-    float  max = 0;
-    int    i;
-    for (i=0; i<width*height; i++) {
+    const size_t  n = (size_t)width * height;
+    float   max = 0;
+    size_t  i;
+    for (i=0; i<n; i++) {
         if (buff[i]<FLT_MAX && buff[i]>max)  max=buff[i];
     }
 
     //printf( "TIFFWriter: max=%f \n", max );
 
-    uint8* u8buff = new unsigned char[height*width];
-    for (i=0; i<width*height; i++) {
+    uint8* u8buff = new (std::nothrow) unsigned char[n];
+    if (u8buff==NULL)    return false;
+    for (i=0; i<n; i++) {
         if (buff[i]<FLT_MAX) {
             double d = (double)buff[i] / max * 255 + 0.5;
             int tmp = (int)d;
@@ -344,11 +346,18 @@ void TIFFWriter::write_tiff_float_grey ( const float* const buff,
         u8buff[i] = 255-u8buff[i];  //invert
     }
 
-    FILE* fp = fopen(fname, "wb");  assert(fp!=NULL);
+    FILE* fp = fopen(fname, "wb");
+    if (fp==NULL) {
+        delete[] u8buff;
+        return false;
+    }
     TIFFWriter::write_tiff_data8_grey(u8buff, width, height, fp );
-    fclose(fp);  fp=NULL;
+    bool ok = (ferror(fp)==0);
+    if (fclose(fp)!=0)    ok = false;
+    fp=NULL;
 
-    delete u8buff;  u8buff=NULL;
+    delete[] u8buff;  u8buff=NULL;
+    return ok;
 }
 //----------------------------------------------------------------------
 void TIFFWriter::write_tiff_double_grey ( const double* const buff,
@@ -105,8 +105,9 @@ class TIFFWriter {
      *  \param width image width
      *  \param height image height
      *  \param fname output TIFF file name
+     *  \returns false if the file couldn't be created (or out of memory).
      */
-    static void write_tiff_float_grey ( const float* const buff,
+    static bool write_tiff_float_grey ( const float* const buff,
         const int width, const int height, const char* const fname );
 
     /** \brief Write a grey tiff image using double data as input.
@@ -0,0 +1,134 @@
+/**
+    \file TempFile.h
+    Header file for (definition and implementation of) TempFile class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef TempFile_h
+#define TempFile_h
+//----------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+
+#ifdef WIN32
+#  include <windows.h>
+#else
+#  include <stdlib.h>
+#  include <unistd.h>
+#endif
+//----------------------------------------------------------------------
+/** \brief Scratch file (in the system temp directory) used to spill data
+ *  that doesn't fit in memory.  The file is created on first use and
+ *  removed when the TempFile is destroyed.
+ *
+ *  Data is only ever appended; the returned 64-bit offsets are used to
+ *  read it back.
+ */
+class TempFile {
+  private:
+    FILE*      mFP;         ///< open scratch file (or NULL)
+    char       mName[512];  ///< scratch file name
+    long long  mEnd;        ///< current size of the file (in bytes)
+    const char*  mPrefix;   ///< file name prefix
+
+    bool create ( void ) {
+        #ifdef WIN32
+            char  dir[MAX_PATH];
+            if (GetTempPath( sizeof dir, dir )==0)    return false;
+            if (GetTempFileName( dir, mPrefix, 0, mName )==0)    return false;
+            mFP = fopen( mName, "w+bD" );  //D: delete when closed
+        #else
+            const char*  dir = getenv( "TMPDIR" );
+            if (dir==NULL || strlen(dir)==0)    dir = "/tmp";
+            sprintf( mName, "%.400s/%.16sXXXXXX", dir, mPrefix );
+            const int  fd = mkstemp( mName );
+            if (fd<0)    return false;
+            unlink( mName );  //goes away when closed
+            mFP = fdopen( fd, "w+b" );
+        #endif
+        mEnd = 0;
+        return mFP!=NULL;
+    }
+
+    bool seek ( const long long offset ) {
+        #ifdef WIN32
+            return _fseeki64( mFP, offset, SEEK_SET )==0;
+        #else
+            return fseeko( mFP, (off_t)offset, SEEK_SET )==0;
+        #endif
+    }
+
+  public:
+    /** \brief ctor.
+     *  \param prefix scratch file name prefix (e.g., "undo").
+     */
+    TempFile ( const char* const prefix="iv" ) {
+        mFP = NULL;
+        mName[0] = 0;
+        mEnd = 0;
+        mPrefix = prefix;
+    }
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    /** \brief dtor.  close (and thereby remove) the scratch file.
+     */
+    ~TempFile ( ) {  close();  }
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    /** \brief close and remove the scratch file (if any).
+     */
+    void close ( void ) {
+        if (mFP!=NULL) {  fclose( mFP );  mFP = NULL;  }
+        mEnd = 0;
+    }
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    /** \brief number of bytes currently in the scratch file.
+     */
+    inline long long size ( void ) const {  return mEnd;  }
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    /** \brief append n bytes to the scratch file.
+     *  \param buff   data to be written
+     *  \param n      number of bytes
+     *  \param offset (output) where the data was written
+     *  \returns true if successful.
+     */
+    bool append ( const void* const buff, const size_t n, long long* offset ) {
+        if (mFP==NULL && !create())    return false;
+        if (!seek(mEnd))    return false;
+        if (n>0 && fwrite( buff, n, 1, mFP )!=1)    return false;
+        *offset = mEnd;
+        mEnd += n;
+        return true;
+    }
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    /** \brief read n bytes previously written at offset.
+     *  \returns true if successful.
+     */
+    bool read ( const long long offset, void* const buff, const size_t n ) {
+        if (mFP==NULL || offset+(long long)n>mEnd)    return false;
+        if (!seek(offset))    return false;
+        return n==0 || fread( buff, n, 1, mFP )==1;
+    }
+};
+
+#endif
+//----------------------------------------------------------------------
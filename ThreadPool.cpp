@@ -0,0 +1,268 @@
+/**
+    \file ThreadPool.cpp
+    Implementation of the ThreadPool class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  "ThreadPool.h"
+
+#ifndef WIN32
+#  include <unistd.h>
+#endif
+//---------------------------------------------------------------------------
+/** \brief State shared by the participants of one parallel loop.  It is
+ *  reference counted since helpers may start after the loop has finished.
+ */
+struct ThreadPool::Loop {
+    RangeTask*     body;
+    int            n;          ///< number of iterations
+    int            chunk;      ///< iterations per grab
+    volatile long  next;       ///< next iteration to grab
+    volatile long  done;       ///< iterations completed
+    volatile long  workers;    ///< participants so far
+    volatile long  refs;       ///< reference count
+    Event          finished;   ///< set when done==n
+};
+//---------------------------------------------------------------------------
+/// Task that helps with a parallel loop.
+class ThreadPool::LoopTask : public ThreadPool::Task {
+    Loop*  mLoop;
+public:
+    LoopTask ( Loop* loop ) : mLoop( loop ) { }
+    virtual void run ( void ) {  ThreadPool::runLoop( mLoop );  }
+};
+//---------------------------------------------------------------------------
+/** \brief The one and only thread pool (created on first use).  One worker
+ *  per processor (but at least one).
+ */
+ThreadPool& ThreadPool::instance ( void ) {
+    static ThreadPool  pool( getProcessorCount() > 1
+                             ? getProcessorCount() - 1 : 1 );
+    return pool;
+}
+//---------------------------------------------------------------------------
+int ThreadPool::getProcessorCount ( void ) {
+    #ifdef WIN32
+        SYSTEM_INFO  si;
+        GetSystemInfo( &si );
+        return si.dwNumberOfProcessors > 0 ? (int)si.dwNumberOfProcessors : 1;
+    #else
+        const long  n = sysconf( _SC_NPROCESSORS_ONLN );
+        return n > 0 ? (int)n : 1;
+    #endif
+}
+//---------------------------------------------------------------------------
+ThreadPool::ThreadPool ( const int workers ) {
+    mShutdown = false;
+    #ifdef WIN32
+        mAvailable = CreateSemaphore( NULL, 0, LONG_MAX, NULL );
+        for (int i=0; i<workers; i++) {
+            HANDLE  h = CreateThread( NULL, 0, threadMain, this, 0, NULL );
+            if (h!=NULL)    mThreads.push_back( h );
+        }
+    #else
+        pthread_cond_init( &mAvailable, NULL );
+        for (int i=0; i<workers; i++) {
+            pthread_t  t;
+            if (pthread_create( &t, NULL, threadMain, this )==0)
+                mThreads.push_back( t );
+        }
+    #endif
+}
+//---------------------------------------------------------------------------
+ThreadPool::~ThreadPool ( ) {
+    {
+        Lock  l( mMutex );
+        mShutdown = true;
+    }
+    #ifdef WIN32
+        ReleaseSemaphore( mAvailable, (LONG)mThreads.size(), NULL );
+        for (size_t i=0; i<mThreads.size(); i++) {
+            WaitForSingleObject( mThreads[i], INFINITE );
+            CloseHandle( mThreads[i] );
+        }
+        CloseHandle( mAvailable );
+    #else
+        mMutex.lock();
+        pthread_cond_broadcast( &mAvailable );
+        mMutex.unlock();
+        for (size_t i=0; i<mThreads.size(); i++)
+            pthread_join( mThreads[i], NULL );
+        pthread_cond_destroy( &mAvailable );
+    #endif
+    for (size_t i=0; i<mQueue.size(); i++)    delete mQueue[i];
+}
+//---------------------------------------------------------------------------
+#ifdef WIN32
+DWORD WINAPI ThreadPool::threadMain ( LPVOID arg ) {
+    ((ThreadPool*)arg)->workerLoop();
+    return 0;
+}
+#else
+void* ThreadPool::threadMain ( void* arg ) {
+    ((ThreadPool*)arg)->workerLoop();
+    return NULL;
+}
+#endif
+//---------------------------------------------------------------------------
+/// runs (and deletes) a task on a thread of its own (see runOnThread).
+#ifdef WIN32
+DWORD WINAPI ThreadPool::taskMain ( LPVOID arg ) {
+    Task*  t = (Task*)arg;
+    t->run();
+    delete t;
+    return 0;
+}
+#else
+void* ThreadPool::taskMain ( void* arg ) {
+    Task*  t = (Task*)arg;
+    t->run();
+    delete t;
+    return NULL;
+}
+#endif
+//---------------------------------------------------------------------------
+/** \brief Run (and then delete) a task on a new thread of its own rather
+ *  than on a worker, e.g., long background work (such as saving) that
+ *  would otherwise keep a worker from parallel loops and tiles.
+ *  \returns false if the thread couldn't be created (t isn't deleted).
+ */
+bool ThreadPool::runOnThread ( Task* t ) {
+    assert( t!=NULL );
+    #ifdef WIN32
+        HANDLE  h = CreateThread( NULL, 0, taskMain, t, 0, NULL );
+        if (h==NULL)    return false;
+        CloseHandle( h );
+    #else
+        pthread_t  thread;
+        if (pthread_create( &thread, NULL, taskMain, t )!=0)    return false;
+        pthread_detach( thread );
+    #endif
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Worker thread main loop: run queued tasks until shutdown.
+ */
+void ThreadPool::workerLoop ( void ) {
+    for ( ; ; ) {
+        Task*  t = NULL;
+        #ifdef WIN32
+            WaitForSingleObject( mAvailable, INFINITE );
+            {
+                Lock  l( mMutex );
+                if (mShutdown)    return;
+                if (mQueue.empty())    continue;
+                t = mQueue.front();
+                mQueue.pop_front();
+            }
+        #else
+            {
+                Lock  l( mMutex );
+                while (!mShutdown && mQueue.empty())
+                    pthread_cond_wait( &mAvailable, &mMutex.mMutex );
+                if (mShutdown)    return;
+                t = mQueue.front();
+                mQueue.pop_front();
+            }
+        #endif
+        t->run();
+        delete t;
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Queue a task to be run (and then deleted) by a worker.
+ *  \param t      task to run
+ *  \param urgent if true, run before any already queued tasks
+ */
+void ThreadPool::submit ( Task* t, const bool urgent ) {
+    assert( t!=NULL );
+    {
+        Lock  l( mMutex );
+        if (urgent)    mQueue.push_front( t );
+        else           mQueue.push_back( t );
+        #ifndef WIN32
+            pthread_cond_signal( &mAvailable );
+        #endif
+    }
+    #ifdef WIN32
+        ReleaseSemaphore( mAvailable, 1, NULL );
+    #endif
+}
+//---------------------------------------------------------------------------
+/** \brief Grab and run chunks of a parallel loop until none remain.
+ */
+void ThreadPool::runLoop ( Loop* loop ) {
+    const int  worker = (int)atomicAdd( &loop->workers, 1 ) - 1;
+    for ( ; ; ) {
+        const int  begin = (int)atomicAdd( &loop->next, loop->chunk )
+                           - loop->chunk;
+        if (begin >= loop->n)    break;
+        const int  end = (begin + loop->chunk < loop->n)
+                         ? begin + loop->chunk : loop->n;
+        loop->body->run( begin, end, worker );
+        if (atomicAdd( &loop->done, end-begin ) == loop->n)
+            loop->finished.set();
+    }
+    if (atomicAdd( &loop->refs, -1 ) == 0)    delete loop;
+}
+//---------------------------------------------------------------------------
+/** \brief Run body over iterations [0,n) using all threads, and wait for
+ *  them to finish.
+ *  \param n     number of iterations
+ *  \param body  loop body
+ *  \param grain minimum number of iterations per chunk
+ *  \param maxThreads use at most this many threads (0 for all); only this
+ *  loop is affected (e.g., to measure how an operation scales)
+ */
+void ThreadPool::parallelFor ( const int n, RangeTask& body, const int grain,
+                               const int maxThreads )
+{
+    if (n<=0)    return;
+    int  threads = getThreadCount();
+    if (maxThreads > 0 && maxThreads < threads)    threads = maxThreads;
+    //a few chunks per thread for load balancing
+    int  chunk = n / (threads * 4);
+    if (chunk < grain)    chunk = grain;
+    if (chunk < 1)        chunk = 1;
+    const int  chunks  = (n + chunk - 1) / chunk;
+    if (threads==1 || chunks==1) {
+        body.run( 0, n, 0 );
+        return;
+    }
+    const int  helpers = (chunks-1 < threads-1) ? chunks-1 : threads-1;
+    Loop*  loop = new Loop;
+    loop->body    = &body;
+    loop->n       = n;
+    loop->chunk   = chunk;
+    loop->next    = 0;
+    loop->done    = 0;
+    loop->workers = 0;
+    loop->refs    = helpers + 2;  //helpers, the caller, and the wait below
+    for (int i=0; i<helpers; i++)    submit( new LoopTask(loop), true );
+    runLoop( loop );
+    loop->finished.wait();
+    if (atomicAdd( &loop->refs, -1 ) == 0)    delete loop;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,206 @@
+/**
+    \file ThreadPool.h
+    Definition of the ThreadPool class (and simple synchronization helpers).
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef ThreadPool_h
+#define ThreadPool_h
+//----------------------------------------------------------------------
+#include <deque>
+#include <vector>
+
+#ifdef WIN32
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#endif
+//----------------------------------------------------------------------
+/// Mutual exclusion lock (critical section).
+class Mutex {
+  private:
+    #ifdef WIN32
+        CRITICAL_SECTION  mCS;
+    #else
+        pthread_mutex_t   mMutex;
+    #endif
+    Mutex ( const Mutex& );              //not copyable
+    Mutex& operator= ( const Mutex& );
+    friend class Event;
+    friend class ThreadPool;
+  public:
+    #ifdef WIN32
+        Mutex  ( ) {  InitializeCriticalSection( &mCS );  }
+        ~Mutex ( ) {  DeleteCriticalSection( &mCS );  }
+        inline void lock   ( void ) {  EnterCriticalSection( &mCS );  }
+        inline void unlock ( void ) {  LeaveCriticalSection( &mCS );  }
+    #else
+        Mutex  ( ) {  pthread_mutex_init( &mMutex, NULL );  }
+        ~Mutex ( ) {  pthread_mutex_destroy( &mMutex );  }
+        inline void lock   ( void ) {  pthread_mutex_lock( &mMutex );  }
+        inline void unlock ( void ) {  pthread_mutex_unlock( &mMutex );  }
+    #endif
+};
+//----------------------------------------------------------------------
+/// Scoped lock of a Mutex.
+class Lock {
+  private:
+    Mutex&  mMutex;
+    Lock ( const Lock& );
+    Lock& operator= ( const Lock& );
+  public:
+    Lock  ( Mutex& m ) : mMutex( m ) {  mMutex.lock();  }
+    ~Lock ( ) {  mMutex.unlock();  }
+};
+//----------------------------------------------------------------------
+/// Manual reset event (a flag that threads can wait for).
+class Event {
+  private:
+    #ifdef WIN32
+        HANDLE          mEvent;
+    #else
+        Mutex           mMutex;
+        pthread_cond_t  mCond;
+        bool            mSet;
+    #endif
+    Event ( const Event& );
+    Event& operator= ( const Event& );
+  public:
+    #ifdef WIN32
+        Event  ( ) {  mEvent = CreateEvent( NULL, TRUE, FALSE, NULL );  }
+        ~Event ( ) {  CloseHandle( mEvent );  }
+        inline void set   ( void ) {  SetEvent( mEvent );  }
+        inline void reset ( void ) {  ResetEvent( mEvent );  }
+        inline void wait  ( void ) {  WaitForSingleObject( mEvent, INFINITE );  }
+    #else
+        Event  ( ) {  mSet = false;  pthread_cond_init( &mCond, NULL );  }
+        ~Event ( ) {  pthread_cond_destroy( &mCond );  }
+        inline void set ( void ) {
+            Lock  l( mMutex );
+            mSet = true;
+            pthread_cond_broadcast( &mCond );
+        }
+        inline void reset ( void ) {  Lock l( mMutex );  mSet = false;  }
+        inline void wait ( void ) {
+            Lock  l( mMutex );
+            while (!mSet)    pthread_cond_wait( &mCond, &mMutex.mMutex );
+        }
+    #endif
+};
+//----------------------------------------------------------------------
+/// Atomically add v to *p.  \returns the new value.
+inline long atomicAdd ( volatile long* p, const long v ) {
+    #ifdef WIN32
+        return InterlockedExchangeAdd( p, v ) + v;
+    #else
+        return __sync_add_and_fetch( p, v );
+    #endif
+}
+//----------------------------------------------------------------------
+/// Atomically replace *p with v (a full barrier).  \returns the old value.
+inline long atomicExchange ( volatile long* p, const long v ) {
+    #ifdef WIN32
+        return InterlockedExchange( p, v );
+    #else
+        long  old = *p;
+        for ( ; ; ) {
+            const long  seen = __sync_val_compare_and_swap( p, old, v );
+            if (seen==old)    return old;
+            old = seen;
+        }
+    #endif
+}
+//----------------------------------------------------------------------
+/** \brief Pool of worker threads shared by the whole application.
+ *
+ *  Work is either submitted as independent tasks (run in FIFO order, with
+ *  urgent tasks jumping the queue) or as a parallel loop that blocks the
+ *  caller until all iterations are done.  The caller participates in its
+ *  own parallel loops, so they may safely be issued from a worker.
+ */
+class ThreadPool {
+public:
+    /// An independent unit of work.  The pool deletes it after it runs.
+    class Task {
+    public:
+        virtual ~Task ( ) { }
+        virtual void run ( void ) = 0;
+    };
+
+    /// Body of a parallel loop.
+    class RangeTask {
+    public:
+        virtual ~RangeTask ( ) { }
+        /** \brief process iterations [begin,end).
+         *  \param worker index of the participating thread, in
+         *  [0,getThreadCount()), so that per-thread results may be kept.
+         */
+        virtual void run ( const int begin, const int end,
+                           const int worker ) = 0;
+    };
+
+    static ThreadPool& instance ( void );
+
+    /// \returns the number of threads that may run a parallel loop.
+    inline int getThreadCount ( void ) const {
+        return (int)mThreads.size() + 1;
+    }
+
+    void submit ( Task* t, const bool urgent=false );
+    void parallelFor ( const int n, RangeTask& body, const int grain=1,
+                       const int maxThreads=0 );
+    static int getProcessorCount ( void );
+    static bool runOnThread ( Task* t );
+
+protected:
+    ThreadPool ( const int workers );
+    ~ThreadPool ( );
+
+    struct Loop;
+    class  LoopTask;
+
+    #ifdef WIN32
+        std::vector<HANDLE>     mThreads;
+        static DWORD WINAPI     threadMain ( LPVOID arg );
+        static DWORD WINAPI     taskMain ( LPVOID arg );
+    #else
+        std::vector<pthread_t>  mThreads;
+        static void*            threadMain ( void* arg );
+        static void*            taskMain ( void* arg );
+    #endif
+    std::deque<Task*>  mQueue;     ///< pending tasks
+    Mutex              mMutex;     ///< protects mQueue
+    #ifdef WIN32
+        HANDLE         mAvailable; ///< semaphore counting queued tasks
+    #else
+        pthread_cond_t mAvailable; ///< signaled when a task is queued
+    #endif
+    bool               mShutdown;  ///< tells workers to exit
+
+    void workerLoop ( void );
+    static void runLoop ( Loop* loop );
+};
+
+#endif
+//----------------------------------------------------------------------
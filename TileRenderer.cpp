@@ -0,0 +1,279 @@
+/**
+    \file TileRenderer.cpp
+    Implementation of the TileRenderer class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <algorithm>
+#include  "TileRenderer.h"
+//---------------------------------------------------------------------------
+/** \brief One set of tiles to be converted (shared by the workers).  It
+ *  is reference counted since queued workers may only start (and then
+ *  exit at once) after it has been cancelled.
+ */
+struct TileRenderer::Batch {
+    const int*     src;
+    int            w, h, spp;
+    const BitImage*  bits;       ///< src packed (binary images; or NULL)
+    DisplayLUT     lut;          ///< private copy (the caller's may change)
+    std::vector<Tile*>  tiles;   ///< most important first
+    volatile long  next;         ///< next position in tiles to claim
+    volatile long  converted;    ///< tiles converted so far
+    volatile long  finished;     ///< all tiles are converted
+    volatile long  refs;         ///< reference count (the renderer and the workers)
+    Mutex          mutex;        ///< protects the members below (cancelled is also polled)
+    volatile long  cancelled;    ///< stop claiming tiles (workers not yet started don't start)
+    int            running;      ///< workers that have started and not yet finished
+    Event          idle;         ///< set when cancelled and no worker is running
+    TileRenderer::Listener*  listener;
+
+    /// drop a reference (deleting the batch with the last one).
+    inline void release ( void ) {
+        if (atomicAdd( &refs, -1 ) == 0)    delete this;
+    }
+
+    void convert ( Tile* t );
+};
+//---------------------------------------------------------------------------
+/** \brief Claims and converts tiles until none remain.  Only workers that
+ *  have started are waited for (see cancel), so a batch is never held up
+ *  by workers queued behind other (long) tasks.
+ */
+class TileRenderer::Worker : public ThreadPool::Task {
+public:
+    Batch*  mBatch;
+    Worker ( Batch* b ) : mBatch( b ) { }
+    ~Worker ( ) {  mBatch->release();  }
+    virtual void run ( void ) {
+        Batch*  b = mBatch;
+        {
+            Lock  l( b->mutex );
+            if (b->cancelled)    return;
+            ++b->running;
+        }
+        const long  n = (long)b->tiles.size();
+        for ( ; ; ) {
+            if (b->cancelled)    break;
+            const long  i = atomicAdd( &b->next, 1 ) - 1;
+            if (i>=n)    break;
+            Tile*  t = b->tiles[i];
+            const int  level = t->level, tx = t->tx, ty = t->ty;
+            b->convert( t );
+            t->converted = b->lut.getVersion();
+            //(a barrier: the render thread may show (or discard) the
+            // tile from here on)
+            atomicExchange( &t->state, DisplayCache::Converted );
+            if (b->listener!=NULL && !b->cancelled)
+                b->listener->tileReady( level, tx, ty );
+            if (atomicAdd( &b->converted, 1 ) == n) {
+                b->finished = 1;
+                if (!b->cancelled && b->listener!=NULL)
+                    b->listener->renderFinished();
+            }
+        }
+        Lock  l( b->mutex );
+        //(the tiles and the listener may be gone once cancel returns)
+        if (--b->running==0 && b->cancelled)    b->idle.set();
+    }
+};
+//---------------------------------------------------------------------------
+void TileRenderer::Batch::convert ( Tile* t ) {
+    if (bits!=NULL)
+        TileRenderer::convert( *bits, lut, t->x0, t->y0, t->w, t->h,
+                               t->target, t->stride );
+    else
+        TileRenderer::convert( src, w, h, spp, lut, t->x0, t->y0, t->w, t->h,
+                               t->target, t->stride );
+}
+//===========================================================================
+/** \brief Convert a rect of a level to displayable pixels, including a 1
+ *  pixel apron (rows and columns -1..tw/th, which repeat the edge of the
+ *  level), exactly as the tiles of a view are.
+ *  \param src samples of the level (gray, or interleaved rgb)
+ *  \param w level width
+ *  \param h level height
+ *  \param spp samples per pixel (1 or 3)
+ *  \param lut maps gray values to display pixels
+ *  \param x0 left of the rect (level coordinates)
+ *  \param y0 top of the rect
+ *  \param tw rect width
+ *  \param th rect height
+ *  \param pixels receives the pixel for (x0,y0); the apron is around it
+ *  \param stride row length of pixels (at least tw+2)
+ */
+void TileRenderer::convert ( const int* const src, const int w, const int h,
+                             const int spp, const DisplayLUT& lut,
+                             const int x0, const int y0, const int tw,
+                             const int th, unsigned int* const pixels,
+                             const int stride )
+{
+    const int  xl = (x0 > 0) ? x0 - 1 : 0;
+    const int  xr = (x0 + tw < w) ? x0 + tw : w - 1;
+    for (int y=-1; y<=th; y++) {
+        int  sy = y0 + y;
+        sy = (sy<0) ? 0 : (sy>=h ? h-1 : sy);
+        const int*     s = src + (size_t)sy * w * spp;
+        unsigned int*  d = pixels + y * stride;
+        if (spp==1) {
+            lut.mapGray( s + x0, d, tw );
+            d[-1] = lut.lookup( s[xl] );
+            d[tw] = lut.lookup( s[xr] );
+        } else {
+            lut.mapRGB( s + (size_t)x0 * 3, d, tw );
+            lut.mapRGB( s + (size_t)xl * 3, d - 1, 1 );
+            lut.mapRGB( s + (size_t)xr * 3, d + tw, 1 );
+        }
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Convert a rect of a packed binary image (and its apron, as
+ *  above) to displayable pixels, expanding 64 pixels per word.
+ *  \param bits the image (level 0)
+ *  \param lut maps gray values (0 and bits.getOne()) to display pixels
+ *  \param x0 left of the rect
+ *  \param y0 top of the rect
+ *  \param tw rect width
+ *  \param th rect height
+ *  \param pixels receives the pixel for (x0,y0); the apron is around it
+ *  \param stride row length of pixels (at least tw+2)
+ */
+void TileRenderer::convert ( const BitImage& bits, const DisplayLUT& lut,
+                             const int x0, const int y0, const int tw,
+                             const int th, unsigned int* const pixels,
+                             const int stride )
+{
+    const int  w = bits.getW(), h = bits.getH();
+    const unsigned int  zero = lut.lookup( 0 );
+    const unsigned int  one  = lut.lookup( bits.getOne() );
+    const int  xl = (x0 > 0) ? x0 - 1 : 0;
+    const int  xr = (x0 + tw < w) ? x0 + tw : w - 1;
+    for (int y=-1; y<=th; y++) {
+        int  sy = y0 + y;
+        sy = (sy<0) ? 0 : (sy>=h ? h-1 : sy);
+        unsigned int*  d = pixels + y * stride;
+        bits.toBGRX( x0, sy, tw, d, zero, one );
+        d[-1] = bits.get( xl, sy ) ? one : zero;
+        d[tw] = bits.get( xr, sy ) ? one : zero;
+    }
+}
+//===========================================================================
+/// sort key: distance (squared) of a tile's center from a point.
+struct TileDistance {
+    long long  dist2;
+    TileRenderer::Tile*  tile;
+    bool operator< ( const TileDistance& o ) const {  return dist2 < o.dist2;  }
+};
+//---------------------------------------------------------------------------
+/** \brief Order tiles by distance from (cx,cy) (nearest first), e.g.,
+ *  from the center of the window so that converting starts there.
+ */
+void TileRenderer::prioritize ( std::vector<Tile*>& tiles, const int cx,
+                                const int cy )
+{
+    std::vector<TileDistance>  d( tiles.size() );
+    for (size_t i=0; i<tiles.size(); i++) {
+        const long long  dx = (2LL*tiles[i]->x0 + tiles[i]->w) - 2LL*cx;
+        const long long  dy = (2LL*tiles[i]->y0 + tiles[i]->h) - 2LL*cy;
+        d[i].dist2 = dx*dx + dy*dy;
+        d[i].tile  = tiles[i];
+    }
+    std::stable_sort( d.begin(), d.end() );
+    for (size_t i=0; i<tiles.size(); i++)    tiles[i] = d[i].tile;
+}
+//===========================================================================
+TileRenderer::TileRenderer ( ) {
+    mBatch = NULL;
+}
+//---------------------------------------------------------------------------
+TileRenderer::~TileRenderer ( ) {
+    cancel();
+}
+//---------------------------------------------------------------------------
+/** \brief Start converting tiles (after cancelling any conversion in
+ *  progress).  The tiles become Queued and then Converted (into their
+ *  target pixels; see DisplayCache::prepare).  The source must
+ *  remain valid (and the tiles cached) until the listener is told that
+ *  rendering has finished or cancel returns.
+ *  \param src samples of the tiles' level (gray, or interleaved rgb)
+ *  \param w level width
+ *  \param h level height
+ *  \param samplesPerPixel 1 (gray) or 3 (rgb)
+ *  \param lut maps gray values to display pixels
+ *  \param tiles tiles to convert (most important first)
+ *  \param listener notified as tiles complete (may be NULL)
+ *  \param bits src packed 1 bit per pixel (binary level 0), to convert
+ *  from instead (may be NULL)
+ */
+void TileRenderer::start ( const int* const src, const int w, const int h,
+                           const int samplesPerPixel, const DisplayLUT& lut,
+                           const std::vector<Tile*>& tiles,
+                           Listener* listener, const BitImage* bits )
+{
+    assert( src!=NULL && w>0 && h>0 );
+    cancel();
+    if (tiles.empty())    return;
+    Batch*  b = new Batch();
+    b->src = src;    b->w = w;    b->h = h;    b->spp = samplesPerPixel;
+    b->lut = lut;    b->tiles = tiles;    b->bits = bits;
+    b->next = 0;    b->converted = 0;    b->finished = 0;
+    b->cancelled = 0;    b->running = 0;
+    b->listener = listener;
+    for (size_t i=0; i<tiles.size(); i++)    tiles[i]->state = DisplayCache::Queued;
+
+    ThreadPool&  pool = ThreadPool::instance();
+    const int  workers = std::min( (int)tiles.size(), pool.getThreadCount() );
+    b->refs = workers + 1;
+    mBatch = b;
+    //urgent: what's on screen goes before other queued work (workers that
+    // are busy with something else just don't help)
+    for (int i=0; i<workers; i++)    pool.submit( new Worker(b), true );
+}
+//---------------------------------------------------------------------------
+/** \brief Stop converting (tiles being converted are finished first; the
+ *  rest become Empty again).  Returns after all workers are done with the
+ *  source and the tiles (workers that haven't started yet never use them).
+ */
+void TileRenderer::cancel ( void ) {
+    if (mBatch==NULL)    return;
+    bool  idle;
+    {
+        Lock  l( mBatch->mutex );
+        mBatch->cancelled = 1;
+        idle = (mBatch->running==0);
+    }
+    if (!idle)    mBatch->idle.wait();
+    //unclaimed tiles (claimed ones are Converted and may have been discarded)
+    const long  n = (long)mBatch->tiles.size();
+    for (long i=std::min( (long)mBatch->next, n ); i<n; i++)
+        mBatch->tiles[i]->state = DisplayCache::Empty;
+    mBatch->release();
+    mBatch = NULL;
+}
+//---------------------------------------------------------------------------
+/// \returns true if a conversion is in progress.
+bool TileRenderer::isBusy ( void ) const {
+    return mBatch!=NULL && !mBatch->finished;
+}
+//---------------------------------------------------------------------------
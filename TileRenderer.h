@@ -0,0 +1,87 @@
+/**
+    \file TileRenderer.h
+    Definition of the TileRenderer class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef TileRenderer_h
+#define TileRenderer_h
+
+#include  <vector>
+#include  "BitImage.h"
+#include  "DisplayCache.h"
+#include  "DisplayLUT.h"
+#include  "ThreadPool.h"
+//----------------------------------------------------------------------
+/** \brief Converts tiles of an image into displayable (BGRX) pixels on
+ *  the worker pool.
+ *
+ *  Tiles are converted in the order given (see prioritize) and the
+ *  listener is told as each one completes, so the visible part of a
+ *  large image can be shown right away.
+ */
+class TileRenderer {
+public:
+    typedef DisplayCache::Tile  Tile;
+
+    /// receives notifications (on worker threads).
+    class Listener {
+    public:
+        virtual ~Listener ( ) { }
+        /// a tile has been converted.
+        virtual void tileReady ( const int level, const int tx,
+                                 const int ty ) = 0;
+        /// all tiles have been converted.
+        virtual void renderFinished ( void ) = 0;
+    };
+
+    TileRenderer  ( );
+    ~TileRenderer ( );
+
+    void start  ( const int* const src, const int w, const int h,
+                  const int samplesPerPixel, const DisplayLUT& lut,
+                  const std::vector<Tile*>& tiles, Listener* listener,
+                  const BitImage* bits=NULL );
+    void cancel ( void );
+    bool isBusy ( void ) const;
+
+    static void prioritize ( std::vector<Tile*>& tiles, const int cx,
+                             const int cy );
+    static void convert ( const int* const src, const int w, const int h,
+                          const int spp, const DisplayLUT& lut, const int x0,
+                          const int y0, const int tw, const int th,
+                          unsigned int* const pixels, const int stride );
+    static void convert ( const BitImage& bits, const DisplayLUT& lut,
+                          const int x0, const int y0, const int tw,
+                          const int th, unsigned int* const pixels,
+                          const int stride );
+
+protected:
+    struct Batch;
+    class  Worker;
+    Batch*  mBatch;  ///< current (or last) conversion (or NULL)
+};
+
+#endif
+//----------------------------------------------------------------------
@@ -0,0 +1,389 @@
+/**
+    \file UndoJournal.cpp
+    Implementation of the UndoJournal class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#include  <assert.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  "LZCodec.h"
+#include  "UndoJournal.h"
+//---------------------------------------------------------------------------
+/** \brief UndoJournal ctor.  Initially, no image is attached.
+ */
+UndoJournal::UndoJournal ( const int tileSize ) : mSpill( "undo" ) {
+    assert( tileSize>0 );
+    mData = 0;
+    mW = mH = mSpp = 0;
+    mTileSize = tileSize;
+    mTilesAcross = mTilesDown = 0;
+    mBudget = 64 * 1024 * 1024;
+    mMemoryUsed = 0;
+    mMaxDepth = 100;
+    mCurrent = 0;
+}
+//---------------------------------------------------------------------------
+/** \brief UndoJournal dtor.  Discard all history.
+ */
+UndoJournal::~UndoJournal ( ) {
+    clear();
+}
+//---------------------------------------------------------------------------
+/** \brief Start journaling a (new) image.  Any existing history is
+ *  discarded.
+ *  \param data            image pixels (not owned by the journal)
+ *  \param w               image width
+ *  \param h               image height
+ *  \param samplesPerPixel 1 for gray, 3 for rgb
+ */
+void UndoJournal::attach ( int* data, const int w, const int h,
+                           const int samplesPerPixel )
+{
+    clear();
+    mData = data;
+    mW    = w;
+    mH    = h;
+    mSpp  = samplesPerPixel;
+    mTilesAcross = (w + mTileSize - 1) / mTileSize;
+    mTilesDown   = (h + mTileSize - 1) / mTileSize;
+    mScratch.resize( mTileSize * mTileSize * (mSpp>0 ? mSpp : 1) );
+    mPacked.resize( LZCodec::maxCompressedSize(
+        (int)(mScratch.size() * sizeof(int)) ) );
+}
+//---------------------------------------------------------------------------
+/** \brief Discard all undo and redo history (and the spill file).
+ */
+void UndoJournal::clear ( void ) {
+    cancelEdit();
+    for (size_t i=0; i<mUndo.size(); i++)    freeRecord( mUndo[i] );
+    for (size_t i=0; i<mRedo.size(); i++)    freeRecord( mRedo[i] );
+    mUndo.clear();
+    mRedo.clear();
+    mMemoryUsed = 0;
+    mSpill.close();
+}
+//---------------------------------------------------------------------------
+/** \brief Set the amount of memory that saved tiles may occupy before
+ *  they are spilled to disk.
+ */
+void UndoJournal::setMemoryBudget ( const size_t bytes ) {
+    mBudget = bytes;
+    enforceBudget();
+}
+//---------------------------------------------------------------------------
+const char* UndoJournal::getUndoName ( void ) const {
+    return mUndo.empty() ? "" : mUndo.back()->name;
+}
+//---------------------------------------------------------------------------
+const char* UndoJournal::getRedoName ( void ) const {
+    return mRedo.empty() ? "" : mRedo.back()->name;
+}
+//---------------------------------------------------------------------------
+/** \brief Determine the tiles that the next undo will change (so that
+ *  anything cached about them may be invalidated beforehand).
+ */
+void UndoJournal::getUndoTiles ( std::vector<int>& tiles ) const {
+    tiles.clear();
+    if (mUndo.empty())    return;
+    const Record*  r = mUndo.back();
+    for (size_t i=0; i<r->tiles.size(); i++)    tiles.push_back( r->tiles[i].tile );
+}
+//---------------------------------------------------------------------------
+/** \brief Determine the tiles that the next redo will change.
+ */
+void UndoJournal::getRedoTiles ( std::vector<int>& tiles ) const {
+    tiles.clear();
+    if (mRedo.empty())    return;
+    const Record*  r = mRedo.back();
+    for (size_t i=0; i<r->tiles.size(); i++)    tiles.push_back( r->tiles[i].tile );
+}
+//---------------------------------------------------------------------------
+/** \brief Begin a new edit.  Must be followed by endEdit (or cancelEdit).
+ *  \param name edit name (e.g., for the Undo menu item)
+ */
+void UndoJournal::beginEdit ( const char* const name ) {
+    assert( mCurrent==0 );
+    mCurrent = new Record;
+    strncpy( mCurrent->name, name!=NULL ? name : "", sizeof mCurrent->name );
+    mCurrent->name[ sizeof(mCurrent->name)-1 ] = 0;
+    mSaved.assign( mTilesAcross * mTilesDown, 0 );
+}
+//---------------------------------------------------------------------------
+/** \brief Save the tiles that intersect the given region (before they are
+ *  modified).  Tiles already saved by this edit are not saved again.
+ *  \param x0 left column (inclusive)
+ *  \param y0 top row (inclusive)
+ *  \param x1 right column (exclusive)
+ *  \param y1 bottom row (exclusive)
+ *  \returns false if out of memory (some tiles weren't saved, so the edit
+ *  couldn't be undone; it should be cancelled).
+ */
+bool UndoJournal::saveRect ( int x0, int y0, int x1, int y1 ) {
+    assert( mCurrent!=0 && mData!=0 );
+    if (x0<0)     x0 = 0;
+    if (y0<0)     y0 = 0;
+    if (x1>mW)    x1 = mW;
+    if (y1>mH)    y1 = mH;
+    if (x0>=x1 || y0>=y1)    return true;
+
+    const int  tx0 = x0 / mTileSize, tx1 = (x1-1) / mTileSize;
+    const int  ty0 = y0 / mTileSize, ty1 = (y1-1) / mTileSize;
+    for (int ty=ty0; ty<=ty1; ty++) {
+        for (int tx=tx0; tx<=tx1; tx++) {
+            const int  tile = ty*mTilesAcross + tx;
+            if (mSaved[tile])    continue;
+            TileDelta  d;
+            if (!capture(tile, &d))    return false;
+            mCurrent->tiles.push_back( d );
+            mSaved[tile] = 1;
+        }
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Finish the current edit and make it undoable.  Any redo history
+ *  is discarded.
+ */
+void UndoJournal::endEdit ( void ) {
+    assert( mCurrent!=0 );
+    if (mCurrent->tiles.empty()) {
+        //nothing was modified
+        freeRecord( mCurrent );
+        mCurrent = 0;
+        return;
+    }
+    for (size_t i=0; i<mRedo.size(); i++)    freeRecord( mRedo[i] );
+    mRedo.clear();
+    mUndo.push_back( mCurrent );
+    mCurrent = 0;
+    while (mMaxDepth>0 && (int)mUndo.size()>mMaxDepth) {
+        freeRecord( mUndo.front() );
+        mUndo.erase( mUndo.begin() );
+    }
+    enforceBudget();
+}
+//---------------------------------------------------------------------------
+/** \brief Abandon the current edit (if any).  Pixels already modified are
+ *  restored from the saved tiles.
+ */
+void UndoJournal::cancelEdit ( void ) {
+    if (mCurrent==0)    return;
+    for (size_t i=0; i<mCurrent->tiles.size(); i++)
+        restore( mCurrent->tiles[i] );
+    freeRecord( mCurrent );
+    mCurrent = 0;
+}
+//---------------------------------------------------------------------------
+/** \brief Undo the most recent edit.
+ *  \param tilesChanged (optional output) indices of tiles that changed
+ *  \returns true if anything was undone; false if there is nothing to
+ *  undo or it failed (out of memory, or the spill file couldn't be read),
+ *  in which case the image and the history are unchanged.
+ */
+bool UndoJournal::undo ( std::vector<int>* tilesChanged ) {
+    if (tilesChanged!=0)    tilesChanged->clear();
+    if (mCurrent!=0 || mUndo.empty())    return false;
+    Record*  r = mUndo.back();
+    if (!exchange( r, tilesChanged ))    return false;
+    mUndo.pop_back();
+    mRedo.push_back( r );
+    enforceBudget();
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Redo the most recently undone edit.
+ *  \param tilesChanged (optional output) indices of tiles that changed
+ *  \returns true if anything was redone; false if there is nothing to
+ *  redo or it failed (as undo).
+ */
+bool UndoJournal::redo ( std::vector<int>* tilesChanged ) {
+    if (tilesChanged!=0)    tilesChanged->clear();
+    if (mCurrent!=0 || mRedo.empty())    return false;
+    Record*  r = mRedo.back();
+    if (!exchange( r, tilesChanged ))    return false;
+    mRedo.pop_back();
+    mUndo.push_back( r );
+    enforceBudget();
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Swap each saved tile in r with the current image contents.
+ *  Afterwards, r holds what is needed to reverse the operation.
+ *
+ *  All of the current tiles are captured before any is replaced, so if
+ *  anything fails, the tiles already replaced are put back (from those
+ *  in memory copies) and both the image and r are unchanged.
+ *  \returns true if successful.
+ */
+bool UndoJournal::exchange ( Record* r, std::vector<int>* tilesChanged ) {
+    const size_t  n = r->tiles.size();
+    std::vector<TileDelta>  cur( n );
+    size_t  i;
+    for (i=0; i<n; i++)
+        if (!capture( r->tiles[i].tile, &cur[i] ))    break;
+    if (i==n) {
+        for (i=0; i<n; i++)
+            if (!restore( r->tiles[i] ))    break;
+        if (i==n) {
+            for (i=0; i<n; i++) {
+                release( &r->tiles[i] );
+                r->tiles[i] = cur[i];
+                if (tilesChanged!=0)    tilesChanged->push_back( cur[i].tile );
+            }
+            return true;
+        }
+        //put back what was replaced
+        while (i>0) {
+            --i;
+            restore( cur[i] );
+        }
+        i = n;
+    }
+    //discard the captures
+    while (i>0) {
+        --i;
+        release( &cur[i] );
+    }
+    return false;
+}
+//---------------------------------------------------------------------------
+/** \brief Determine the pixel extent of a tile.
+ */
+void UndoJournal::tileRect ( const int tile, int* x0, int* y0,
+                             int* tw, int* th ) const
+{
+    *x0 = (tile % mTilesAcross) * mTileSize;
+    *y0 = (tile / mTilesAcross) * mTileSize;
+    *tw = (*x0 + mTileSize <= mW) ? mTileSize : mW - *x0;
+    *th = (*y0 + mTileSize <= mH) ? mTileSize : mH - *y0;
+}
+//---------------------------------------------------------------------------
+/** \brief Copy (and compress) the current contents of a tile.
+ *  \returns true if successful.
+ */
+bool UndoJournal::capture ( const int tile, TileDelta* d ) {
+    int  x0, y0, tw, th;
+    tileRect( tile, &x0, &y0, &tw, &th );
+    const int  rowSamples = tw * mSpp;
+    int*  dst = &mScratch[0];
+    for (int y=0; y<th; y++) {
+        memcpy( dst, &mData[ ((size_t)(y0+y) * mW + x0) * mSpp ],
+                rowSamples * sizeof(int) );
+        dst += rowSamples;
+    }
+    const int  raw = rowSamples * th * (int)sizeof(int);
+    const int  packed = LZCodec::compress( (unsigned char*)&mScratch[0], raw,
+                                           &mPacked[0], raw );
+    d->tile       = tile;
+    d->rawBytes   = raw;
+    d->compressed = (packed>0);
+    d->packedBytes= d->compressed ? packed : raw;
+    d->offset     = -1;
+    d->mem = (unsigned char*)malloc( d->packedBytes );
+    if (d->mem==0)    return false;
+    memcpy( d->mem, d->compressed ? &mPacked[0] : (unsigned char*)&mScratch[0],
+            d->packedBytes );
+    mMemoryUsed += d->packedBytes;
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Fetch the stored bytes of a saved tile (from memory or disk).
+ */
+bool UndoJournal::load ( const TileDelta& d, unsigned char* const buff ) {
+    if (d.mem!=0) {
+        memcpy( buff, d.mem, d.packedBytes );
+        return true;
+    }
+    return mSpill.read( d.offset, buff, d.packedBytes );
+}
+//---------------------------------------------------------------------------
+/** \brief Copy a saved tile back into the image.
+ *  \returns true if successful.
+ */
+bool UndoJournal::restore ( const TileDelta& d ) {
+    unsigned char*  raw = (unsigned char*)&mScratch[0];
+    if (d.compressed) {
+        if (!load(d, &mPacked[0]))    return false;
+        if (!LZCodec::decompress(&mPacked[0], d.packedBytes, raw, d.rawBytes))
+            return false;
+    } else {
+        if (!load(d, raw))    return false;
+    }
+    int  x0, y0, tw, th;
+    tileRect( d.tile, &x0, &y0, &tw, &th );
+    const int  rowSamples = tw * mSpp;
+    const int*  src = &mScratch[0];
+    for (int y=0; y<th; y++) {
+        memcpy( &mData[ ((size_t)(y0+y) * mW + x0) * mSpp ], src,
+                rowSamples * sizeof(int) );
+        src += rowSamples;
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Free the memory (if any) held by a saved tile.  Space in the spill
+ *  file is not reclaimed until the journal is cleared.
+ */
+void UndoJournal::release ( TileDelta* d ) {
+    if (d->mem!=0) {
+        free( d->mem );
+        d->mem = 0;
+        mMemoryUsed -= d->packedBytes;
+    }
+}
+//---------------------------------------------------------------------------
+void UndoJournal::freeRecord ( Record* r ) {
+    if (r==0)    return;
+    for (size_t i=0; i<r->tiles.size(); i++)    release( &r->tiles[i] );
+    delete r;
+}
+//---------------------------------------------------------------------------
+/** \brief Move the in memory tiles of a record to the spill file.
+ *  \returns false if the spill file could not be written.
+ */
+bool UndoJournal::spillRecord ( Record* r ) {
+    for (size_t i=0; i<r->tiles.size(); i++) {
+        TileDelta&  d = r->tiles[i];
+        if (d.mem==0)    continue;
+        long long  offset;
+        if (!mSpill.append(d.mem, d.packedBytes, &offset))    return false;
+        release( &d );
+        d.offset = offset;
+        if (mMemoryUsed<=mBudget)    return true;
+    }
+    return true;
+}
+//---------------------------------------------------------------------------
+/** \brief Spill saved tiles to disk until we are within budget.  The
+ *  records least likely to be needed (oldest undo, then oldest redo) go
+ *  first.
+ */
+void UndoJournal::enforceBudget ( void ) {
+    for (size_t i=0; i<mUndo.size() && mMemoryUsed>mBudget; i++)
+        if (!spillRecord(mUndo[i]))    return;
+    for (size_t i=0; i<mRedo.size() && mMemoryUsed>mBudget; i++)
+        if (!spillRecord(mRedo[i]))    return;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,144 @@
+/**
+    \file UndoJournal.h
+    Definition of the UndoJournal class.
+
+    \author George J. Grevera, Ph.D., ggrevera@sju.edu
+
+    Copyright (C) 2002, George J. Grevera
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307
+    USA or from http://www.gnu.org/licenses/gpl.txt.
+
+    This General Public License does not permit incorporating this
+    code into proprietary programs.  (So a hypothetical company such
+    as GH (Generally Hectic) should NOT incorporate this code into
+    their proprietary programs.)
+ */
+#ifndef UndoJournal_h
+#define UndoJournal_h
+
+#include  <stddef.h>
+#include  <vector>
+#include  "TempFile.h"
+//----------------------------------------------------------------------
+/** \brief Tile granular undo/redo history for an image.
+ *
+ *  Before an operation modifies pixels, it calls saveRect for the region
+ *  it is about to change.  Only the tiles that intersect that region are
+ *  copied (once per edit), compressed with LZCodec, and kept in the
+ *  journal.  Undo and redo exchange the saved tiles with the current
+ *  ones, so their cost is proportional to the edited area rather than
+ *  the image size.
+ *
+ *  Saved tiles are kept in memory up to a budget.  Beyond that, the
+ *  oldest ones are written to a scratch file and read back on demand.
+ *
+ *  Usage:
+ *  <pre>
+ *  journal.beginEdit( "Median" );
+ *  if (!journal.saveRect( x0, y0, x1, y1 )) {  //before changing the pixels
+ *      journal.cancelEdit();  //(out of memory)
+ *      return;
+ *  }
+ *  ... modify pixels ...
+ *  journal.endEdit();
+ *  </pre>
+ */
+class UndoJournal {
+public:
+    /** \brief ctor.
+     *  \param tileSize width and height (in pixels) of a tile.
+     */
+    UndoJournal ( const int tileSize=256 );
+    ~UndoJournal ( );
+
+    void   attach ( int* data, const int w, const int h,
+                    const int samplesPerPixel );
+    void   clear ( void );
+    /// the pixels moved (same contents, e.g., copied out of a mapped file).
+    inline void rebind ( int* data ) {  mData = data;  }
+
+    void   beginEdit ( const char* const name );
+    bool   saveRect ( int x0, int y0, int x1, int y1 );
+    void   endEdit ( void );
+    void   cancelEdit ( void );
+
+    bool   undo ( std::vector<int>* tilesChanged=NULL );
+    bool   redo ( std::vector<int>* tilesChanged=NULL );
+
+    inline bool canUndo ( void ) const {  return !mUndo.empty();  }
+    inline bool canRedo ( void ) const {  return !mRedo.empty();  }
+    inline bool inEdit  ( void ) const {  return mCurrent!=NULL;  }
+    const char* getUndoName ( void ) const;
+    const char* getRedoName ( void ) const;
+    void   getUndoTiles ( std::vector<int>& tiles ) const;
+    void   getRedoTiles ( std::vector<int>& tiles ) const;
+
+    void   setMemoryBudget ( const size_t bytes );
+    inline size_t getMemoryBudget ( void ) const {  return mBudget;  }
+    inline size_t getMemoryUsed   ( void ) const {  return mMemoryUsed;  }
+    inline long long getSpilledBytes ( void ) const {  return mSpill.size();  }
+    /** \brief limit the number of undo steps (oldest are discarded). */
+    inline void setMaxDepth ( const int depth ) {  mMaxDepth = depth;  }
+
+    inline int  getTileSize    ( void ) const {  return mTileSize;  }
+    inline int  getTilesAcross ( void ) const {  return mTilesAcross;  }
+    inline int  getTilesDown   ( void ) const {  return mTilesDown;  }
+
+protected:
+    /** \brief one saved (compressed) tile. */
+    struct TileDelta {
+        int             tile;        ///< tile index (ty*tilesAcross + tx)
+        int             rawBytes;    ///< uncompressed size
+        int             packedBytes; ///< stored size
+        bool            compressed;  ///< false if stored as is
+        unsigned char*  mem;         ///< in memory data (or NULL if spilled)
+        long long       offset;      ///< location in spill file (if spilled)
+    };
+    /** \brief all tiles saved by one edit. */
+    struct Record {
+        char                    name[64];  ///< edit name (for menus)
+        std::vector<TileDelta>  tiles;     ///< saved tiles
+    };
+
+    int*    mData;             ///< image being journaled (not owned)
+    int     mW, mH, mSpp;      ///< image width, height, samples per pixel
+    int     mTileSize;         ///< tile width and height
+    int     mTilesAcross;      ///< number of tile columns
+    int     mTilesDown;        ///< number of tile rows
+    size_t  mBudget;           ///< in memory limit for saved tiles
+    size_t  mMemoryUsed;       ///< bytes of saved tiles in memory
+    int     mMaxDepth;         ///< max number of undo steps
+
+    std::vector<Record*>        mUndo;     ///< oldest first
+    std::vector<Record*>        mRedo;     ///< oldest first
+    Record*                     mCurrent;  ///< edit in progress (or NULL)
+    std::vector<unsigned char>  mSaved;    ///< tiles saved by mCurrent
+    std::vector<int>            mScratch;  ///< tile sized buffer
+    std::vector<unsigned char>  mPacked;   ///< compression buffer
+    TempFile                    mSpill;    ///< spill file
+
+    void  tileRect ( const int tile, int* x0, int* y0, int* tw, int* th ) const;
+    bool  capture  ( const int tile, TileDelta* d );
+    bool  restore  ( const TileDelta& d );
+    bool  load     ( const TileDelta& d, unsigned char* const buff );
+    void  release  ( TileDelta* d );
+    void  freeRecord ( Record* r );
+    bool  exchange ( Record* r, std::vector<int>* tilesChanged );
+    void  enforceBudget ( void );
+    bool  spillRecord ( Record* r );
+};
+
+#endif
+//----------------------------------------------------------------------
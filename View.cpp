@@ -28,7 +28,11 @@
 #include  "stdafx.h"
 #include  "ImageViewer.h"
 #include  <assert.h>
+#include  <math.h>
 #include  "ImageData.h"
+#include  "ImageSaver.h"
+#include  "Morphology.h"
+#include  "TIFFWriter.h"
 #include  "View.h"
 
 #ifdef _DEBUG
@@ -46,7 +50,18 @@ BEGIN_MESSAGE_MAP( View, CView )
 	//{{AFX_MSG_MAP( View )
 	ON_WM_MOUSEMOVE()
 	ON_WM_ERASEBKGND()
+	ON_WM_SIZE()
+	ON_WM_TIMER()
+	ON_WM_LBUTTONDOWN()
+	ON_WM_LBUTTONUP()
+	ON_WM_LBUTTONDBLCLK()
+	ON_WM_RBUTTONDOWN()
+	ON_WM_RBUTTONUP()
+	ON_WM_MOUSEWHEEL()
+	ON_WM_KEYDOWN()
 	//}}AFX_MSG_MAP
+	ON_MESSAGE( WM_FRAME_READY, OnFrameReady )
+	ON_MESSAGE( WM_RENDER_DONE, OnRenderDone )
 	// Standard printing commands
 	ON_COMMAND( ID_FILE_PRINT,         CView::OnFilePrint )
 	ON_COMMAND( ID_FILE_PRINT_DIRECT,  CView::OnFilePrint )
@@ -58,10 +73,23 @@ END_MESSAGE_MAP()
  *  Indicate that we don't have an image yet and mouse movement coordinates
  *  are not yet valid.
  */
-View::View ( ) {
+View::View ( ) : mFrames( this ) {
     mMouseMoveValid = false;
-    mDisplayData = 0;
+    mLUTValid = false;
+    mDragging = false;
+    mRenderPinned = false;
+    mFrameCurrent = false;
+    mFramePosted = 0;
+    mZoom = 1;
+    mPanX = mPanY = 0;
+    mBilinear = true;
+    mPanning = false;
 	mMouseMoveX = mMouseMoveY = -1;
+    mOverlayRect.SetRectEmpty();
+    mOverlayTimerSet = false;
+    mMoveTime = mLastOverlayPaint = mRefreshTicks = 0;
+    mLatencyCount = 0;
+    mLatencyTotal = mLatencyMax = 0;
 }
 /** \brief View dtor.
  *
@@ -69,7 +97,9 @@ View::View ( ) {
  *  an image.
  */
 View::~View ( ) {
-    if (mDisplayData!=0) {  free( mDisplayData );  mDisplayData=0;  }
+    releaseDisplayData();
+    finishRender();
+    MemoryBudget::instance().remove( this );
 }
 
 BOOL View::PreCreateWindow ( CREATESTRUCT& cs ) {
@@ -96,91 +126,128 @@ void View::OnDraw ( CDC* pDC ) {
             CBrush::FromHandle((HBRUSH)GetStockObject(BLACK_BRUSH)) );
 
         //anything left over from last time?
-        if (mDisplayData!=0) {
-            free( mDisplayData );
-            mDisplayData = 0;
-        }
+        releaseDisplayData();
         pDC->SetBkColor( 0x00000000 );
         pDC->SetTextColor( 0x0000ffff );
         char  buff[255];
         sprintf( buff, "(%d,%d) \n no image", mMouseMoveX, mMouseMoveY );
         pDC->DrawText( buff, -1, &rcBounds, DT_CENTER );
+        overlayPainted( pDC );
         return;
     }
 
-    //have we created a displayable version of the image yet?
-    if (mDisplayData==0) {
-        //create a displayable version of the image.
-        mDisplayData = (unsigned char*)malloc( 4 * pDoc->getW()
-            * pDoc->getH() * sizeof(unsigned char) );
-        assert( mDisplayData!=NULL );
-		if (!pDoc->getIsColor()) {  //gray?
-            int  src=0, dst=0;
-            for (int y=0; y<pDoc->getH(); y++) {
-                for (int x=0; x<pDoc->getW(); x++) {
-                    int  v = pDoc->getData(src);
-                    if (pDoc->getMin()<0 || pDoc->getMax()>255) {
-                        const int  diff = pDoc->getMax() - pDoc->getMin();
-                        if (diff!=0)    v = 255 * (v-pDoc->getMin()) / diff;
-                        else            v = 127;
-                    } else if (pDoc->getMin()==0 && pDoc->getMax()==1) {
-                        //handle special case of binary image (otherwise, we
-                        // won't be able to distinguish between black and white.
-                        if (v==1)    v=255;
-                    }
-                    if (v<0)    v = 0;
-                    if (v>255)  v = 255;
-                    //0 is dark; 255 is bright
-                    mDisplayData[dst]   = v;  //blue
-                    mDisplayData[dst+1] = v;  //green
-                    mDisplayData[dst+2] = v;  //red
-                    mDisplayData[dst+3] = 0;  //not used
-                    src++;
-                    dst += 4;
-                }
-            }
-        } else {  //color (rgb)
-            int  src=0, dst=0;
-            for (int y=0; y<pDoc->getH(); y++) {
-                for (int x=0; x<pDoc->getW(); x++) {
-                    //0 is dark; 255 is bright
-                    mDisplayData[dst+2] = pDoc->getData(src++);  //red
-                    mDisplayData[dst+1] = pDoc->getData(src++);  //green
-                    mDisplayData[dst  ] = pDoc->getData(src++);  //blue
-                    mDisplayData[dst+3] = 0;
-                    dst += 4;
-                }
-            }
-        }
+    //neither we nor the image may be evicted while we draw
+    MemoryBudget::Pin  pinView( this ), pinDoc( pDoc );
+    MemoryBudget::instance().touch( this );
+    //ask for a new frame if the view changed (it's composed on the render
+    // thread); then copy just the invalid part of the latest one to the
+    // screen.  (It's replaced by the new one when that's ready.)
+    if (!mFrameCurrent)    startRender();
+    const DisplaySurface&  frame = mFrames.frame();
+    CRect  rcClip;
+    pDC->GetClipBox( &rcClip );
+    if (frame.getBitmap()!=NULL) {
+        CDC  dcMem;
+        dcMem.CreateCompatibleDC( pDC );
+        HGDIOBJ  old = ::SelectObject( dcMem.GetSafeHdc(), frame.getBitmap() );
+        pDC->BitBlt( rcClip.left, rcClip.top, rcClip.Width(), rcClip.Height(),
+                     &dcMem, rcClip.left, rcClip.top, SRCCOPY );
+        // reselect the original bitmap into the memory DC
+        ::SelectObject( dcMem.GetSafeHdc(), old );
     }
+    //(the frame may be from before the window grew)
+    CRect  rcClient;
+    GetClientRect( &rcClient );
+    CBrush*  gray = CBrush::FromHandle( (HBRUSH)GetStockObject(GRAY_BRUSH) );
+    CRect  rcRight( frame.getWidth(), 0, rcClient.right, rcClient.bottom );
+    CRect  rcBelow( 0, frame.getHeight(), frame.getWidth(), rcClient.bottom );
+    if (!rcRight.IsRectEmpty())    pDC->FillRect( rcRight, gray );
+    if (!rcBelow.IsRectEmpty())    pDC->FillRect( rcBelow, gray );
 
-    CBitmap  bm;
-    bm.CreateBitmap( pDoc->getW(), pDoc->getH(), 1, 32, mDisplayData );
-    CDC  dcMem;
-    dcMem.CreateCompatibleDC( pDC );
-    CBitmap*  pbmpOld = dcMem.SelectObject( &bm );
-    pDC->BitBlt( 0, 0, pDoc->getW(), pDoc->getH(), &dcMem, 0, 0, SRCCOPY );
-    // reselect the original bitmap into the memory DC
-    dcMem.SelectObject( pbmpOld );
-
-    //fill the remainder with black
-    CRect  rcBounds;
-	GetClientRect( &rcBounds );
-    const int  oldTop = rcBounds.top;
-    rcBounds.top  = pDoc->getH();
-    pDC->FillRect( rcBounds, CBrush::FromHandle((HBRUSH)GetStockObject(GRAY_BRUSH)) );
-    rcBounds.top  = oldTop;
-    rcBounds.left = pDoc->getW();
-    pDC->FillRect( rcBounds, CBrush::FromHandle((HBRUSH)GetStockObject(GRAY_BRUSH)) );
-
+    //the mouse position is drawn over (not into) the surface
     if (mMouseMoveValid) {
         pDC->SetBkColor( 0x007f7f7f );
         pDC->SetTextColor( 0x0000ffff );
         char  buff[255];
-        sprintf( buff, "(%d,%d)", mMouseMoveX, mMouseMoveY );
-		if (rcBounds.left>600)    rcBounds.left = 100;
-        pDC->DrawText( buff, -1, &rcBounds, DT_CENTER );
+        overlayText( buff );
+        CRect  rcText;
+        overlayRect( pDC, buff, &rcText );
+        pDC->DrawText( buff, -1, &rcText, DT_CENTER );
+        mOverlayRect = rcText;
     }
+    overlayPainted( pDC );
+}
+//---------------------------------------------------------------------------
+/** \brief Where the mouse position text is drawn: centered (at the top) to
+ *  the right of the image (if there's room).
+ *  \param pDC device context (for measuring the text)
+ *  \param text the text
+ *  \param rc receives its bounding rect
+ */
+void View::overlayRect ( CDC* pDC, const char* const text, CRect* rc ) {
+    CRect  rcBounds;
+    GetClientRect( &rcBounds );
+    rcBounds.left = (int)((GetDocument()->getW() - mPanX) * mZoom);
+    if (rcBounds.left>600)    rcBounds.left = 100;
+    CRect  rcText( 0, 0, 0, 0 );
+    pDC->DrawText( text, -1, &rcText, DT_CALCRECT );
+    const int  x = rcBounds.left + (rcBounds.Width() - rcText.Width()) / 2;
+    *rc = CRect( x, rcBounds.top, x + rcText.Width(), rcBounds.top + rcText.Height() );
+}
+//---------------------------------------------------------------------------
+/// the mouse position (in image coordinates) as text.
+void View::overlayText ( char* buff ) {
+    const int  x = (int)floor( mPanX + mMouseMoveX / mZoom );
+    const int  y = (int)floor( mPanY + mMouseMoveY / mZoom );
+    sprintf( buff, "(%d,%d)", x, y );
+}
+//---------------------------------------------------------------------------
+/** \brief Account for a paint that showed the latest mouse position: record
+ *  the time from the first (unshown) mouse move to now.
+ */
+void View::overlayPainted ( CDC* pDC ) {
+    const long long  now = ticks();
+    if (mRefreshTicks==0) {
+        int  hz = pDC->GetDeviceCaps( VREFRESH );
+        if (hz<=1)    hz = 60;  //(1 means the default)
+        mRefreshTicks = ticksPerSecond() / hz;
+    }
+    mLastOverlayPaint = now;
+    if (mMoveTime==0)    return;
+    const double  latency = (double)(now - mMoveTime) / ticksPerSecond();
+    mMoveTime = 0;
+    ++mLatencyCount;
+    mLatencyTotal += latency;
+    if (latency > mLatencyMax)    mLatencyMax = latency;
+}
+//---------------------------------------------------------------------------
+/** \brief Mouse move to paint latency (for the mouse position text).
+ *  \param count receives the number of paints measured
+ *  \param mean receives the mean latency (in seconds)
+ *  \param max receives the max latency (in seconds)
+ */
+void View::getMoveLatency ( long* count, double* mean, double* max ) const {
+    *count = mLatencyCount;
+    *mean  = (mLatencyCount>0) ? mLatencyTotal / mLatencyCount : 0;
+    *max   = mLatencyMax;
+}
+//---------------------------------------------------------------------------
+/// \returns the current high resolution time (in ticks).
+long long View::ticks ( void ) {
+    LARGE_INTEGER  t;
+    QueryPerformanceCounter( &t );
+    return t.QuadPart;
+}
+//---------------------------------------------------------------------------
+/// \returns the number of ticks per second.
+long long View::ticksPerSecond ( void ) {
+    static long long  f = 0;
+    if (f==0) {
+        LARGE_INTEGER  t;
+        QueryPerformanceFrequency( &t );
+        f = t.QuadPart;
+    }
+    return f;
 }
 /////////////////////////////////////////////////////////////////////////////
 // View printing
@@ -225,23 +292,609 @@ void View::OnMouseMove ( UINT nFlags, CPoint point ) {
     mMouseMoveValid = true;
     mMouseMoveX     = point.x;
     mMouseMoveY     = point.y;
-    RedrawWindow();
+    if (mDragging && (nFlags & MK_LBUTTON)) {
+        //only the lut is rebuilt; the visible tiles are then remapped
+        // (and replace the old ones on screen as they're ready).
+        ImageData*  pDoc = GetDocument();
+        const double  perPixel = ((double)pDoc->getMax() - pDoc->getMin() + 1) / 256;
+        const double  step = (perPixel < 1) ? 1 : perPixel;
+        mLUT.setWindow( mDragCenter + step * (point.y - mDragStart.y),
+                        mDragWidth  + step * (point.x - mDragStart.x) );
+        startRender();
+        showWindow();
+    }
+    if (mPanning && (nFlags & MK_RBUTTON)) {
+        mPanX = mPanStartX - (point.x - mPanStart.x) / mZoom;
+        mPanY = mPanStartY - (point.y - mPanStart.y) / mZoom;
+        clampPan();
+        viewChanged();
+    }
+    if (mMoveTime==0)    mMoveTime = ticks();
+    //at most one repaint per display refresh (moves in between are coalesced)
+    if (mOverlayTimerSet)    return;
+    const long long  since = ticks() - mLastOverlayPaint;
+    if (mRefreshTicks==0 || since >= mRefreshTicks) {
+        invalidateOverlay();
+    } else {
+        const UINT  ms = (UINT)((mRefreshTicks - since) * 1000 / ticksPerSecond()) + 1;
+        SetTimer( OverlayTimer, ms, NULL );
+        mOverlayTimerSet = true;
+    }
 	//CView::OnMouseMove(nFlags, point);
 }
+//---------------------------------------------------------------------------
+/** \brief A deferred mouse position repaint is due.
+ */
+void View::OnTimer ( UINT_PTR nIDEvent ) {
+    if (nIDEvent!=OverlayTimer) {
+        CView::OnTimer( nIDEvent );
+        return;
+    }
+    KillTimer( OverlayTimer );
+    mOverlayTimerSet = false;
+    invalidateOverlay();
+}
+//---------------------------------------------------------------------------
+/** \brief Invalidate just the old and new mouse position text (the rest of
+ *  the window is unchanged).
+ */
+void View::invalidateOverlay ( void ) {
+    if (!GetDocument()->dataAvailable()) {
+        //the text is centered in the window
+        Invalidate( FALSE );
+        return;
+    }
+    InvalidateRect( &mOverlayRect, FALSE );
+    CDC*  pDC = GetDC();
+    if (pDC==NULL)    return;
+    char  buff[255];
+    overlayText( buff );
+    CRect  rcText;
+    overlayRect( pDC, buff, &rcText );
+    ReleaseDC( pDC );
+    InvalidateRect( &rcText, FALSE );
+}
 /////////////////////////////////////////////////////////////////////////////
 /** \brief This method is called whenever we need to load, reload, or modify
  *  the view of our object.
  */
 void View::OnUpdate ( CView* pSender, LPARAM lHint, CObject* pHint ) {
-    //did we load an image yet?
 	ImageData*  pDoc = GetDocument();
 	ASSERT_VALID(pDoc);
+    if (lHint==ImageData::HintStopRendering) {
+        //the pixels (or levels) are about to change; the tiles are
+        // discarded when they have.
+        mFrames.halt();
+        finishRender();
+        return;
+    }
+    //did we load an image yet?
     if (!pDoc->dataAvailable())    return;
-    //have we created a displayable version of the image yet?
-    if (mDisplayData==0)    return;
-    //otherwise, clean up the leftover image
-    free( mDisplayData );
-    mDisplayData = 0;
+    clampPan();
+    if (lHint==ImageData::HintPixelsChanged && pHint!=NULL) {
+        //only the tiles over the changed pixels are converted again (the
+        // rest, and the lut unless the range changed, are still good)
+        const std::vector<CRect>&  rects = ((ImageData::ChangedRects*)pHint)->mRects;
+        mFrames.halt();
+        for (size_t i=0; i<rects.size(); i++)
+            mFrames.invalidate( rects[i].left, rects[i].top, rects[i].right,
+                                rects[i].bottom );
+        if (!rects.empty() && (mLUT.getMode()==DisplayLUT::Equalize
+                               || mLUT.getMin()!=pDoc->getMin()
+                               || mLUT.getMax()!=pDoc->getMax()))
+            mLUTValid = false;
+    } else {
+        //discard the (now out of date) displayable tiles (the pool keeps
+        // the buffers for the next ones); the last frame is shown until the
+        // next one is ready.
+        mFrames.clear();
+        mLUTValid = false;
+    }
+    finishRender();
+    mFrameCurrent = false;
+    MemoryBudget::instance().setSize( this, mFrames.getBytes() );
+    Invalidate( FALSE );
+}
+/////////////////////////////////////////////////////////////////////////////
+/** \brief When a view becomes active, its image is brought back into
+ *  memory (if it was evicted) and becomes the most recently used.
+ */
+void View::OnActivateView ( BOOL bActivate, CView* pActivateView,
+                            CView* pDeactiveView )
+{
+    if (bActivate && pActivateView==this) {
+        ImageData*  pDoc = GetDocument();
+        if (pDoc->dataAvailable() && pDoc->makeResident()) {
+            MemoryBudget::instance().touch( pDoc );
+            MemoryBudget::instance().touch( this );
+        }
+    }
+    CView::OnActivateView( bActivate, pActivateView, pDeactiveView );
+}
+/////////////////////////////////////////////////////////////////////////////
+/** \brief Free the displayable tiles (called by the MemoryBudget when
+ *  memory is needed elsewhere; it's recreated when next drawn).
+ *  \returns the number of bytes still held.
+ */
+size_t View::evict ( void ) {
+    releaseDisplayData();
+    return 0;
+}
+//---------------------------------------------------------------------------
+void View::releaseDisplayData ( void ) {
+    //(the render thread is halted first; the pool keeps the buffers)
+    mFrames.release();
+    mFrameCurrent = false;
+}
+//---------------------------------------------------------------------------
+/** \brief Ask the render thread for a frame of the current view (zoom,
+ *  pan, window size, and lut).  It shows the cached tiles of the level for
+ *  the zoom at once and converts (on the worker threads) those that aren't
+ *  ready yet, nearest the center of the window first.
+ */
+void View::startRender ( void ) {
+    ImageData*  pDoc = GetDocument();
+    //neither we nor the image may be evicted until the frame is complete
+    // (or while a level is built below)
+    if (!mRenderPinned) {
+        MemoryBudget::instance().pin( this, 1 );
+        MemoryBudget::instance().pin( pDoc, 1 );
+        mRenderPinned = true;
+    }
+    if (!pDoc->makeResident()) {
+        mFrames.halt();  //(it may still be using the previous level)
+        finishRender();
+        return;
+    }
+    //the mapping is evaluated once per lut entry (not per pixel)
+    if (!mLUTValid)    buildLUT();
+
+    FrameRenderer::Request  r;
+    double  f;
+    r.level = FrameRenderer::displayLevel( mZoom, pDoc->getW(), pDoc->getH(), &f );
+    r.src = pDoc->getLevel( r.level, &r.levelW, &r.levelH );
+    if (r.src==NULL) {
+        mFrames.halt();
+        finishRender();
+        return;
+    }
+    CRect  rcClient;
+    GetClientRect( &rcClient );
+    r.spp = pDoc->getIsColor() ? 3 : 1;
+    r.bits = (r.level==0) ? pDoc->getBits() : NULL;
+    r.w = rcClient.Width();
+    r.h = rcClient.Height();
+    r.zoom = mZoom;
+    r.panX = mPanX;
+    r.panY = mPanY;
+    r.bilinear = mBilinear;
+    r.lut = mLUT;
+    mFrames.submit( r );
+    mFrameCurrent = true;
+}
+//---------------------------------------------------------------------------
+/** \brief (Re)build the lut for the image's range (and, when equalizing,
+ *  its histogram, which is cached by the document's statistics).
+ */
+void View::buildLUT ( void ) {
+    ImageData*  pDoc = GetDocument();
+    if (mLUT.getMode()==DisplayLUT::Equalize) {
+        int  first, shift;
+        const std::vector<unsigned int>&  hist = pDoc->getStats().getHistogram( &first, &shift );
+        mLUT.setHistogram( hist, first, shift );
+    }
+    mLUT.build( pDoc->getMin(), pDoc->getMax() );
+    mLUTValid = true;
+}
+//---------------------------------------------------------------------------
+/** \brief Release the pins held while the workers were converting.
+ */
+void View::finishRender ( void ) {
+    if (!mRenderPinned)    return;
+    mRenderPinned = false;
+    MemoryBudget::instance().pin( GetDocument(), -1 );
+    MemoryBudget::instance().pin( this, -1 );
+}
+/////////////////////////////////////////////////////////////////////////////
+/** \brief Called (on the render thread) when a new frame is ready.  (At
+ *  most one message is pending; the latest frame is shown.)
+ */
+void View::frameReady ( void ) {
+    if (atomicExchange( &mFramePosted, 1 )==0)
+        ::PostMessage( GetSafeHwnd(), WM_FRAME_READY, 0, 0 );
+}
+//---------------------------------------------------------------------------
+/** \brief Called (on the render thread) when the latest frame is complete.
+ */
+void View::renderFinished ( void ) {
+    ::PostMessage( GetSafeHwnd(), WM_RENDER_DONE, 0, 0 );
+}
+//---------------------------------------------------------------------------
+/** \brief Show the new frame.
+ */
+LRESULT View::OnFrameReady ( WPARAM wParam, LPARAM lParam ) {
+    atomicExchange( &mFramePosted, 0 );
+    MemoryBudget::instance().setSize( this, mFrames.getBytes() );
+    Invalidate( FALSE );
+    return 0;
+}
+//---------------------------------------------------------------------------
+/** \brief The displayable image is complete (unless a newer one was
+ *  started since this message was posted).
+ */
+LRESULT View::OnRenderDone ( WPARAM wParam, LPARAM lParam ) {
+    if (!mFrames.isBusy())    finishRender();
+    return 0;
+}
+/////////////////////////////////////////////////////////////////////////////
+/** \brief Start adjusting the window (contrast) of a gray image: dragging
+ *  right/left widens/narrows it; down/up raises/lowers its center.
+ */
+void View::OnLButtonDown ( UINT nFlags, CPoint point ) {
+    ImageData*  pDoc = GetDocument();
+    if (!pDoc->dataAvailable() || pDoc->getIsColor())    return;
+    if (!mLUTValid)    buildLUT();
+    if (mLUT.isWindowed()) {
+        mDragCenter = mLUT.getCenter();
+        mDragWidth  = mLUT.getWidth();
+    } else {
+        //start from the current (image range) mapping
+        mDragCenter = (pDoc->getMin() + (double)pDoc->getMax()) / 2;
+        mDragWidth  = (double)pDoc->getMax() - pDoc->getMin() + 1;
+    }
+    mDragStart = point;
+    mDragging = true;
+    SetCapture();
+}
+//---------------------------------------------------------------------------
+void View::OnLButtonUp ( UINT nFlags, CPoint point ) {
+    if (!mDragging)    return;
+    mDragging = false;
+    if (!mPanning)    ReleaseCapture();
+}
+//---------------------------------------------------------------------------
+/** \brief Go back to the default (image range) mapping.
+ */
+void View::OnLButtonDblClk ( UINT nFlags, CPoint point ) {
+    if (GetDocument()->getIsColor() || !mLUT.isWindowed())    return;
+    mLUT.clearWindow();
+    startRender();
+    showWindow();
+}
+//---------------------------------------------------------------------------
+/// show the current window in the status bar.
+void View::showWindow ( void ) {
+    CFrameWnd*  frame = (CFrameWnd*)AfxGetMainWnd();
+    if (frame==NULL)    return;
+    char  buff[128], mode[32];
+    if (mLUT.getMode()==DisplayLUT::Gamma)
+        sprintf( mode, "gamma %.2f", mLUT.getGamma() );
+    else
+        sprintf( mode, "%s", DisplayLUT::getModeName( mLUT.getMode() ) );
+    if (!mLUT.getColormap().isGray()) {
+        strcat( mode, ", " );
+        strcat( mode, Colormap::getName( mLUT.getColormap().getKind() ) );
+    }
+    if (mLUT.isWindowed())
+        sprintf( buff, "window center %.0f, width %.0f (%s)", mLUT.getCenter(),
+                 mLUT.getWidth(), mode );
+    else
+        sprintf( buff, "window: image range (%s)", mode );
+    frame->SetMessageText( buff );
+}
+/////////////////////////////////////////////////////////////////////////////
+/** \brief Start panning (dragging the image) with the right button.
+ */
+void View::OnRButtonDown ( UINT nFlags, CPoint point ) {
+    if (!GetDocument()->dataAvailable())    return;
+    mPanStart  = point;
+    mPanStartX = mPanX;
+    mPanStartY = mPanY;
+    mPanning = true;
+    SetCapture();
+}
+//---------------------------------------------------------------------------
+void View::OnRButtonUp ( UINT nFlags, CPoint point ) {
+    if (!mPanning)    return;
+    mPanning = false;
+    if (!mDragging)    ReleaseCapture();
+}
+//---------------------------------------------------------------------------
+/** \brief Zoom in/out (about the mouse position) with the wheel.
+ */
+BOOL View::OnMouseWheel ( UINT nFlags, short zDelta, CPoint pt ) {
+    ScreenToClient( &pt );  //(pt is in screen coordinates)
+    zoomAt( mZoom * pow( 1.25, (double)zDelta / WHEEL_DELTA ), pt );
+    return TRUE;
+}
+//---------------------------------------------------------------------------
+/** \brief Keyboard: + and - zoom (about the center of the window), Home
+ *  fits the image to the window, and B toggles bilinear/nearest filtering.
+ *  For gray images, M selects the next display mode (linear, gamma, log,
+ *  or equalized), Page Up/Down raise/lower the gamma, and C selects the
+ *  next colormap, D replaces a binary (or label) image by its distance
+ *  transform (Shift+D saves the unrounded distances as a TIFF instead),
+ *  and 1, 2, 3, and 4 erode, dilate, open, and close it with a
+ *  5x5 square (25x25 with Shift).  G smooths the image with a gaussian
+ *  (sigma 2, or 10 with Shift) and A with a mean (5x5, or 25x25 with
+ *  Shift).  N replaces each pixel by the median of the 15x15 (51x51 with
+ *  Shift) square around it.  L replaces a binary image by the
+ *  labels of its 8 connected components (4 with Shift).  W sets the window
+ *  to the 1st..99th percentiles of the visible part of a gray image.  E
+ *  saves the image as displayed.
+ */
+void View::OnKeyDown ( UINT nChar, UINT nRepCnt, UINT nFlags ) {
+    CRect  rcClient;
+    GetClientRect( &rcClient );
+    const CPoint  center( rcClient.Width() / 2, rcClient.Height() / 2 );
+    switch (nChar) {
+        case VK_ADD :
+            zoomAt( mZoom * 1.25, center );
+            break;
+        case VK_SUBTRACT :
+            zoomAt( mZoom / 1.25, center );
+            break;
+        case VK_HOME :
+            fitToWindow();
+            break;
+        case 'B' :
+            mBilinear = !mBilinear;
+            viewChanged();
+            break;
+        case 'M' :
+            setDisplayMode( (mLUT.getMode() + 1) % DisplayLUT::ModeCount );
+            break;
+        case VK_PRIOR :
+        case VK_NEXT :
+            mLUT.setGamma( (nChar==VK_PRIOR) ? mLUT.getGamma() * 1.1
+                                             : mLUT.getGamma() / 1.1 );
+            setDisplayMode( DisplayLUT::Gamma );
+            break;
+        case 'C' :
+            nextColormap();
+            break;
+        case 'E' :
+            exportDisplayed();
+            break;
+        case 'D' : {
+            if (GetKeyState( VK_SHIFT ) < 0) {
+                exportDistanceMap();
+                break;
+            }
+            CWaitCursor  wait;
+            if (!GetDocument()->distanceTransform())
+                AfxMessageBox( "The distance transform needs a gray (binary or label) image with some 0 pixels." );
+            break;
+        }
+        case '1' :
+        case '2' :
+        case '3' :
+        case '4' : {
+            const int  size = (GetKeyState( VK_SHIFT ) < 0) ? 25 : 5;
+            CWaitCursor  wait;
+            if (!GetDocument()->morphology( Morphology::Erode + (nChar - '1'),
+                                            size, size ))
+                AfxMessageBox( "Morphology needs a gray image." );
+            break;
+        }
+        case 'G' : {
+            CWaitCursor  wait;
+            if (!GetDocument()->gaussianFilter( (GetKeyState( VK_SHIFT ) < 0) ? 10 : 2 ))
+                AfxMessageBox( "Not enough memory to filter the image." );
+            break;
+        }
+        case 'A' : {
+            CWaitCursor  wait;
+            if (!GetDocument()->boxFilter( (GetKeyState( VK_SHIFT ) < 0) ? 12 : 2 ))
+                AfxMessageBox( "Not enough memory to filter the image." );
+            break;
+        }
+        case 'N' : {
+            CWaitCursor  wait;
+            if (!GetDocument()->rankFilter( (GetKeyState( VK_SHIFT ) < 0) ? 25 : 7, 0.5 ))
+                AfxMessageBox( "The median filter needs a gray image with at most 16 bits of values." );
+            break;
+        }
+        case 'L' : {
+            const bool  eight = (GetKeyState( VK_SHIFT ) >= 0);
+            std::vector<ConnectedComponents::Component>  table;
+            int  count;
+            {
+                CWaitCursor  wait;
+                count = GetDocument()->labelComponents( eight, &table );
+            }
+            if (count<0) {
+                AfxMessageBox( "Labeling needs a gray (binary) image." );
+                break;
+            }
+            int  largest = 0;
+            for (size_t i=0; i<table.size(); i++)
+                if (table[i].area > table[largest].area)    largest = (int)i;
+            CFrameWnd*  frame = (CFrameWnd*)AfxGetMainWnd();
+            if (frame==NULL)    break;
+            char  buff[128];
+            if (count==0)
+                sprintf( buff, "no components" );
+            else
+                sprintf( buff, "%d components (%d-connected); largest: %d, %d pixels",
+                         count, eight ? 8 : 4, largest+1, table[largest].area );
+            frame->SetMessageText( buff );
+            break;
+        }
+        case 'W' :
+            autoWindow();
+            break;
+        default :
+            CView::OnKeyDown( nChar, nRepCnt, nFlags );
+            break;
+    }
+}
+//---------------------------------------------------------------------------
+/** \brief Window a gray image to the 1st..99th percentiles of what's
+ *  visible (from the document's cached histogram of that rect).
+ */
+void View::autoWindow ( void ) {
+    ImageData*  pDoc = GetDocument();
+    if (!pDoc->dataAvailable() || pDoc->getIsColor())    return;
+    CRect  rcClient;
+    GetClientRect( &rcClient );
+    const int  x0 = (int)floor( mPanX ), y0 = (int)floor( mPanY );
+    const int  x1 = (int)ceil( mPanX + rcClient.Width()  / mZoom );
+    const int  y1 = (int)ceil( mPanY + rcClient.Height() / mZoom );
+    int  first, shift;
+    const std::vector<unsigned int>&  hist = pDoc->getHistogram( x0, y0, x1, y1,
+                                                                 &first, &shift );
+    long long  total = 0;
+    for (size_t i=0; i<hist.size(); i++)    total += hist[i];
+    if (total==0)    return;
+    //bins holding the 1st and 99th percentiles
+    long long  cum = 0;
+    size_t  lo = hist.size(), hi = 0;
+    for (size_t i=0; i<hist.size(); i++) {
+        cum += hist[i];
+        if (lo==hist.size() && cum > total / 100)         lo = i;
+        if (cum > total - total / 100 - 1) {  hi = i;  break;  }
+    }
+    const double  vlo = first + ((double)lo * (1 << shift));
+    const double  vhi = first + ((double)(hi + 1) * (1 << shift)) - 1;
+    mLUT.setWindow( (vlo + vhi) / 2, vhi - vlo + 1 );
+    startRender();
+    showWindow();
+}
+//---------------------------------------------------------------------------
+/** \brief Switch the display mode of a gray image.  Only the lut (at most
+ *  65536 entries) is rebuilt and the visible tiles are remapped.
+ */
+void View::setDisplayMode ( const int mode ) {
+    ImageData*  pDoc = GetDocument();
+    if (!pDoc->dataAvailable() || pDoc->getIsColor())    return;
+    if (mode==DisplayLUT::Equalize && pDoc->makeResident()) {
+        int  first, shift;
+        const std::vector<unsigned int>&  hist = pDoc->getStats().getHistogram( &first, &shift );
+        mLUT.setHistogram( hist, first, shift );
+    }
+    mLUT.setMode( mode );
+    startRender();
+    showWindow();
+}
+//---------------------------------------------------------------------------
+/** \brief Show a gray image with the next colormap (gray, hot, jet,
+ *  viridis, then the one defined by the CLUT used for tiff files, if any).
+ *  The map is part of the lut, so only the visible tiles are remapped.
+ */
+void View::nextColormap ( void ) {
+    ImageData*  pDoc = GetDocument();
+    if (!pDoc->dataAvailable() || pDoc->getIsColor())    return;
+    Colormap  map;
+    int  next = mLUT.getColormap().getKind() + 1;
+    if (next==Colormap::Custom && clut.r_entries==0)    next = Colormap::Gray;
+    if (next==Colormap::Custom)    map.setCLUT( clut );
+    else                           map.set( next % Colormap::Custom );
+    mLUT.setColormap( map );
+    startRender();
+    showWindow();
+}
+//---------------------------------------------------------------------------
+/** \brief Save the whole image (8 bit rgb) exactly as displayed: through
+ *  the same lut (window, curve, and colormap) as the tiles.
+ */
+void View::exportDisplayed ( void ) {
+    ImageData*  pDoc = GetDocument();
+    if (!pDoc->dataAvailable())    return;
+    CFileDialog  dlg( FALSE, "tif", NULL, OFN_HIDEREADONLY | OFN_OVERWRITEPROMPT,
+                      "TIFF files (*.tif)|*.tif|PPM files (*.ppm)|*.ppm||", this );
+    if (dlg.DoModal()!=IDOK)    return;
+    MemoryBudget::Pin  pinDoc( pDoc );
+    if (!pDoc->makeResident())    return;
+    if (!mLUTValid)    buildLUT();
+    CWaitCursor  wait;
+    char  msg[512];
+    if (!ImageSaver::save( pDoc->getPixels(), pDoc->getW(), pDoc->getH(),
+                           pDoc->getIsColor() ? 3 : 1, pDoc->getMin(),
+                           pDoc->getMax(), dlg.GetPathName(), NULL, msg,
+                           sizeof msg, NULL, &mLUT ))
+        AfxMessageBox( msg );
+}
+//---------------------------------------------------------------------------
+/** \brief Ask for a file name and save the distance transform of the
+ *  (binary or label) image there (see ImageData::exportDistanceMap).
+ */
+void View::exportDistanceMap ( void ) {
+    ImageData*  pDoc = GetDocument();
+    if (!pDoc->dataAvailable())    return;
+    CFileDialog  dlg( FALSE, "tif", NULL, OFN_HIDEREADONLY | OFN_OVERWRITEPROMPT,
+                      "TIFF files (*.tif)|*.tif||", this );
+    if (dlg.DoModal()!=IDOK)    return;
+    CWaitCursor  wait;
+    if (!pDoc->exportDistanceMap( dlg.GetPathName() ))
+        AfxMessageBox( "The distance map couldn't be saved (it needs a gray (binary or label) image with some 0 pixels, enough memory, and a file that can be created)." );
+}
+//---------------------------------------------------------------------------
+/** \brief Change the zoom, keeping the image position under p (window
+ *  coordinates) in place.
+ */
+void View::zoomAt ( double zoom, const CPoint& p ) {
+    ImageData*  pDoc = GetDocument();
+    if (!pDoc->dataAvailable())    return;
+    //no smaller than the last level
+    const int  levels = ImagePyramid::levelCount( pDoc->getW(), pDoc->getH() );
+    const double  minZoom = 1.0 / (1 << (levels-1));
+    if (zoom<minZoom)    zoom = minZoom;
+    if (zoom>MaxZoom)    zoom = MaxZoom;
+    const double  ix = mPanX + p.x / mZoom, iy = mPanY + p.y / mZoom;
+    mZoom = zoom;
+    mPanX = ix - p.x / mZoom;
+    mPanY = iy - p.y / mZoom;
+    clampPan();
+    viewChanged();
+    CFrameWnd*  frame = (CFrameWnd*)AfxGetMainWnd();
+    if (frame==NULL)    return;
+    char  buff[128];
+    sprintf( buff, "zoom %.1f%%", 100 * mZoom );
+    frame->SetMessageText( buff );
+}
+//---------------------------------------------------------------------------
+/// zoom so that the whole image fits in the window.
+void View::fitToWindow ( void ) {
+    ImageData*  pDoc = GetDocument();
+    if (!pDoc->dataAvailable())    return;
+    CRect  rcClient;
+    GetClientRect( &rcClient );
+    const double  zx = (double)rcClient.Width()  / pDoc->getW();
+    const double  zy = (double)rcClient.Height() / pDoc->getH();
+    mPanX = mPanY = 0;
+    zoomAt( (zx<zy) ? zx : zy, CPoint( 0, 0 ) );
+}
+//---------------------------------------------------------------------------
+/** \brief Keep as much of the image in the window as possible (it's at the
+ *  upper left if it fits).
+ */
+void View::clampPan ( void ) {
+    ImageData*  pDoc = GetDocument();
+    CRect  rcClient;
+    GetClientRect( &rcClient );
+    const double  maxX = pDoc->getW() - rcClient.Width()  / mZoom;
+    const double  maxY = pDoc->getH() - rcClient.Height() / mZoom;
+    if (mPanX>maxX)    mPanX = maxX;
+    if (mPanY>maxY)    mPanY = maxY;
+    if (mPanX<0)       mPanX = 0;
+    if (mPanY<0)       mPanY = 0;
+}
+//---------------------------------------------------------------------------
+/** \brief The zoom, pan, or filter changed: recompose (from the cached
+ *  tiles, rendering any that are missing) and repaint.
+ */
+void View::viewChanged ( void ) {
+    mFrameCurrent = false;
+    Invalidate( FALSE );
+}
+/////////////////////////////////////////////////////////////////////////////
+/** \brief Frames are window sized, so a new one is composed after a resize.
+ */
+void View::OnSize ( UINT nType, int cx, int cy ) {
+    CView::OnSize( nType, cx, cy );
+    if (GetDocument()->dataAvailable())    clampPan();
+    mFrameCurrent = false;
 }
 /////////////////////////////////////////////////////////////////////////////
 /** \brief Must override this method to reduce flicker.
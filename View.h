@@ -32,9 +32,18 @@
   #pragma once
 #endif // _MSC_VER > 1000
 
+#include  "DisplayLUT.h"
+#include  "FrameRenderer.h"
+
+/// posted to a view when a new frame is ready.
+#define  WM_FRAME_READY   (WM_APP + 3)
+/// posted to a view when its displayable image is complete.
+#define  WM_RENDER_DONE   (WM_APP + 4)
+
 /** \brief View class.  Modified for ImageViewer.
  */
-class View : public CView {
+class View : public CView, public MemoryBudget::Client,
+             public FrameRenderer::Listener {
 protected: // create from serialization only
 	View();
 	DECLARE_DYNCREATE( View )
@@ -57,7 +66,14 @@ protected:
 	virtual void OnBeginPrinting ( CDC* pDC, CPrintInfo* pInfo );
 	virtual void OnEndPrinting ( CDC* pDC, CPrintInfo* pInfo );
 	virtual void OnUpdate ( CView* pSender, LPARAM lHint, CObject* pHint );
+	virtual void OnActivateView ( BOOL bActivate, CView* pActivateView,
+	                              CView* pDeactiveView );
 	//}}AFX_VIRTUAL
+public:
+	virtual size_t evict ( void );
+	virtual void frameReady ( void );
+	virtual void renderFinished ( void );
+	void getMoveLatency ( long* count, double* mean, double* max ) const;
 
 // Implementation
 public:
@@ -70,13 +86,71 @@ public:
 protected:
     bool            mMouseMoveValid;           ///< indicates mouse (x,y) below are valid
     int             mMouseMoveX, mMouseMoveY;  ///< mouse (x,y) for tracking
-    unsigned char*  mDisplayData;              ///< displayable image
+    DisplayLUT      mLUT;                      ///< gray value to display pixel
+    bool            mLUTValid;                 ///< mLUT matches the image's range
+    bool            mDragging;                 ///< adjusting the window (left button down)
+    CPoint          mDragStart;                ///< where the drag started
+    double          mDragCenter, mDragWidth;   ///< window when the drag started
+    FrameRenderer   mFrames;                   ///< composes what's in the window
+    bool            mRenderPinned;             ///< we and the doc are pinned for mFrames
+    bool            mFrameCurrent;             ///< the latest request matches the view
+    volatile long   mFramePosted;              ///< a WM_FRAME_READY is pending
+    double          mZoom;                     ///< window pixels per image pixel
+    double          mPanX, mPanY;              ///< image position at the window's upper left
+    bool            mBilinear;                 ///< filter zoomed tiles (otherwise, nearest)
+    bool            mPanning;                  ///< panning (right button down)
+    CPoint          mPanStart;                 ///< where the pan started
+    double          mPanStartX, mPanStartY;    ///< mPanX,mPanY when the pan started
+
+    enum { MaxZoom = 32 };  ///< max magnification
+
+    enum { OverlayTimer = 1 };  ///< timer id for deferred mouse text repaints
+    CRect           mOverlayRect;              ///< where the mouse text was last drawn
+    bool            mOverlayTimerSet;          ///< a deferred repaint is pending
+    long long       mMoveTime;                 ///< first mouse move not yet painted (or 0)
+    long long       mLastOverlayPaint;         ///< when the mouse text was last painted
+    long long       mRefreshTicks;             ///< display refresh interval
+    long            mLatencyCount;             ///< move to paint latencies measured
+    double          mLatencyTotal;             ///< sum of them (in seconds)
+    double          mLatencyMax;               ///< max of them (in seconds)
+
+    void releaseDisplayData ( void );
+    void overlayRect ( CDC* pDC, const char* const text, CRect* rc );
+    void overlayPainted ( CDC* pDC );
+    void invalidateOverlay ( void );
+    static long long ticks ( void );
+    static long long ticksPerSecond ( void );
+    void startRender ( void );
+    void showWindow ( void );
+    void buildLUT ( void );
+    void setDisplayMode ( const int mode );
+    void nextColormap ( void );
+    void exportDisplayed ( void );
+    void exportDistanceMap ( void );
+    void finishRender ( void );
+    void overlayText ( char* buff );
+    void zoomAt ( double zoom, const CPoint& p );
+    void fitToWindow ( void );
+    void autoWindow ( void );
+    void clampPan ( void );
+    void viewChanged ( void );
 
 // Generated message map functions
 protected:
 	//{{AFX_MSG( View )
 	afx_msg void OnMouseMove ( UINT nFlags, CPoint point );
 	afx_msg BOOL OnEraseBkgnd ( CDC* pDC );
+	afx_msg void OnSize ( UINT nType, int cx, int cy );
+	afx_msg void OnTimer ( UINT_PTR nIDEvent );
+	afx_msg void OnLButtonDown ( UINT nFlags, CPoint point );
+	afx_msg void OnLButtonUp ( UINT nFlags, CPoint point );
+	afx_msg void OnLButtonDblClk ( UINT nFlags, CPoint point );
+	afx_msg void OnRButtonDown ( UINT nFlags, CPoint point );
+	afx_msg void OnRButtonUp ( UINT nFlags, CPoint point );
+	afx_msg BOOL OnMouseWheel ( UINT nFlags, short zDelta, CPoint pt );
+	afx_msg void OnKeyDown ( UINT nChar, UINT nRepCnt, UINT nFlags );
+	afx_msg LRESULT OnFrameReady ( WPARAM wParam, LPARAM lParam );
+	afx_msg LRESULT OnRenderDone ( WPARAM wParam, LPARAM lParam );
 	//}}AFX_MSG
 	DECLARE_MESSAGE_MAP( )
 };
@@ -32,7 +32,7 @@
 #include  <stdio.h>
 //----------------------------------------------------------------------
 /** \brief This class contains methods that read and write PNM images
- *  (color rgb and grey images).
+ *  (color rgb, grey, and bitmap images).
  */
 class pnmHelper {
 private:
@@ -42,11 +42,29 @@ private:
         exit( 0 );
     }
 public:
+    /// malloc compatible function used to allocate the pixel data.
+    typedef void* (*Allocator) ( size_t bytes );
+    //------------------------------------------------------------------
+    /** \brief Function used by the readers to allocate pixel data
+     *  (malloc by default).
+     */
+    static Allocator& allocator ( void ) {
+        static Allocator  a = malloc;
+        return a;
+    }
+    //------------------------------------------------------------------
+    /** \brief Use a different allocator for pixel data (e.g., one that
+     *  recycles buffers).  The caller then frees the data accordingly.
+     */
+    static void setAllocator ( Allocator a ) {
+        allocator() = (a!=NULL) ? a : malloc;
+    }
     //------------------------------------------------------------------
     /** \brief This method should be generally used to read any pnm
-     *  (pgm grey, ppm color) binary or ascii image files.
+     *  (pbm bitmap, pgm grey, ppm color) binary or ascii image files.
      *
-     *  It's the caller's responsibility to free the malloc'd data.
+     *  It's the caller's responsibility to free the data (allocated with
+     *  malloc unless a different allocator was set).
      */
     static int* read_pnm_file ( const char* const fname, int* w, int* h,
         int* samplesPerPixel, int* min, int* max )
@@ -82,6 +100,9 @@ public:
                  || strcmp(ln,"P6\n\r")==0 || strcmp(ln,"P6\r\n")==0 ) {
             *samplesPerPixel = 3;
             return read_binary_ppm_file( fname, w, h, min, max );
+        } else if ( strncmp(ln,"P1",2)==0 || strncmp(ln,"P4",2)==0 ) {
+            *samplesPerPixel = 1;
+            return read_pbm_file( fname, w, h, min, max );
         } else {
             char  buff[BUFSIZ];
             sprintf(buff,
@@ -91,6 +112,93 @@ public:
         return NULL;
     }
 //----------------------------------------------------------------------
+/** \brief Get the next non-comment line (as the readers do).
+ *  \returns false at the end of the file.
+ */
+static bool next_line ( FILE* fp, char* const ln, const int size ) {
+    for ( ; ; ) {
+        ln[0] = 0;
+        if (fgets(ln, size, fp) == NULL)    return false;
+        if (ln[0] != '#')    return true;
+    }
+}
+//----------------------------------------------------------------------
+/** \brief Check that a pnm file may be read (by read_pnm_file) without
+ *  an error, i.e., that it has a proper header and all of its samples.
+ *  The readers exit on errors, so a caller that must not exit (e.g., one
+ *  reading a batch of files) calls this first.
+ *  \param fname  input file name
+ *  \param errMsg receives a description of the problem (may be NULL)
+ *  \param errMsgSize size of errMsg
+ *  \returns true if the file is ok; false otherwise.
+ */
+static bool check_pnm_file ( const char* const fname, char* const errMsg,
+                             const int errMsgSize )
+{
+    assert( fname!=NULL );
+    char  msg[512];
+    msg[0] = 0;
+    FILE*  fp = (strlen(fname) == 0) ? NULL : fopen(fname, "rb");
+    if (fp == NULL) {
+        sprintf(msg, "can't open %.400s", fname);
+    } else {
+        char  ln[BUFSIZ];
+        int   w=0, h=0, maxval=1, spp=1;
+        bool  pbm=false, ascii=false;
+        if (!next_line(fp, ln, sizeof ln))    ln[0] = 0;
+        const bool  exact = ln[0]=='P' && ( strcmp(&ln[2],"\n")==0
+            || strcmp(&ln[2],"\r")==0 || strcmp(&ln[2],"\n\r")==0
+            || strcmp(&ln[2],"\r\n")==0 );
+        if (strncmp(ln,"P1",2)==0 || strncmp(ln,"P4",2)==0) {
+            pbm   = true;
+            ascii = (ln[1]=='1');
+        } else if (exact && ln[1]>='2' && ln[1]<='6' && ln[1]!='4') {
+            ascii = (ln[1]=='2' || ln[1]=='3');
+            spp   = (ln[1]=='3' || ln[1]=='6') ? 3 : 1;
+        } else {
+            sprintf(msg, "%.400s isn't a pbm, pgm, or ppm file", fname);
+        }
+        if (msg[0]==0 && ( !next_line(fp, ln, sizeof ln)
+                        || sscanf(ln, "%d %d", &w, &h) != 2
+                        || w <= 0 || h <= 0
+                        || (double)w * h * spp > INT_MAX / sizeof(int) ))
+            sprintf(msg, "%.400s has a bad width or height", fname);
+        if (msg[0]==0 && !pbm && ( !next_line(fp, ln, sizeof ln)
+                                || sscanf(ln, "%d", &maxval) != 1
+                                || maxval <= 0
+                                || (!ascii && maxval > 65535) ))
+            sprintf(msg, "%.400s has a bad max value", fname);
+        if (msg[0]==0) {
+            //the samples (or bits)
+            bool  ok = true;
+            const long  n = (long)w * h * spp;
+            if (pbm && ascii) {
+                for (long i=0; i<n && ok; i++) {
+                    int  c;
+                    do {  c = fgetc(fp);  } while (c==' ' || c=='\t' || c=='\r' || c=='\n');
+                    ok = (c=='0' || c=='1');
+                }
+            } else if (ascii) {
+                int  v;
+                for (long i=0; i<n && ok; i++)    ok = (fscanf(fp, "%d", &v) == 1);
+            } else {
+                const long  bytes = pbm ? (long)((w + 7) / 8) * h
+                                        : n * (maxval > 255 ? 2 : 1);
+                const long  at = ftell(fp);
+                ok = (at >= 0 && fseek(fp, 0, SEEK_END) == 0
+                   && ftell(fp) - at >= bytes);
+            }
+            if (!ok)    sprintf(msg, "%.400s is truncated or damaged", fname);
+        }
+        fclose(fp);    fp=NULL;
+    }
+    if (msg[0]!=0 && errMsg!=NULL && errMsgSize>0) {
+        strncpy(errMsg, msg, errMsgSize-1);
+        errMsg[errMsgSize-1] = 0;
+    }
+    return msg[0]==0;
+}
+//----------------------------------------------------------------------
 /** \brief This function reads an ascii grey pgm file.
  *
  *  This type of file is formatted as follows:
@@ -101,7 +209,8 @@ public:
  *  v_1 v_2 v_3 . . . v_w*h
  *  </pre>
  *
- *  It's the caller's responsibility to free the malloc'd data.
+ *  It's the caller's responsibility to free the data (allocated with
+ *  malloc unless a different allocator was set).
  */
 static int* read_ascii_pgm_file ( const char* const fname, int* w, int* h,
                                   int* min, int* max )
@@ -135,7 +244,7 @@ static int* read_ascii_pgm_file ( const char* const fname, int* w, int* h,
     int  c = sscanf(ln, "%d %d", w, h);
     if (c != 2)
         usage("input image file is not a proper pgm formatted file");
-    int*  slice = (int*)malloc(*w * *h * sizeof *slice);
+    int*  slice = (int*)allocator()(*w * *h * sizeof *slice);
     if (slice == NULL)    usage("out of memory");
     //get the next non-comment line (should be the max value)
     for ( ; ; ) {
@@ -175,7 +284,8 @@ static int* read_ascii_pgm_file ( const char* const fname, int* w, int* h,
  *  vr_w*h vg_w*h vb_w*h
  *  </pre>
  *
- *  It's the caller's responsibility to free the malloc'd data.
+ *  It's the caller's responsibility to free the data (allocated with
+ *  malloc unless a different allocator was set).
  */
 static int* read_ascii_ppm_file ( const char* const fname, int* w, int* h,
                                  int* min, int* max )
@@ -209,7 +319,7 @@ static int* read_ascii_ppm_file ( const char* const fname, int* w, int* h,
     int  c = sscanf(ln, "%d %d", w, h);
     if (c != 2)
         usage("input image file is not a proper pgm formatted file");
-    int*  slice = (int*)malloc(3 * *w * *h * sizeof *slice);
+    int*  slice = (int*)allocator()(3 * *w * *h * sizeof *slice);
     if (slice == NULL)    usage("out of memory");
     //get the next non-comment line (should be the max value)
     for ( ; ; ) {
@@ -240,6 +350,18 @@ static int* read_ascii_ppm_file ( const char* const fname, int* w, int* h,
     return slice;
 }
 //----------------------------------------------------------------------
+/** \brief Read one sample of a binary pgm or ppm file.
+ *  \param fp   input file
+ *  \param wide true if maxval > 255 (2 bytes per sample, msb first)
+ */
+static int read_binary_sample ( FILE* fp, const bool wide ) {
+    unsigned char  uc[2];
+    const size_t   n = wide ? 2 : 1;
+    if (fread( uc, 1, n, fp ) != n)    usage("error reading input file");
+    if (wide)    return (uc[0] << 8) | uc[1];
+    return uc[0];
+}
+//----------------------------------------------------------------------
 /** \brief This function reads a binary grey pgm file.
  *
  *  This type of file is formatted as follows:
@@ -250,7 +372,8 @@ static int* read_ascii_ppm_file ( const char* const fname, int* w, int* h,
  *  v_1 v_2 v_3 . . . v_w*h
  *  </pre>
  *
- *  It's the caller's responsibility to free the malloc'd data.
+ *  It's the caller's responsibility to free the data (allocated with
+ *  malloc unless a different allocator was set).
  */
 static int* read_binary_pgm_file ( const char* const fname, int* w, int* h,
                                    int* min, int* max )
@@ -284,7 +407,7 @@ static int* read_binary_pgm_file ( const char* const fname, int* w, int* h,
     int  c = sscanf(ln, "%d %d", w, h);
     if (c != 2)
         usage("input image file is not a proper pgm formatted file");
-    int*  slice = (int*)malloc(*w * *h * sizeof *slice);
+    int*  slice = (int*)allocator()(*w * *h * sizeof *slice);
     if (slice == NULL)    usage("out of memory");
     //get the next non-comment line (should be the max value)
     for ( ; ; ) {
@@ -292,16 +415,17 @@ static int* read_binary_pgm_file ( const char* const fname, int* w, int* h,
         fgets(ln, sizeof ln, fp);
         if (ln[0] != '#')    break;
     }
-    //forget the max value (above) & read the actual data (we're assuming
-    // that there aren't any comments between the max value and the data)
+    //maxval > 255 means 2 bytes (msb first) per sample.  read the actual
+    // data (we're assuming that there aren't any comments between the max
+    // value and the data).
+    int  maxval = 255;
+    sscanf( ln, "%d", &maxval );
+    const bool  wide = (maxval > 255);
     int  myMin=INT_MAX, myMax=INT_MIN;
     int  i=0;
     for (int y=0; y<*h; y++) {
         for (int x=0; x<*w; x++) {
-            unsigned char  uc;
-            c = fread( &uc, sizeof uc, 1, fp );
-            if (c != 1)    usage("error reading input file");
-            slice[i] = uc;
+            slice[i] = read_binary_sample( fp, wide );
             if (slice[i]<myMin)    myMin=slice[i];
             if (slice[i]>myMax)    myMax=slice[i];
             i++;
@@ -326,7 +450,8 @@ static int* read_binary_pgm_file ( const char* const fname, int* w, int* h,
  *  vr_w*h vg_w*h vb_w*h
  *  </pre>
  *
- *  It's the caller's responsibility to free the malloc'd data.
+ *  It's the caller's responsibility to free the data (allocated with
+ *  malloc unless a different allocator was set).
  */
 static int* read_binary_ppm_file ( const char* const fname, int* w, int* h,
                                    int* min, int* max )
@@ -360,7 +485,7 @@ static int* read_binary_ppm_file ( const char* const fname, int* w, int* h,
     int  c = sscanf(ln, "%d %d", w, h);
     if (c != 2)
         usage("input image file is not a proper pgm formatted file");
-    int*  slice = (int*)malloc(3 * *w * *h * sizeof *slice);
+    int*  slice = (int*)allocator()(3 * *w * *h * sizeof *slice);
     if (slice == NULL)    usage("out of memory");
     //get the next non-comment line (should be the max value)
     for ( ; ; ) {
@@ -368,31 +493,107 @@ static int* read_binary_ppm_file ( const char* const fname, int* w, int* h,
         fgets(ln, sizeof ln, fp);
         if (ln[0] != '#')    break;
     }
-    //forget the max value (above) & read the actual data (we're assuming
-    // that there aren't any comments between the max value and the data)
+    //maxval > 255 means 2 bytes (msb first) per sample.  read the actual
+    // data (we're assuming that there aren't any comments between the max
+    // value and the data).
+    int  maxval = 255;
+    sscanf( ln, "%d", &maxval );
+    const bool  wide = (maxval > 255);
     int  myMin=INT_MAX, myMax=INT_MIN;
     int  i=0;
     for (int y=0; y<*h; y++) {
         for (int x=0; x<*w; x++) {
-            unsigned char  ucr, ucg, ucb;
-
-            c = fread( &ucr, sizeof ucr, 1, fp );
-            if (c != 1)    usage("error reading input file");
-            slice[i] = ucr;
+            slice[i] = read_binary_sample( fp, wide );
             if (slice[i]<myMin)    myMin=slice[i];
             if (slice[i]>myMax)    myMax=slice[i];
             i++;
             
-            c = fread( &ucg, sizeof ucg, 1, fp );
-            if (c != 1)    usage("error reading input file");
-            slice[i] = ucg;
+            slice[i] = read_binary_sample( fp, wide );
             if (slice[i]<myMin)    myMin=slice[i];
             if (slice[i]>myMax)    myMax=slice[i];
             i++;
             
-            c = fread( &ucb, sizeof ucb, 1, fp );
-            if (c != 1)    usage("error reading input file");
-            slice[i] = ucb;
+            slice[i] = read_binary_sample( fp, wide );
+            if (slice[i]<myMin)    myMin=slice[i];
+            if (slice[i]>myMax)    myMax=slice[i];
+            i++;
+        }
+    }
+    *min = myMin;
+    *max = myMax;
+    fclose(fp);    fp=NULL;
+    return slice;
+}
+//----------------------------------------------------------------------
+/** \brief This function reads an ascii (P1) or binary (P4) bitmap pbm
+ *  file.
+ *
+ *  This type of file is formatted as follows:
+ *  <pre>
+ *  P1 (or P4)
+ *  w h
+ *  b_1 b_2 b_3 . . . b_w*h
+ *  </pre>
+ *  In a P1 file, the bits are the characters 0 and 1 (whitespace is
+ *  optional).  In a P4 file, each row is packed 8 pixels per byte (msb
+ *  first).  A 1 bit is black, so it becomes 0 (and a 0 bit becomes 1),
+ *  which matches the 0/1 pgm files.
+ *
+ *  It's the caller's responsibility to free the data (allocated with
+ *  malloc unless a different allocator was set).
+ */
+static int* read_pbm_file ( const char* const fname, int* w, int* h,
+                            int* min, int* max )
+{
+    assert( fname!=NULL && w!=NULL && h!=NULL && min!=NULL && max!=NULL );
+    *w = *h = *min = *max = 0;
+    if (strlen(fname) == 0)    usage("bad input file name");
+    FILE*  fp = fopen(fname, "rb");
+    if (fp == NULL)    usage("can't open the input file");
+    char ln[BUFSIZ];
+    //get the first non-comment line
+    for ( ; ; ) {
+        ln[0] = 0;
+        fgets(ln, sizeof ln, fp);
+        if (ln[0] != '#')    break;
+    }
+    const bool  ascii = (strncmp(ln,"P1",2)==0);
+    if (!ascii && strncmp(ln,"P4",2)!=0) {
+        char buff[1000];
+        sprintf(buff,
+          "input image file: %s, is not a proper pbm formatted file", fname);
+        usage( buff );
+    }
+    //get the next non-comment line
+    for ( ; ; ) {
+        ln[0] = 0;
+        fgets(ln, sizeof ln, fp);
+        if (ln[0] != '#')    break;
+    }
+    //get the width and height (there is no max value)
+    int  c = sscanf(ln, "%d %d", w, h);
+    if (c != 2 || *w <= 0 || *h <= 0)
+        usage("input image file is not a proper pbm formatted file");
+    int*  slice = (int*)allocator()(*w * *h * sizeof *slice);
+    if (slice == NULL)    usage("out of memory");
+    int  myMin=INT_MAX, myMax=INT_MIN;
+    int  i=0;
+    for (int y=0; y<*h; y++) {
+        int  byte=0;
+        for (int x=0; x<*w; x++) {
+            int  bit;
+            if (ascii) {
+                do {  c = fgetc(fp);  } while (c==' ' || c=='\t' || c=='\r' || c=='\n');
+                if (c!='0' && c!='1')    usage("error reading input file");
+                bit = c - '0';
+            } else {
+                if (x%8 == 0) {
+                    byte = fgetc(fp);
+                    if (byte==EOF)    usage("error reading input file");
+                }
+                bit = (byte >> (7 - x%8)) & 1;
+            }
+            slice[i] = 1 - bit;
             if (slice[i]<myMin)    myMin=slice[i];
             if (slice[i]>myMax)    myMax=slice[i];
             i++;
@@ -481,7 +682,7 @@ static void write_pgm_or_ppm_ascii_data ( const int* const buff,
     }
 
     if (maxval == 0)    maxval = 255;
-    fprintf(fp, "%d\n", maxval);
+    fprintf(fp, "%ld\n", maxval);
 
     for (count=i=0; i<(width*height*samples_per_pixel); i++,count++)  {
         //fprintf(fp, " %*d", output_width, buff[i]);
@@ -518,7 +719,7 @@ static void write_raw_pgm_data32 ( int* buff, int width, int height,
         if (buff[i] > maxval)  maxval = buff[i];
     //default if necessary
     if (maxval == 0)  maxval = 255;
-    fprintf(fp, "%d\n", maxval);
+    fprintf(fp, "%ld\n", maxval);
     //write out the data
     for (i=0; i < width*height; i++) {
 //        if (unsigned_flag) {
@@ -584,7 +785,7 @@ static void write_raw_pgm_data16 ( int* buff, int width, int height,
     //default if necessary
     if (maxval == 0)  maxval = 255;
     assert(maxval <= SHRT_MAX);
-    fprintf(fp, "%d\n", maxval);
+    fprintf(fp, "%ld\n", maxval);
     //write out the data
     for (i=0; i < width*height; i++) {
 //        if (unsigned_flag) {
@@ -623,7 +824,7 @@ static void write_binary_pgm_or_ppm_data8 ( const unsigned char* const buff,
         if (buff[i] > maxval)  maxval = buff[i];
 
     if (maxval == 0)  maxval = 255;
-    fprintf(fp, "%d\n", maxval);
+    fprintf(fp, "%ld\n", maxval);
 
     fwrite(buff, width*height*samples_per_pixel, sizeof *buff, fp);
 }